@@ -0,0 +1,195 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "Threading.h"
+
+struct AtomicAllocationCounts
+{
+    std::atomic_int64_t allocationCount;
+    std::atomic_int64_t allocatedBytes;
+    std::atomic_int64_t freeCount;
+    std::atomic_int64_t freedBytes;
+};
+
+// Counts accumulate across the threads that own the buffer in turn.
+struct AllocationBuffer
+{
+    explicit AllocationBuffer(int setThreadId)
+        : threadId(setThreadId)
+        , tags{}
+        , owned(false)
+    {
+    }
+
+    const int threadId;
+    std::array<AtomicAllocationCounts, AllocationTag_Count> tags;
+    std::atomic_bool owned;
+};
+
+static ThreadBufferRegistry<AllocationBuffer> AllocationBuffers;
+thread_local static ThreadBuffer<AllocationBuffer> ThreadAllocationBuffer;
+static std::array<std::atomic_int64_t, AllocationTag_Count> LiveBytes{};
+static std::array<std::atomic_int64_t, AllocationTag_Count> PeakLiveBytes{};
+
+std::atomic_bool AllocationTracker::EnabledFlag(false);
+
+static AllocationBuffer& LocalBuffer()
+{
+    return ThreadAllocationBuffer.Get(AllocationBuffers, [](int threadId) { return new AllocationBuffer(threadId); });
+}
+
+void AllocationCounts::Add(const AllocationCounts& other)
+{
+    allocationCount += other.allocationCount;
+    allocatedBytes += other.allocatedBytes;
+    freeCount += other.freeCount;
+    freedBytes += other.freedBytes;
+}
+
+AllocationCounts AllocationCounts::Since(const AllocationCounts& previous) const
+{
+    return { (allocationCount - previous.allocationCount), (allocatedBytes - previous.allocatedBytes),
+        (freeCount - previous.freeCount), (freedBytes - previous.freedBytes) };
+}
+
+void AllocationTracker::SetEnabled(bool enabled)
+{
+    EnabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+void AllocationTracker::RecordAllocate(AllocationTag tag, int64_t bytes, int64_t count)
+{
+    AtomicAllocationCounts& counts = LocalBuffer().tags[tag];
+    IncrementOwned(counts.allocationCount, count);
+    IncrementOwned(counts.allocatedBytes, bytes);
+
+    if (AllocationTagTracksFrees[tag])
+    {
+        const int64_t live = (LiveBytes[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+        int64_t peak = PeakLiveBytes[tag].load(std::memory_order_relaxed);
+        while ((live > peak) && !PeakLiveBytes[tag].compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+void AllocationTracker::RecordFree(AllocationTag tag, int64_t bytes)
+{
+    AtomicAllocationCounts& counts = LocalBuffer().tags[tag];
+    IncrementOwned(counts.freeCount);
+    IncrementOwned(counts.freedBytes, bytes);
+
+    LiveBytes[tag].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+AllocationSnapshot AllocationTracker::Take()
+{
+    AllocationSnapshot snapshot{};
+    snapshot.time = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(AllocationBuffers.Mutex());
+    for (const auto& buffer : AllocationBuffers.Buffers())
+    {
+        AllocationThreadSnapshot& thread = snapshot.threads.emplace_back();
+        thread.threadId = buffer->threadId;
+        for (int i = 0; i < AllocationTag_Count; i++)
+        {
+            const AtomicAllocationCounts& counts = buffer->tags[i];
+            thread.tags[i] = { counts.allocationCount.load(std::memory_order_relaxed), counts.allocatedBytes.load(std::memory_order_relaxed),
+                counts.freeCount.load(std::memory_order_relaxed), counts.freedBytes.load(std::memory_order_relaxed) };
+            snapshot.tags[i].Add(thread.tags[i]);
+        }
+    }
+    for (int i = 0; i < AllocationTag_Count; i++)
+    {
+        snapshot.liveBytes[i] = LiveBytes[i].load(std::memory_order_relaxed);
+        snapshot.peakLiveBytes[i] = PeakLiveBytes[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void AllocationTracker::ResetPeaks()
+{
+    for (int i = 0; i < AllocationTag_Count; i++)
+    {
+        PeakLiveBytes[i].store(LiveBytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+std::vector<std::string> AllocationTracker::Describe(const AllocationSnapshot& current, const AllocationSnapshot& previous)
+{
+    const double seconds = std::max(1e-9, std::chrono::duration<double>(current.time - previous.time).count());
+    const auto mebibytes = [](int64_t bytes) { return (static_cast<double>(bytes) / (1024.0 * 1024.0)); };
+
+    std::vector<std::string> lines;
+    for (int i = 0; i < AllocationTag_Count; i++)
+    {
+        const AllocationCounts counts = current.tags[i].Since(previous.tags[i]);
+        if ((counts.allocationCount <= 0) && (counts.freeCount <= 0))
+        {
+            continue;
+        }
+
+        std::stringstream line;
+        line << std::fixed << std::setprecision(2) << "allocations " << AllocationTagKeys[i]
+            << " count " << counts.allocationCount << " per_second " << (counts.allocationCount / seconds)
+            << " mib_per_second " << (mebibytes(counts.allocatedBytes) / seconds);
+        if (AllocationTagTracksFrees[i])
+        {
+            line << " frees " << counts.freeCount << " live_mib " << mebibytes(current.liveBytes[i])
+                << " peak_mib " << mebibytes(current.peakLiveBytes[i]);
+        }
+        lines.push_back(line.str());
+    }
+
+    // Threads may be new since the previous snapshot.
+    for (const AllocationThreadSnapshot& thread : current.threads)
+    {
+        const AllocationThreadSnapshot* previousThread = nullptr;
+        for (const AllocationThreadSnapshot& candidate : previous.threads)
+        {
+            if (candidate.threadId == thread.threadId)
+            {
+                previousThread = &candidate;
+                break;
+            }
+        }
+
+        std::stringstream line;
+        line << std::fixed << std::setprecision(2) << "allocations thread " << thread.threadId;
+        bool any = false;
+        for (int i = 0; i < AllocationTag_Count; i++)
+        {
+            const AllocationCounts counts = (previousThread ? thread.tags[i].Since(previousThread->tags[i]) : thread.tags[i]);
+            if (counts.allocationCount > 0)
+            {
+                line << " " << AllocationTagKeys[i] << " " << (counts.allocationCount / seconds) << "/s";
+                any = true;
+            }
+        }
+        if (any)
+        {
+            lines.push_back(line.str());
+        }
+    }
+    return lines;
+}
@@ -0,0 +1,132 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _ALLOCATIONTRACKER_H_
+#define _ALLOCATIONTRACKER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Heap traffic grouped by the subsystem responsible.
+enum AllocationTag
+{
+    AllocationTag_Node, // Search roots
+    AllocationTag_NodeChildren, // Child arrays allocated on expansion
+    AllocationTag_State, // Pooled StateInfos
+    AllocationTag_GameMoves, // Game move vectors, growing and copied into scratch games
+    AllocationTag_ChildVisits, // Search statistics stored per move
+    AllocationTag_SavedGame, // Finished games copied for storage
+    AllocationTag_Storage, // Protobuf messages written and read
+
+    AllocationTag_Count,
+};
+constexpr const char* AllocationTagKeys[AllocationTag_Count] = { "node", "node_children", "state", "game_moves", "child_visits",
+    "saved_game", "storage" };
+static_assert(AllocationTag_Count == 7);
+
+// Frees are only recorded where ownership is simple enough to follow, so other tags report
+// allocation rates but no live or peak bytes.
+constexpr bool AllocationTagTracksFrees[AllocationTag_Count] = { true, true, true, true, false, false, false };
+
+struct AllocationCounts
+{
+    int64_t allocationCount;
+    int64_t allocatedBytes;
+    int64_t freeCount;
+    int64_t freedBytes;
+
+    void Add(const AllocationCounts& other);
+    AllocationCounts Since(const AllocationCounts& previous) const;
+};
+
+using AllocationTagCounts = std::array<AllocationCounts, AllocationTag_Count>;
+
+struct AllocationThreadSnapshot
+{
+    int threadId;
+    AllocationTagCounts tags;
+};
+
+struct AllocationSnapshot
+{
+    std::chrono::steady_clock::time_point time;
+    AllocationTagCounts tags; // Totals across threads
+    std::array<int64_t, AllocationTag_Count> liveBytes;
+    std::array<int64_t, AllocationTag_Count> peakLiveBytes;
+    std::vector<AllocationThreadSnapshot> threads;
+};
+
+// Opt-in allocation accounting per subsystem tag and per thread, reporting allocations per second
+// and live and peak bytes, to prioritize allocation-elimination work. Recording is off unless enabled via
+// the "allocation_tracking" config key or UCI option, leaving a relaxed load per call site. Counts are
+// written by the owning thread only, but live and peak bytes are shared, so enabling adds some contention.
+// Live bytes are a net delta of bytes allocated minus bytes freed while recording, so frees of memory allocated
+// before recording was enabled (or while it was disabled) are still subtracted, and live bytes can go negative.
+class AllocationTracker
+{
+public:
+
+    static bool Enabled()
+    {
+        return EnabledFlag.load(std::memory_order_relaxed);
+    }
+
+    static void SetEnabled(bool enabled);
+
+    static void Allocate(AllocationTag tag, int64_t bytes, int64_t count = 1)
+    {
+        if (Enabled())
+        {
+            RecordAllocate(tag, bytes, count);
+        }
+    }
+
+    static void Free(AllocationTag tag, int64_t bytes)
+    {
+        if (Enabled())
+        {
+            RecordFree(tag, bytes);
+        }
+    }
+
+    // Approximate heap bytes per std::map entry: the value plus three tree links and color.
+    template <typename Map>
+    static constexpr int64_t MapNodeBytes()
+    {
+        return static_cast<int64_t>(sizeof(typename Map::value_type) + (4 * sizeof(void*)));
+    }
+
+    static AllocationSnapshot Take();
+    static void ResetPeaks();
+
+    // One human-readable line per active tag, then per active thread, with rates over the interval.
+    static std::vector<std::string> Describe(const AllocationSnapshot& current, const AllocationSnapshot& previous);
+
+private:
+
+    static void RecordAllocate(AllocationTag tag, int64_t bytes, int64_t count);
+    static void RecordFree(AllocationTag tag, int64_t bytes);
+
+private:
+
+    static std::atomic_bool EnabledFlag;
+};
+
+#endif // _ALLOCATIONTRACKER_H_
@@ -31,10 +31,15 @@
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
 
+#include "AllocationTracker.h"
 #include "Game.h"
+#include "HardwareCounters.h"
+#include "MetricsRegistry.h"
 #include "PredictionCache.h"
 #include "PoolAllocator.h"
 #include "Platform.h"
+#include "Storage.h"
+#include "Trace.h"
 
 namespace PSQT
 {
@@ -75,6 +80,7 @@ void ChessCoach::Initialize()
 
 void ChessCoach::Finalize()
 {
+    MetricsExporter::Instance.Stop();
     FinalizePython();
     FinalizeStockfish();
 }
@@ -146,6 +152,27 @@ void ChessCoach::InitializeChessCoach()
 {
     Config::Initialize();
     Game::Initialize();
+    Trace::SetEnabled(Config::Misc.Trace_Enabled);
+    AllocationTracker::SetEnabled(Config::Misc.Trace_AllocationTracking);
+    HardwareCounters::SetEnabled(Config::Misc.Trace_HardwareCounters);
+
+    // Export live metrics if configured, with relative paths under the logs directory.
+    if (!Config::Misc.Metrics_ExportFile.empty() || !Config::Misc.Metrics_ExportSocket.empty())
+    {
+        const auto makeMetricsPath = [](const std::string& setting)
+        {
+            if (setting.empty())
+            {
+                return std::filesystem::path();
+            }
+            const std::filesystem::path path = (std::filesystem::path(setting).is_absolute() ? std::filesystem::path(setting) :
+                (Storage::MakeLocalPath(Config::Misc.Paths_Logs) / setting));
+            std::filesystem::create_directories(path.parent_path());
+            return path;
+        };
+        MetricsExporter::Instance.Start(makeMetricsPath(Config::Misc.Metrics_ExportFile), makeMetricsPath(Config::Misc.Metrics_ExportSocket),
+            Config::Misc.Metrics_ExportIntervalSeconds);
+    }
 }
 
 void ChessCoach::InitializePredictionCache()
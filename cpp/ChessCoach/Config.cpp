@@ -328,6 +328,24 @@ void ParseSelfPlay(SelfPlayConfig& selfPlay, const TomlValue& config, const Poli
     policy.template Parse<int>(selfPlay.NumSampingMoves, config, "num_sampling_moves");
     policy.template Parse<int>(selfPlay.MaxMoves, config, "max_moves");
     policy.template Parse<int>(selfPlay.NumSimulations, config, "num_simulations");
+    policy.template Parse<int>(selfPlay.NumSimulationsFast, config, "num_simulations_fast");
+    policy.template Parse<float>(selfPlay.FullSimulationProportion, config, "full_simulation_proportion");
+    policy.template Parse<bool>(selfPlay.SimulationBudgetCountsInherited, config, "simulation_budget_counts_inherited");
+    policy.template Parse<int>(selfPlay.TreeReuseMinimumSimulations, config, "tree_reuse_minimum_simulations");
+    policy.template Parse<float>(selfPlay.ForkProportion, config, "fork_proportion");
+    policy.template Parse<float>(selfPlay.ForkValueSwingThreshold, config, "fork_value_swing_threshold");
+    policy.template Parse<bool>(selfPlay.AdaptiveSimulations, config, "adaptive_simulations");
+    policy.template Parse<int>(selfPlay.AdaptiveCheckInterval, config, "adaptive_check_interval");
+    policy.template Parse<float>(selfPlay.AdaptiveDivergenceThreshold, config, "adaptive_divergence_threshold");
+    policy.template Parse<int>(selfPlay.AdaptiveMinimumSimulations, config, "adaptive_minimum_simulations");
+    policy.template Parse<int>(selfPlay.AdaptiveMaximumSimulations, config, "adaptive_maximum_simulations");
+    policy.template Parse<bool>(selfPlay.AdaptiveReassignSaved, config, "adaptive_reassign_saved");
+    policy.template Parse<int>(selfPlay.MetricsIntervalSeconds, config, "metrics_interval_seconds");
+
+    policy.template Parse<float>(selfPlay.ResignValueThreshold, config, "resign_value_threshold");
+    policy.template Parse<int>(selfPlay.ResignConsecutivePlies, config, "resign_consecutive_plies");
+    policy.template Parse<bool>(selfPlay.AdjudicateTablebases, config, "adjudicate_tablebases");
+    policy.template Parse<float>(selfPlay.AdjudicationVerificationProportion, config, "adjudication_verification_proportion");
 
     policy.template Parse<float>(selfPlay.RootDirichletAlpha, config, "root_dirichlet_alpha");
     policy.template Parse<float>(selfPlay.RootExplorationFraction, config, "root_exploration_fraction");
@@ -359,6 +377,7 @@ void ParseMisc(MiscConfig& misc, const TomlValue& config, const Policy& policy)
     const auto& predictionCache = toml::find_or(config, "prediction_cache", {});
     policy.template Parse<int>(misc.PredictionCache_SizeMebibytes, predictionCache, "Hash");
     policy.template Parse<int>(misc.PredictionCache_MaxPly, predictionCache, "max_ply");
+    policy.template Parse<bool>(misc.PredictionCache_TraceProbes, predictionCache, "trace_probes");
 
     const auto& timeControl = toml::find_or(config, "time_control", {});
     policy.template Parse<int>(misc.TimeControl_SafetyBufferMoveMilliseconds, timeControl, "safety_buffer_move_milliseconds");
@@ -373,6 +392,12 @@ void ParseMisc(MiscConfig& misc, const TomlValue& config, const Policy& policy)
     policy.template Parse<int>(misc.Search_SlowstartThreads, search, "slowstart_threads");
     policy.template Parse<int>(misc.Search_SlowstartParallelism, search, "slowstart_parallelism");
     policy.template Parse<int>(misc.Search_GuiUpdateIntervalNodes, search, "gui_update_interval_nodes");
+    policy.template Parse<int>(misc.Search_TreeMemoryMebibytes, search, "tree_memory_mebibytes");
+    policy.template Parse<bool>(misc.Search_TreeStatistics, search, "tree_statistics");
+    policy.template Parse<int>(misc.Search_SyzygyWdlCacheMebibytes, search, "syzygy_wdl_cache_mebibytes");
+    policy.template Parse<bool>(misc.Search_SyzygyWarmup, search, "syzygy_warmup");
+    policy.template Parse<int>(misc.Search_SyzygyWarmupMargin, search, "syzygy_warmup_margin");
+    policy.template Parse<int>(misc.Search_SyzygyWarmupMebibytes, search, "syzygy_warmup_mebibytes");
 
     const auto& bot = toml::find_or(config, "bot", {});
     policy.template Parse<int>(misc.Bot_CommentaryMinimumRemainingMilliseconds, bot, "commentary_minimum_remaining_milliseconds");
@@ -384,6 +409,17 @@ void ParseMisc(MiscConfig& misc, const TomlValue& config, const Policy& policy)
     const auto& storage = toml::find_or(config, "storage", {});
     policy.template Parse<int>(misc.Storage_GamesPerChunk, storage, "games_per_chunk");
 
+    const auto& trace = toml::find_or(config, "trace", {});
+    policy.template Parse<bool>(misc.Trace_Enabled, trace, "trace");
+    policy.template Parse<int>(misc.Trace_BufferEvents, trace, "trace_buffer_events");
+    policy.template Parse<bool>(misc.Trace_AllocationTracking, trace, "allocation_tracking");
+    policy.template Parse<bool>(misc.Trace_HardwareCounters, trace, "hardware_counters");
+
+    const auto& metrics = toml::find_or(config, "metrics", {});
+    policy.template Parse<std::string>(misc.Metrics_ExportFile, metrics, "export_file");
+    policy.template Parse<std::string>(misc.Metrics_ExportSocket, metrics, "export_socket");
+    policy.template Parse<int>(misc.Metrics_ExportIntervalSeconds, metrics, "export_interval_seconds");
+
     const auto& paths = toml::find_or(config, "paths", {});
     policy.template Parse<std::string>(misc.Paths_Networks, paths, "networks");
     policy.template Parse<std::string>(misc.Paths_TensorBoard, paths, "tensorboard");
@@ -103,6 +103,24 @@ struct SelfPlayConfig
     int NumSampingMoves;
     int MaxMoves;
     int NumSimulations;
+    int NumSimulationsFast;
+    float FullSimulationProportion;
+    bool SimulationBudgetCountsInherited;
+    int TreeReuseMinimumSimulations;
+    float ForkProportion;
+    float ForkValueSwingThreshold;
+    bool AdaptiveSimulations;
+    int AdaptiveCheckInterval;
+    float AdaptiveDivergenceThreshold;
+    int AdaptiveMinimumSimulations;
+    int AdaptiveMaximumSimulations;
+    bool AdaptiveReassignSaved;
+    int MetricsIntervalSeconds;
+
+    float ResignValueThreshold;
+    int ResignConsecutivePlies;
+    bool AdjudicateTablebases;
+    float AdjudicationVerificationProportion;
 
     float RootDirichletAlpha;
     float RootExplorationFraction;
@@ -148,6 +166,7 @@ struct MiscConfig
     // Prediction cache
     int PredictionCache_SizeMebibytes;
     int PredictionCache_MaxPly;
+    bool PredictionCache_TraceProbes;
 
     // Time control
     int TimeControl_SafetyBufferMoveMilliseconds;
@@ -162,6 +181,12 @@ struct MiscConfig
     int Search_SlowstartThreads;
     int Search_SlowstartParallelism;
     int Search_GuiUpdateIntervalNodes;
+    int Search_TreeMemoryMebibytes;
+    bool Search_TreeStatistics;
+    int Search_SyzygyWdlCacheMebibytes;
+    bool Search_SyzygyWarmup;
+    int Search_SyzygyWarmupMargin;
+    int Search_SyzygyWarmupMebibytes;
 
     // Bot
     int Bot_CommentaryMinimumRemainingMilliseconds;
@@ -172,6 +197,17 @@ struct MiscConfig
 
     // Storage
     int Storage_GamesPerChunk;
+
+    // Trace
+    bool Trace_Enabled;
+    int Trace_BufferEvents;
+    bool Trace_AllocationTracking;
+    bool Trace_HardwareCounters;
+
+    // Metrics
+    std::string Metrics_ExportFile;
+    std::string Metrics_ExportSocket;
+    int Metrics_ExportIntervalSeconds;
     
     // Paths
     std::string Paths_Networks;
@@ -18,6 +18,7 @@
 
 #include <Stockfish/thread.h>
 
+#include "AllocationTracker.h"
 #include "Config.h"
 
 const float Game::CHESSCOACH_VALUE_SYZYGY_WIN = Game::CentipawnsToProbability(CHESSCOACH_CENTIPAWNS_WIN - CHESSCOACH_CENTIPAWNS_SYZYGY_QUANTUM);
@@ -26,15 +27,17 @@ const float Game::CHESSCOACH_VALUE_SYZYGY_LOSS = Game::CentipawnsToProbability(C
 int Game::QueenKnightPlane[256];
 Key Game::PredictionCache_IsRepetition;
 Key Game::PredictionCache_NoProgressCount[NoProgressSaturationCount + 1];
-thread_local PoolAllocator<StateInfo, Game::BlockSizeBytes> Game::StateAllocator;
+SharedPoolAllocator Game::StateAllocator("state", sizeof(StateInfo), alignof(StateInfo));
 
 StateInfo* Game::AllocateState()
 {
+    AllocationTracker::Allocate(AllocationTag_State, sizeof(StateInfo));
     return reinterpret_cast<StateInfo*>(StateAllocator.Allocate());
 }
 
 void Game::FreeState(StateInfo* state)
 {
+    AllocationTracker::Free(AllocationTag_State, sizeof(StateInfo));
     StateAllocator.Free(state);
 }
 
@@ -108,6 +111,8 @@ Game::Game(const Game& other)
     , _moves(other._moves)
 {
     assert(&other != this);
+
+    TrackMovesCapacity(0);
 }
 
 Game& Game::operator=(const Game& other)
@@ -120,7 +125,9 @@ Game& Game::operator=(const Game& other)
     _position = other._position;
     _parentState = other._currentState; // Don't delete the parent game's states.
     _currentState = other._currentState;
+    const size_t movesCapacity = _moves.capacity();
     _moves = other._moves;
+    TrackMovesCapacity(movesCapacity);
 
     return *this;
 }
@@ -147,6 +154,10 @@ Game& Game::operator=(Game&& other) noexcept
     _position = other._position;
     _parentState = other._parentState;
     _currentState = other._currentState;
+    if (_moves.capacity() > 0)
+    {
+        AllocationTracker::Free(AllocationTag_GameMoves, (_moves.capacity() * sizeof(Move)));
+    }
     _moves = std::move(other._moves);
 
     other._parentState = nullptr;
@@ -158,6 +169,12 @@ Game& Game::operator=(Game&& other) noexcept
 Game::~Game()
 {
     Free();
+
+    // The moves vector is freed after this destructor.
+    if (_moves.capacity() > 0)
+    {
+        AllocationTracker::Free(AllocationTag_GameMoves, (_moves.capacity() * sizeof(Move)));
+    }
 }
 
 Color Game::ToPlay() const
@@ -173,14 +190,18 @@ float Game::EndgameProportion() const
 
 void Game::ApplyMove(Move move)
 {
+    const size_t movesCapacity = _moves.capacity();
     _moves.push_back(move);
+    TrackMovesCapacity(movesCapacity);
     _currentState = AllocateState();
     _position.do_move(move, *_currentState);
 }
 
 void Game::ApplyMoveMaybeNull(Move move)
 {
+    const size_t movesCapacity = _moves.capacity();
     _moves.push_back(move);
+    TrackMovesCapacity(movesCapacity);
     _currentState = AllocateState();
     if (move != MOVE_NULL)
     {
@@ -584,6 +605,23 @@ void Game::Free()
     // Nodes are freed outside of Game objects because they outlive the games through MCTS tree reuse.
 }
 
+// Vectors reallocate when capacity changes, so record the old buffer as freed and the new one as allocated.
+void Game::TrackMovesCapacity(size_t previousCapacity) const
+{
+    const size_t capacity = _moves.capacity();
+    if (capacity != previousCapacity)
+    {
+        if (previousCapacity > 0)
+        {
+            AllocationTracker::Free(AllocationTag_GameMoves, (previousCapacity * sizeof(Move)));
+        }
+        if (capacity > 0)
+        {
+            AllocationTracker::Allocate(AllocationTag_GameMoves, (capacity * sizeof(Move)));
+        }
+    }
+}
+
 void Game::GeneratePieceAndRepetitionPlanes(INetwork::PackedPlane* imageOut, int planeOffset, const Position& position, Color perspective) const
 {
     // If it's black perspective, flip the board and flip colors.
@@ -25,7 +25,7 @@
 #include <Stockfish/position.h>
 
 #include "Network.h"
-#include "PoolAllocator.h"
+#include "SharedPoolAllocator.h"
 
 constexpr static const float CHESSCOACH_VALUE_WIN = 1.0f;
 constexpr static const float CHESSCOACH_VALUE_DRAW = 0.5f;
@@ -52,8 +52,8 @@ public:
     static const float CHESSCOACH_VALUE_SYZYGY_DRAW;
     static const float CHESSCOACH_VALUE_SYZYGY_LOSS;
 
-    static const size_t BlockSizeBytes = 64 * 1024 * 1024; // 64 MiB
-    thread_local static PoolAllocator<StateInfo, BlockSizeBytes> StateAllocator;
+    // Shared across threads, so games may be freed on any thread.
+    static SharedPoolAllocator StateAllocator;
 
     static StateInfo* AllocateState();
     static void FreeState(StateInfo* state);
@@ -205,6 +205,7 @@ private:
     friend class HistoryWalker;
 
     void Free();
+    void TrackMovesCapacity(size_t previousCapacity) const;
     void GeneratePieceAndRepetitionPlanes(INetwork::PackedPlane* imageOut, int planeOffset, const Position& position, Color perspective) const;
     void FillPlane(INetwork::PackedPlane& plane, bool value) const;
     Key Rotate(Key key, unsigned int distance) const;
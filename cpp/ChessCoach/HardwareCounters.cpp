@@ -0,0 +1,345 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "HardwareCounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "Platform.h"
+#include "Threading.h"
+
+#ifndef CHESSCOACH_WINDOWS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Counts accumulate across the threads that own the buffer in turn.
+struct CounterBuffer
+{
+    struct AtomicPhaseCounts
+    {
+        std::atomic_int64_t scopeCount;
+        std::array<std::atomic_int64_t, HardwareCounter_Count> values;
+        std::atomic_int64_t enabledNanoseconds;
+        std::atomic_int64_t runningNanoseconds;
+    };
+
+    explicit CounterBuffer(int setThreadId)
+        : threadId(setThreadId)
+        , phases{}
+        , owned(false)
+    {
+    }
+
+    const int threadId;
+    std::array<AtomicPhaseCounts, CounterPhase_Count> phases;
+    std::atomic_bool owned;
+};
+
+// The registry's mutex also guards support and availability across threads.
+static ThreadBufferRegistry<CounterBuffer> CounterBuffers;
+static std::array<bool, HardwareCounter_Count> CounterSupported{};
+static std::string CounterUnavailableReason = "no counters sampled";
+
+// Opens the calling thread's counter group on first use, claiming a buffer that's released
+// for reuse by later threads when it exits.
+struct ThreadCounters
+{
+    bool opened = false;
+    int groupFd = -1;
+    std::array<int, HardwareCounter_Count> fds = { -1, -1, -1, -1 };
+    std::array<int, HardwareCounter_Count> readIndices = { -1, -1, -1, -1 };
+    int readCount = 0;
+    ThreadBuffer<CounterBuffer> buffer;
+
+    ~ThreadCounters()
+    {
+#ifndef CHESSCOACH_WINDOWS
+        for (const int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+#endif
+    }
+
+    void Open();
+};
+
+thread_local static ThreadCounters ThreadCounterGroup;
+
+void ThreadCounters::Open()
+{
+    opened = true;
+
+#ifdef CHESSCOACH_WINDOWS
+    std::lock_guard lock(CounterBuffers.Mutex());
+    CounterUnavailableReason = "perf_event_open is only available on Linux";
+    return;
+#else
+    constexpr uint64_t Configs[HardwareCounter_Count] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    static_assert(HardwareCounter_Count == 4);
+
+    // Count user-space work on this thread only, on any CPU, reading the whole group at once.
+    // The first counter to open leads the group, and later ones that fail are skipped.
+    int lastErrno = 0;
+    for (int i = 0; i < HardwareCounter_Count; i++)
+    {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = Configs[i];
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = (PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING);
+
+        const int fd = static_cast<int>(::syscall(__NR_perf_event_open, &attributes, 0 /* pid: this thread */, -1 /* cpu: any */,
+            groupFd, 0 /* flags */));
+        if (fd < 0)
+        {
+            lastErrno = errno;
+            continue;
+        }
+        fds[i] = fd;
+        if (groupFd < 0)
+        {
+            groupFd = fd;
+        }
+        readIndices[i] = readCount++;
+    }
+
+    std::lock_guard lock(CounterBuffers.Mutex());
+    if (groupFd < 0)
+    {
+        CounterUnavailableReason = (std::string("perf_event_open failed: ") + std::strerror(lastErrno)
+            + ((lastErrno == EACCES) ? " (check /proc/sys/kernel/perf_event_paranoid)" : ""));
+        return;
+    }
+    for (int i = 0; i < HardwareCounter_Count; i++)
+    {
+        CounterSupported[i] = (CounterSupported[i] || (fds[i] >= 0));
+    }
+
+    buffer.GetLocked(CounterBuffers, [](int threadId) { return new CounterBuffer(threadId); });
+#endif
+}
+
+void CounterPhaseCounts::Add(const CounterPhaseCounts& other)
+{
+    scopeCount += other.scopeCount;
+    for (int i = 0; i < HardwareCounter_Count; i++)
+    {
+        values[i] += other.values[i];
+    }
+    enabledNanoseconds += other.enabledNanoseconds;
+    runningNanoseconds += other.runningNanoseconds;
+}
+
+CounterPhaseCounts CounterPhaseCounts::Since(const CounterPhaseCounts& previous) const
+{
+    CounterPhaseCounts since = *this;
+    since.scopeCount -= previous.scopeCount;
+    for (int i = 0; i < HardwareCounter_Count; i++)
+    {
+        since.values[i] -= previous.values[i];
+    }
+    since.enabledNanoseconds -= previous.enabledNanoseconds;
+    since.runningNanoseconds -= previous.runningNanoseconds;
+    return since;
+}
+
+double CounterPhaseCounts::Scaled(HardwareCounter counter) const
+{
+    const double value = static_cast<double>(values[counter]);
+    return ((runningNanoseconds > 0) ? (value * enabledNanoseconds / runningNanoseconds) : value);
+}
+
+std::atomic_bool HardwareCounters::EnabledFlag(false);
+
+void HardwareCounters::SetEnabled(bool enabled)
+{
+    EnabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+bool HardwareCounters::Read(HardwareCounterReading& valuesOut)
+{
+    ThreadCounters& counters = ThreadCounterGroup;
+    if (!counters.opened)
+    {
+        counters.Open();
+    }
+    if (counters.groupFd < 0)
+    {
+        return false;
+    }
+
+#ifdef CHESSCOACH_WINDOWS
+    return false;
+#else
+    // Layout with PERF_FORMAT_GROUP: count, time enabled, time running, then values in group order.
+    uint64_t data[3 + HardwareCounter_Count];
+    const ssize_t bytesRead = ::read(counters.groupFd, data, sizeof(data));
+    if (bytesRead < static_cast<ssize_t>((3 + counters.readCount) * sizeof(uint64_t)))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < HardwareCounter_Count; i++)
+    {
+        const int index = counters.readIndices[i];
+        valuesOut[i] = ((index >= 0) ? static_cast<int64_t>(data[3 + index]) : 0);
+    }
+    valuesOut[HardwareCounter_Count + 0] = static_cast<int64_t>(data[1]);
+    valuesOut[HardwareCounter_Count + 1] = static_cast<int64_t>(data[2]);
+    return true;
+#endif
+}
+
+void HardwareCounters::Record(CounterPhase phase, const HardwareCounterReading& start, const HardwareCounterReading& end)
+{
+    CounterBuffer::AtomicPhaseCounts& counts = ThreadCounterGroup.buffer.Get()->phases[phase];
+    IncrementOwned(counts.scopeCount);
+    for (int i = 0; i < HardwareCounter_Count; i++)
+    {
+        IncrementOwned(counts.values[i], (end[i] - start[i]));
+    }
+    IncrementOwned(counts.enabledNanoseconds, (end[HardwareCounter_Count + 0] - start[HardwareCounter_Count + 0]));
+    IncrementOwned(counts.runningNanoseconds, (end[HardwareCounter_Count + 1] - start[HardwareCounter_Count + 1]));
+}
+
+HardwareCounterSnapshot HardwareCounters::Take()
+{
+    HardwareCounterSnapshot snapshot{};
+
+    std::lock_guard lock(CounterBuffers.Mutex());
+    snapshot.supported = CounterSupported;
+    snapshot.unavailableReason = CounterUnavailableReason;
+    for (const auto& buffer : CounterBuffers.Buffers())
+    {
+        HardwareCounterThreadSnapshot& thread = snapshot.threads.emplace_back();
+        thread.threadId = buffer->threadId;
+        for (int i = 0; i < CounterPhase_Count; i++)
+        {
+            const CounterBuffer::AtomicPhaseCounts& counts = buffer->phases[i];
+            CounterPhaseCounts& phase = thread.phases[i];
+            phase.scopeCount = counts.scopeCount.load(std::memory_order_relaxed);
+            for (int j = 0; j < HardwareCounter_Count; j++)
+            {
+                phase.values[j] = counts.values[j].load(std::memory_order_relaxed);
+            }
+            phase.enabledNanoseconds = counts.enabledNanoseconds.load(std::memory_order_relaxed);
+            phase.runningNanoseconds = counts.runningNanoseconds.load(std::memory_order_relaxed);
+            snapshot.phases[i].Add(phase);
+        }
+    }
+    return snapshot;
+}
+
+std::vector<std::string> HardwareCounters::Describe(const HardwareCounterSnapshot& current, const HardwareCounterSnapshot& previous)
+{
+    // Show raw counts, then instructions per cycle and misses per thousand instructions.
+    const auto describe = [&](std::ostream& line, const CounterPhaseCounts& counts)
+    {
+        for (int i = 0; i < HardwareCounter_Count; i++)
+        {
+            line << " " << HardwareCounterKeys[i] << " ";
+            if (current.supported[i])
+            {
+                line << static_cast<int64_t>(counts.Scaled(static_cast<HardwareCounter>(i)));
+            }
+            else
+            {
+                line << "n/a";
+            }
+        }
+
+        const double cycles = counts.Scaled(HardwareCounter_Cycles);
+        const double instructions = counts.Scaled(HardwareCounter_Instructions);
+        if (current.supported[HardwareCounter_Cycles] && current.supported[HardwareCounter_Instructions] && (cycles > 0))
+        {
+            line << " ipc " << (instructions / cycles);
+        }
+        if (current.supported[HardwareCounter_Instructions] && (instructions > 0))
+        {
+            if (current.supported[HardwareCounter_CacheMisses])
+            {
+                line << " llc_mpki " << (1000.0 * counts.Scaled(HardwareCounter_CacheMisses) / instructions);
+            }
+            if (current.supported[HardwareCounter_BranchMisses])
+            {
+                line << " branch_mpki " << (1000.0 * counts.Scaled(HardwareCounter_BranchMisses) / instructions);
+            }
+        }
+    };
+
+    std::vector<std::string> lines;
+    for (int i = 0; i < CounterPhase_Count; i++)
+    {
+        const CounterPhaseCounts counts = current.phases[i].Since(previous.phases[i]);
+        if (counts.scopeCount <= 0)
+        {
+            continue;
+        }
+
+        std::stringstream line;
+        line << std::fixed << std::setprecision(3) << "counters " << CounterPhaseKeys[i] << " scopes " << counts.scopeCount;
+        describe(line, counts);
+        lines.push_back(line.str());
+    }
+    if (lines.empty())
+    {
+        lines.push_back("counters unavailable: " + current.unavailableReason);
+        return lines;
+    }
+
+    // Threads may be new since the previous snapshot.
+    for (const HardwareCounterThreadSnapshot& thread : current.threads)
+    {
+        const HardwareCounterThreadSnapshot* previousThread = nullptr;
+        for (const HardwareCounterThreadSnapshot& candidate : previous.threads)
+        {
+            if (candidate.threadId == thread.threadId)
+            {
+                previousThread = &candidate;
+                break;
+            }
+        }
+
+        for (int i = 0; i < CounterPhase_Count; i++)
+        {
+            const CounterPhaseCounts counts = (previousThread ? thread.phases[i].Since(previousThread->phases[i]) : thread.phases[i]);
+            if (counts.scopeCount <= 0)
+            {
+                continue;
+            }
+
+            std::stringstream line;
+            line << std::fixed << std::setprecision(3) << "counters thread " << thread.threadId << " " << CounterPhaseKeys[i]
+                << " scopes " << counts.scopeCount;
+            describe(line, counts);
+            lines.push_back(line.str());
+        }
+    }
+    return lines;
+}
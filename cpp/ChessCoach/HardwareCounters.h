@@ -0,0 +1,150 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _HARDWARECOUNTERS_H_
+#define _HARDWARECOUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Search phases measured. Scopes are inclusive, so image generation also counts towards expansion.
+enum CounterPhase
+{
+    CounterPhase_Selection,
+    CounterPhase_Expansion,
+    CounterPhase_Backpropagation,
+    CounterPhase_ImageGeneration,
+
+    CounterPhase_Count,
+};
+constexpr const char* CounterPhaseKeys[CounterPhase_Count] = { "selection", "expansion", "backpropagation", "image_generation" };
+static_assert(CounterPhase_Count == 4);
+
+enum HardwareCounter
+{
+    HardwareCounter_Cycles,
+    HardwareCounter_Instructions,
+    HardwareCounter_CacheMisses, // Last-level cache
+    HardwareCounter_BranchMisses,
+
+    HardwareCounter_Count,
+};
+constexpr const char* HardwareCounterKeys[HardwareCounter_Count] = { "cycles", "instructions", "llc_misses", "branch_misses" };
+static_assert(HardwareCounter_Count == 4);
+
+struct CounterPhaseCounts
+{
+    int64_t scopeCount;
+    std::array<int64_t, HardwareCounter_Count> values;
+    int64_t enabledNanoseconds;
+    int64_t runningNanoseconds;
+
+    void Add(const CounterPhaseCounts& other);
+    CounterPhaseCounts Since(const CounterPhaseCounts& previous) const;
+
+    // Scales up for time lost to multiplexing when more events are requested than the PMU has counters.
+    double Scaled(HardwareCounter counter) const;
+};
+
+// Counter values, then nanoseconds enabled and running.
+using HardwareCounterReading = std::array<int64_t, HardwareCounter_Count + 2>;
+
+using CounterPhaseCountsArray = std::array<CounterPhaseCounts, CounterPhase_Count>;
+
+struct HardwareCounterThreadSnapshot
+{
+    int threadId;
+    CounterPhaseCountsArray phases;
+};
+
+struct HardwareCounterSnapshot
+{
+    CounterPhaseCountsArray phases; // Totals across threads
+    std::array<bool, HardwareCounter_Count> supported;
+    std::vector<HardwareCounterThreadSnapshot> threads;
+    std::string unavailableReason;
+};
+
+// Optional hardware performance counters (cycles, instructions, LLC misses, branch misses) per search thread
+// and phase via Linux "perf_event_open", to show whether cache misses and branch mispredictions dominate search
+// on big trees. Sampling is off unless enabled via the "hardware_counters" config key or UCI option, leaving a
+// relaxed load per scope; when on, each scope costs two reads of the thread's counter group. Counters that can't
+// be opened (other platforms, "perf_event_paranoid", virtual machines) are reported as unavailable.
+class HardwareCounters
+{
+public:
+
+    static bool Enabled()
+    {
+        return EnabledFlag.load(std::memory_order_relaxed);
+    }
+
+    static void SetEnabled(bool enabled);
+
+    static HardwareCounterSnapshot Take();
+
+    // One human-readable line per active phase, then per active thread and phase, over the interval.
+    static std::vector<std::string> Describe(const HardwareCounterSnapshot& current, const HardwareCounterSnapshot& previous);
+
+private:
+
+    friend class HardwareCounterScope;
+
+    // Returns false when counters are unavailable for this thread.
+    static bool Read(HardwareCounterReading& valuesOut);
+    static void Record(CounterPhase phase, const HardwareCounterReading& start, const HardwareCounterReading& end);
+
+private:
+
+    static std::atomic_bool EnabledFlag;
+};
+
+class HardwareCounterScope
+{
+public:
+
+    explicit HardwareCounterScope(CounterPhase phase)
+        : _phase(phase)
+        , _active(HardwareCounters::Enabled() && HardwareCounters::Read(_start))
+    {
+    }
+
+    ~HardwareCounterScope()
+    {
+        if (_active)
+        {
+            HardwareCounterReading end;
+            if (HardwareCounters::Read(end))
+            {
+                HardwareCounters::Record(_phase, _start, end);
+            }
+        }
+    }
+
+    HardwareCounterScope(const HardwareCounterScope& other) = delete;
+    HardwareCounterScope& operator=(const HardwareCounterScope& other) = delete;
+
+private:
+
+    CounterPhase _phase;
+    HardwareCounterReading _start;
+    bool _active;
+};
+
+#endif // _HARDWARECOUNTERS_H_
@@ -0,0 +1,411 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Config.h"
+#include "MetricsRegistry.h"
+#include "Storage.h"
+
+LatencyHistogram::LatencyHistogram()
+    : _buckets{}
+{
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds duration)
+{
+    // Bucket N counts latencies in [2^(N-1), 2^N) microseconds, with bucket 0 for under a microsecond.
+    const int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    int bucket = 0;
+    while ((bucket < (BucketCount - 1)) && ((int64_t(1) << bucket) <= microseconds))
+    {
+        bucket++;
+    }
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::AddTo(Counts& counts) const
+{
+    for (int i = 0; i < BucketCount; i++)
+    {
+        counts[i] += _buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Returns the upper bound of the bucket containing the percentile, so resolution is within a factor of two.
+float LatencyHistogram::PercentileMilliseconds(const Counts& counts, float percentile)
+{
+    int64_t total = 0;
+    for (const int64_t count : counts)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return 0.f;
+    }
+
+    const int64_t target = static_cast<int64_t>(std::ceil(percentile * total));
+    int64_t cumulative = 0;
+    for (int i = 0; i < BucketCount; i++)
+    {
+        cumulative += counts[i];
+        if (cumulative >= target)
+        {
+            return (static_cast<float>(int64_t(1) << i) / 1000.f);
+        }
+    }
+    return (static_cast<float>(int64_t(1) << (BucketCount - 1)) / 1000.f);
+}
+
+void SelfPlayMetricsSnapshot::Take(const SelfPlayMetrics& metrics)
+{
+    gameCount = metrics.gameCount.load(std::memory_order_relaxed);
+    plyCount = metrics.plyCount.load(std::memory_order_relaxed);
+    simulationCount = metrics.simulationCount.load(std::memory_order_relaxed);
+    batchCount = metrics.batchCount.load(std::memory_order_relaxed);
+    batchSlotCount = metrics.batchSlotCount.load(std::memory_order_relaxed);
+    batchOccupiedSlotCount = metrics.batchOccupiedSlotCount.load(std::memory_order_relaxed);
+    predictionCacheProbeCount = metrics.predictionCacheProbeCount.load(std::memory_order_relaxed);
+    predictionCacheHitCount = metrics.predictionCacheHitCount.load(std::memory_order_relaxed);
+    cpuNanoseconds = metrics.cpuNanoseconds.load(std::memory_order_relaxed);
+    predictNanoseconds = metrics.predictNanoseconds.load(std::memory_order_relaxed);
+    storageNanoseconds = metrics.storageNanoseconds.load(std::memory_order_relaxed);
+    predictLatency = {};
+    metrics.predictLatency.AddTo(predictLatency);
+}
+
+void PythonCallMetricsSnapshot::Take(const PythonCallMetrics& metrics)
+{
+    callCount = metrics.callCount.load(std::memory_order_relaxed);
+    gilWaitNanoseconds = metrics.gilWaitNanoseconds.load(std::memory_order_relaxed);
+    pythonNanoseconds = metrics.pythonNanoseconds.load(std::memory_order_relaxed);
+    marshalNanoseconds = metrics.marshalNanoseconds.load(std::memory_order_relaxed);
+    gilWaitLatency = {};
+    pythonLatency = {};
+    marshalLatency = {};
+    metrics.gilWaitLatency.AddTo(gilWaitLatency);
+    metrics.pythonLatency.AddTo(pythonLatency);
+    metrics.marshalLatency.AddTo(marshalLatency);
+}
+
+PythonCallMetricsSnapshot PythonCallMetricsSnapshot::Since(const PythonCallMetricsSnapshot& previous) const
+{
+    PythonCallMetricsSnapshot delta;
+    delta.callCount = (callCount - previous.callCount);
+    delta.gilWaitNanoseconds = (gilWaitNanoseconds - previous.gilWaitNanoseconds);
+    delta.pythonNanoseconds = (pythonNanoseconds - previous.pythonNanoseconds);
+    delta.marshalNanoseconds = (marshalNanoseconds - previous.marshalNanoseconds);
+    for (int b = 0; b < LatencyHistogram::BucketCount; b++)
+    {
+        delta.gilWaitLatency[b] = (gilWaitLatency[b] - previous.gilWaitLatency[b]);
+        delta.pythonLatency[b] = (pythonLatency[b] - previous.pythonLatency[b]);
+        delta.marshalLatency[b] = (marshalLatency[b] - previous.marshalLatency[b]);
+    }
+    return delta;
+}
+
+PythonMetrics PythonMetrics::Instance;
+
+PythonMetrics::PythonMetrics()
+    : _calls{}
+{
+}
+
+void PythonMetrics::Record(PythonCall call, std::chrono::nanoseconds gilWait, std::chrono::nanoseconds python, std::chrono::nanoseconds marshal)
+{
+    PythonCallMetrics& metrics = _calls[call];
+    metrics.callCount.fetch_add(1, std::memory_order_relaxed);
+    metrics.gilWaitNanoseconds.fetch_add(gilWait.count(), std::memory_order_relaxed);
+    metrics.pythonNanoseconds.fetch_add(python.count(), std::memory_order_relaxed);
+    metrics.marshalNanoseconds.fetch_add(marshal.count(), std::memory_order_relaxed);
+    metrics.gilWaitLatency.Record(gilWait);
+    metrics.pythonLatency.Record(python);
+    metrics.marshalLatency.Record(marshal);
+}
+
+PythonMetricsSnapshot PythonMetrics::Take() const
+{
+    PythonMetricsSnapshot snapshot;
+    for (int i = 0; i < PythonCall_Count; i++)
+    {
+        snapshot[i].Take(_calls[i]);
+    }
+    return snapshot;
+}
+
+PythonMetricsSnapshot PythonMetrics::Since(const PythonMetricsSnapshot& current, const PythonMetricsSnapshot& previous)
+{
+    PythonMetricsSnapshot delta;
+    for (int i = 0; i < PythonCall_Count; i++)
+    {
+        delta[i] = current[i].Since(previous[i]);
+    }
+    return delta;
+}
+
+std::vector<std::string> PythonMetrics::Describe(const PythonMetricsSnapshot& snapshot)
+{
+    std::vector<std::string> lines;
+    for (int i = 0; i < PythonCall_Count; i++)
+    {
+        const PythonCallMetricsSnapshot& call = snapshot[i];
+        if (call.callCount <= 0)
+        {
+            continue;
+        }
+
+        // Show totals in milliseconds, then p50/p99 per call (bucket upper bounds).
+        const auto describe = [](const char* name, int64_t nanoseconds, const LatencyHistogram::Counts& latency)
+        {
+            std::stringstream part;
+            part << std::fixed << std::setprecision(3) << " " << name << " " << (nanoseconds / 1000000.0) << " ms"
+                << " (p50 " << LatencyHistogram::PercentileMilliseconds(latency, 0.5f)
+                << " p99 " << LatencyHistogram::PercentileMilliseconds(latency, 0.99f) << ")";
+            return part.str();
+        };
+        std::stringstream line;
+        line << "python " << PythonCallKeys[i] << " calls " << call.callCount
+            << describe("gil_wait", call.gilWaitNanoseconds, call.gilWaitLatency)
+            << describe("python", call.pythonNanoseconds, call.pythonLatency)
+            << describe("marshal", call.marshalNanoseconds, call.marshalLatency);
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+SelfPlayMetricsWriter::SelfPlayMetricsWriter(std::vector<const SelfPlayMetrics*> workerMetrics)
+    : _workerMetrics(std::move(workerMetrics))
+    , _previous(_workerMetrics.size())
+    , _previousTime(std::chrono::high_resolution_clock::now())
+    , _path(Storage::MakeLocalPath(Config::Misc.Paths_Logs) / "self_play_metrics.jsonl")
+    , _previousPython(PythonMetrics::Instance.Take())
+{
+    for (int i = 0; i < _workerMetrics.size(); i++)
+    {
+        _previous[i].Take(*_workerMetrics[i]);
+    }
+
+    // Sample totals across workers for live export.
+    const auto total = [this](std::atomic_int64_t SelfPlayMetrics::* counter)
+    {
+        return [this, counter]()
+        {
+            int64_t sum = 0;
+            for (const SelfPlayMetrics* metrics : _workerMetrics)
+            {
+                sum += (metrics->*counter).load(std::memory_order_relaxed);
+            }
+            return static_cast<double>(sum);
+        };
+    };
+    MetricsRegistry& registry = MetricsRegistry::Instance;
+    _registrations.push_back(registry.AddCallback("chesscoach_self_play_games_total", "Self-play games finished", MetricType_Counter,
+        total(&SelfPlayMetrics::gameCount)));
+    _registrations.push_back(registry.AddCallback("chesscoach_self_play_positions_total", "Self-play positions played", MetricType_Counter,
+        total(&SelfPlayMetrics::plyCount)));
+    _registrations.push_back(registry.AddCallback("chesscoach_self_play_simulations_total", "Self-play MCTS simulations", MetricType_Counter,
+        total(&SelfPlayMetrics::simulationCount)));
+    _registrations.push_back(registry.AddHistogramCallback("chesscoach_self_play_predict_batch_seconds", "Self-play prediction batch latency, including the GIL",
+        [this]()
+        {
+            MetricHistogramValue value{};
+            for (const SelfPlayMetrics* metrics : _workerMetrics)
+            {
+                metrics->predictLatency.AddTo(value.counts);
+                value.sumNanoseconds += metrics->predictNanoseconds.load(std::memory_order_relaxed);
+            }
+            return value;
+        }));
+}
+
+SelfPlayMetricsWriter::~SelfPlayMetricsWriter()
+{
+    for (const int registration : _registrations)
+    {
+        MetricsRegistry::Instance.Remove(registration);
+    }
+}
+
+void SelfPlayMetricsWriter::WriteIfDue(INetwork* network, int step, int gameCount)
+{
+    const float elapsedSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - _previousTime).count();
+    if (elapsedSeconds >= Config::Network.SelfPlay.MetricsIntervalSeconds)
+    {
+        Write(network, step, gameCount);
+    }
+}
+
+void SelfPlayMetricsWriter::Write(INetwork* network, int step, int gameCount)
+{
+    const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+    const float elapsedSeconds = std::chrono::duration<float>(now - _previousTime).count();
+    if (elapsedSeconds <= 0.f)
+    {
+        return;
+    }
+
+    // Calculate deltas per worker and in total over the interval.
+    SelfPlayMetricsSnapshot total{};
+    std::vector<SelfPlayMetricsSnapshot> deltas(_workerMetrics.size());
+    for (int i = 0; i < _workerMetrics.size(); i++)
+    {
+        SelfPlayMetricsSnapshot current;
+        current.Take(*_workerMetrics[i]);
+        SelfPlayMetricsSnapshot& delta = deltas[i];
+        const SelfPlayMetricsSnapshot& previous = _previous[i];
+        delta.gameCount = (current.gameCount - previous.gameCount);
+        delta.plyCount = (current.plyCount - previous.plyCount);
+        delta.simulationCount = (current.simulationCount - previous.simulationCount);
+        delta.batchCount = (current.batchCount - previous.batchCount);
+        delta.batchSlotCount = (current.batchSlotCount - previous.batchSlotCount);
+        delta.batchOccupiedSlotCount = (current.batchOccupiedSlotCount - previous.batchOccupiedSlotCount);
+        delta.predictionCacheProbeCount = (current.predictionCacheProbeCount - previous.predictionCacheProbeCount);
+        delta.predictionCacheHitCount = (current.predictionCacheHitCount - previous.predictionCacheHitCount);
+        delta.cpuNanoseconds = (current.cpuNanoseconds - previous.cpuNanoseconds);
+        delta.predictNanoseconds = (current.predictNanoseconds - previous.predictNanoseconds);
+        delta.storageNanoseconds = (current.storageNanoseconds - previous.storageNanoseconds);
+        for (int b = 0; b < LatencyHistogram::BucketCount; b++)
+        {
+            delta.predictLatency[b] = (current.predictLatency[b] - previous.predictLatency[b]);
+            total.predictLatency[b] += delta.predictLatency[b];
+        }
+
+        total.gameCount += delta.gameCount;
+        total.plyCount += delta.plyCount;
+        total.simulationCount += delta.simulationCount;
+        total.batchCount += delta.batchCount;
+        total.batchSlotCount += delta.batchSlotCount;
+        total.batchOccupiedSlotCount += delta.batchOccupiedSlotCount;
+        total.predictionCacheProbeCount += delta.predictionCacheProbeCount;
+        total.predictionCacheHitCount += delta.predictionCacheHitCount;
+        total.cpuNanoseconds += delta.cpuNanoseconds;
+        total.predictNanoseconds += delta.predictNanoseconds;
+        total.storageNanoseconds += delta.storageNanoseconds;
+
+        _previous[i] = current;
+    }
+    _previousTime = now;
+
+    // Calculate Python call deltas over the interval, across all threads (including non-workers).
+    const PythonMetricsSnapshot currentPython = PythonMetrics::Instance.Take();
+    const PythonMetricsSnapshot python = PythonMetrics::Since(currentPython, _previousPython);
+    int64_t pythonGilWaitNanoseconds = 0;
+    int64_t pythonMarshalNanoseconds = 0;
+    int64_t pythonTotalNanoseconds = 0;
+    for (int i = 0; i < PythonCall_Count; i++)
+    {
+        pythonGilWaitNanoseconds += python[i].gilWaitNanoseconds;
+        pythonMarshalNanoseconds += python[i].marshalNanoseconds;
+        pythonTotalNanoseconds += (python[i].gilWaitNanoseconds + python[i].pythonNanoseconds + python[i].marshalNanoseconds);
+    }
+    _previousPython = currentPython;
+
+    const auto fraction = [](int64_t part, int64_t whole) { return ((whole > 0) ? (static_cast<float>(part) / whole) : 0.f); };
+    const std::vector<std::string> names =
+    {
+        "self_play/games_per_hour",
+        "self_play/positions_per_second",
+        "self_play/simulations_per_second",
+        "self_play/prediction_cache_hit_rate",
+        "self_play/batch_occupancy",
+        "self_play/predict_latency_p50_ms",
+        "self_play/predict_latency_p90_ms",
+        "self_play/predict_latency_p99_ms",
+        "self_play/cpu_fraction",
+        "self_play/predict_fraction",
+        "self_play/storage_fraction",
+        "self_play/python_gil_wait_fraction",
+        "self_play/python_marshal_fraction",
+        "self_play/predict_gil_wait_p99_ms",
+    };
+    std::vector<float> values =
+    {
+        (total.gameCount * 3600.f / elapsedSeconds),
+        (total.plyCount / elapsedSeconds),
+        (total.simulationCount / elapsedSeconds),
+        fraction(total.predictionCacheHitCount, total.predictionCacheProbeCount),
+        fraction(total.batchOccupiedSlotCount, total.batchSlotCount),
+        LatencyHistogram::PercentileMilliseconds(total.predictLatency, 0.5f),
+        LatencyHistogram::PercentileMilliseconds(total.predictLatency, 0.9f),
+        LatencyHistogram::PercentileMilliseconds(total.predictLatency, 0.99f),
+        fraction(total.cpuNanoseconds, total.cpuNanoseconds + total.predictNanoseconds),
+        fraction(total.predictNanoseconds, total.cpuNanoseconds + total.predictNanoseconds),
+        fraction(total.storageNanoseconds, total.cpuNanoseconds + total.predictNanoseconds),
+        fraction(pythonGilWaitNanoseconds, pythonTotalNanoseconds),
+        fraction(pythonMarshalNanoseconds, pythonTotalNanoseconds),
+        LatencyHistogram::PercentileMilliseconds(python[PythonCall_PredictBatch].gilWaitLatency, 0.99f),
+    };
+    assert(names.size() == values.size());
+
+    // Expose the interval's values for live export, e.g. "chesscoach_self_play_games_per_hour".
+    for (int i = 0; i < names.size(); i++)
+    {
+        std::string name = ("chesscoach_" + names[i]);
+        std::replace(name.begin(), name.end(), '/', '_');
+        MetricsRegistry::Instance.Gauge(name, "Self-play over the last metrics interval").Set(values[i]);
+    }
+
+    // Append a JSON line, including the CPU/predict split per worker.
+    std::filesystem::create_directories(_path.parent_path());
+    std::ofstream file(_path, std::ios::app);
+    file << "{\"time\": " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+        << ", \"step\": " << step
+        << ", \"games\": " << gameCount
+        << ", \"interval_seconds\": " << elapsedSeconds;
+    for (int i = 0; i < names.size(); i++)
+    {
+        file << ", \"" << names[i].substr(names[i].find('/') + 1) << "\": " << values[i];
+    }
+    file << ", \"workers\": [";
+    for (int i = 0; i < deltas.size(); i++)
+    {
+        const SelfPlayMetricsSnapshot& delta = deltas[i];
+        file << ((i > 0) ? ", " : "") << "{\"games\": " << delta.gameCount
+            << ", \"positions\": " << delta.plyCount
+            << ", \"batch_occupancy\": " << fraction(delta.batchOccupiedSlotCount, delta.batchSlotCount)
+            << ", \"prediction_cache_hit_rate\": " << fraction(delta.predictionCacheHitCount, delta.predictionCacheProbeCount)
+            << ", \"cpu_fraction\": " << fraction(delta.cpuNanoseconds, delta.cpuNanoseconds + delta.predictNanoseconds) << "}";
+    }
+    file << "], \"python\": {";
+    bool firstPython = true;
+    for (int i = 0; i < PythonCall_Count; i++)
+    {
+        const PythonCallMetricsSnapshot& call = python[i];
+        if (call.callCount <= 0)
+        {
+            continue;
+        }
+        file << (firstPython ? "" : ", ") << "\"" << PythonCallKeys[i] << "\": {\"calls\": " << call.callCount
+            << ", \"gil_wait_ms\": " << (call.gilWaitNanoseconds / 1000000.0)
+            << ", \"python_ms\": " << (call.pythonNanoseconds / 1000000.0)
+            << ", \"marshal_ms\": " << (call.marshalNanoseconds / 1000000.0)
+            << ", \"gil_wait_p99_ms\": " << LatencyHistogram::PercentileMilliseconds(call.gilWaitLatency, 0.99f) << "}";
+        firstPython = false;
+    }
+    file << "}}" << std::endl;
+
+    // Log to TensorBoard against total games played so that each interval gets its own point.
+    network->LogScalars(Config::Network.SelfPlay.PredictionNetworkType, gameCount, names, values.data());
+}
@@ -0,0 +1,195 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Network.h"
+
+// Latency histogram with power-of-two microsecond buckets. Recorded by one thread and read by others.
+class LatencyHistogram
+{
+public:
+
+    static constexpr const int BucketCount = 32;
+    using Counts = std::array<int64_t, BucketCount>;
+
+public:
+
+    LatencyHistogram();
+
+    void Record(std::chrono::nanoseconds duration);
+    void AddTo(Counts& counts) const;
+
+    static float PercentileMilliseconds(const Counts& counts, float percentile);
+
+private:
+
+    std::array<std::atomic_int64_t, BucketCount> _buckets;
+};
+
+// Per-worker self-play counters, written by the worker's thread and read periodically by "SelfPlayMetricsWriter".
+struct SelfPlayMetrics
+{
+    std::atomic_int64_t gameCount;
+    std::atomic_int64_t plyCount;
+    std::atomic_int64_t simulationCount;
+    std::atomic_int64_t batchCount;
+    std::atomic_int64_t batchSlotCount;
+    std::atomic_int64_t batchOccupiedSlotCount;
+    std::atomic_int64_t predictionCacheProbeCount;
+    std::atomic_int64_t predictionCacheHitCount;
+    std::atomic_int64_t cpuNanoseconds;
+    std::atomic_int64_t predictNanoseconds;
+    std::atomic_int64_t storageNanoseconds;
+    LatencyHistogram predictLatency;
+};
+
+// Snapshot of one worker's counters, used to calculate rates over an interval.
+struct SelfPlayMetricsSnapshot
+{
+    int64_t gameCount;
+    int64_t plyCount;
+    int64_t simulationCount;
+    int64_t batchCount;
+    int64_t batchSlotCount;
+    int64_t batchOccupiedSlotCount;
+    int64_t predictionCacheProbeCount;
+    int64_t predictionCacheHitCount;
+    int64_t cpuNanoseconds;
+    int64_t predictNanoseconds;
+    int64_t storageNanoseconds;
+    LatencyHistogram::Counts predictLatency;
+
+    void Take(const SelfPlayMetrics& metrics);
+};
+
+// Calls from C++ into Python, grouped by purpose.
+enum PythonCall
+{
+    PythonCall_PredictBatch,
+    PythonCall_PredictCommentaryBatch,
+    PythonCall_Train,
+    PythonCall_LogScalars,
+    PythonCall_SaveNetwork,
+    PythonCall_UpdateNetworkWeights,
+    PythonCall_GetNetworkInfo,
+    PythonCall_FileIo,
+    PythonCall_Gui,
+    PythonCall_OptimizeParameters, // Whole optimization runs
+    PythonCall_RunBot, // Whole bot sessions, potentially hours
+    PythonCall_PlayBotMove,
+    PythonCall_Debug,
+    PythonCall_Other,
+
+    PythonCall_Count,
+};
+constexpr const char* PythonCallKeys[PythonCall_Count] = { "predict_batch", "predict_commentary_batch", "train", "log_scalars",
+    "save_network", "update_network_weights", "get_network_info", "file_io", "gui", "optimize_parameters", "run_bot",
+    "play_bot_move", "debug", "other" };
+static_assert(PythonCall_Count == 14);
+
+// Per-call-type time spent waiting for the GIL, executing Python functions, and holding the GIL otherwise
+// (marshalling between C++ and numpy). Recorded by whichever thread holds the GIL, so writes don't contend.
+struct PythonCallMetrics
+{
+    std::atomic_int64_t callCount;
+    std::atomic_int64_t gilWaitNanoseconds;
+    std::atomic_int64_t pythonNanoseconds;
+    std::atomic_int64_t marshalNanoseconds;
+    LatencyHistogram gilWaitLatency;
+    LatencyHistogram pythonLatency;
+    LatencyHistogram marshalLatency;
+};
+
+struct PythonCallMetricsSnapshot
+{
+    int64_t callCount;
+    int64_t gilWaitNanoseconds;
+    int64_t pythonNanoseconds;
+    int64_t marshalNanoseconds;
+    LatencyHistogram::Counts gilWaitLatency;
+    LatencyHistogram::Counts pythonLatency;
+    LatencyHistogram::Counts marshalLatency;
+
+    void Take(const PythonCallMetrics& metrics);
+    PythonCallMetricsSnapshot Since(const PythonCallMetricsSnapshot& previous) const;
+};
+
+using PythonMetricsSnapshot = std::array<PythonCallMetricsSnapshot, PythonCall_Count>;
+
+// Process-wide Python call metrics, surfaced via the UCI "pythonstats" command and self-play metrics,
+// to show whether GIL contention or marshalling justify moving inference out of process or native.
+class PythonMetrics
+{
+public:
+
+    static PythonMetrics Instance;
+
+public:
+
+    PythonMetrics();
+
+    void Record(PythonCall call, std::chrono::nanoseconds gilWait, std::chrono::nanoseconds python, std::chrono::nanoseconds marshal);
+    PythonMetricsSnapshot Take() const;
+
+    static PythonMetricsSnapshot Since(const PythonMetricsSnapshot& current, const PythonMetricsSnapshot& previous);
+
+    // One human-readable line per call type that was made at least once.
+    static std::vector<std::string> Describe(const PythonMetricsSnapshot& snapshot);
+
+private:
+
+    std::array<PythonCallMetrics, PythonCall_Count> _calls;
+};
+
+// Periodically aggregates self-play metrics across this machine's workers over each interval, appending
+// a JSON line to a local file and logging scalars to TensorBoard against total games played, since the network step
+// doesn't advance while playing. Pass the total across sessions (see "Storage::TotalGameCount") so that steps
+// keep increasing when the process restarts. The split between CPU work and "PredictBatch"
+// per worker shows whether a machine is CPU-bound or device-bound. Totals and the latest interval's values
+// are also exposed via "MetricsRegistry" while the writer exists.
+class SelfPlayMetricsWriter
+{
+public:
+
+    SelfPlayMetricsWriter(std::vector<const SelfPlayMetrics*> workerMetrics);
+    ~SelfPlayMetricsWriter();
+
+    SelfPlayMetricsWriter(const SelfPlayMetricsWriter& other) = delete;
+    SelfPlayMetricsWriter& operator=(const SelfPlayMetricsWriter& other) = delete;
+
+    void WriteIfDue(INetwork* network, int step, int gameCount);
+    void Write(INetwork* network, int step, int gameCount);
+
+private:
+
+    std::vector<const SelfPlayMetrics*> _workerMetrics;
+    std::vector<SelfPlayMetricsSnapshot> _previous;
+    std::chrono::time_point<std::chrono::high_resolution_clock> _previousTime;
+    std::filesystem::path _path;
+    PythonMetricsSnapshot _previousPython;
+    std::vector<int> _registrations;
+};
+
+#endif // _METRICS_H_
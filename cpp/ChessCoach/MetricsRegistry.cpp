@@ -0,0 +1,431 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "MetricsRegistry.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "AllocationTracker.h"
+#include "Platform.h"
+#include "PredictionCache.h"
+#include "SelfPlay.h"
+#include "SyzygyWarmup.h"
+
+#ifndef CHESSCOACH_WINDOWS
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+MetricsRegistry MetricsRegistry::Instance;
+MetricsExporter MetricsExporter::Instance;
+
+int64_t MetricCounter::Value() const
+{
+    return _value.load(std::memory_order_relaxed);
+}
+
+double MetricGauge::Value() const
+{
+    return _value.load(std::memory_order_relaxed);
+}
+
+void MetricHistogram::Record(std::chrono::nanoseconds duration)
+{
+    _histogram.Record(duration);
+    _sumNanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+MetricHistogramValue MetricHistogram::Value() const
+{
+    MetricHistogramValue value{};
+    _histogram.AddTo(value.counts);
+    value.sumNanoseconds = _sumNanoseconds.load(std::memory_order_relaxed);
+    return value;
+}
+
+MetricsRegistry::Family& MetricsRegistry::FindOrAdd(const std::string& name, const std::string& help, MetricType type)
+{
+    // Caller holds "_mutex".
+    for (const auto& family : _families)
+    {
+        if (family->name == name)
+        {
+            if (family->type != type)
+            {
+                throw ChessCoachException("Metric registered with conflicting types: " + name);
+            }
+            return *family;
+        }
+    }
+
+    _families.emplace_back(new Family{ _nextHandle++, name, help, type, nullptr, nullptr, nullptr, nullptr, nullptr });
+    return *_families.back();
+}
+
+MetricCounter& MetricsRegistry::Counter(const std::string& name, const std::string& help)
+{
+    std::lock_guard lock(_mutex);
+    Family& family = FindOrAdd(name, help, MetricType_Counter);
+    if (!family.counter)
+    {
+        family.counter.reset(new MetricCounter());
+    }
+    return *family.counter;
+}
+
+MetricGauge& MetricsRegistry::Gauge(const std::string& name, const std::string& help)
+{
+    std::lock_guard lock(_mutex);
+    Family& family = FindOrAdd(name, help, MetricType_Gauge);
+    if (!family.gauge)
+    {
+        family.gauge.reset(new MetricGauge());
+    }
+    return *family.gauge;
+}
+
+MetricHistogram& MetricsRegistry::Histogram(const std::string& name, const std::string& help)
+{
+    std::lock_guard lock(_mutex);
+    Family& family = FindOrAdd(name, help, MetricType_Histogram);
+    if (!family.histogram)
+    {
+        family.histogram.reset(new MetricHistogram());
+    }
+    return *family.histogram;
+}
+
+int MetricsRegistry::AddCallback(const std::string& name, const std::string& help, MetricType type, ValueCallback callback)
+{
+    assert(type != MetricType_Histogram);
+
+    std::lock_guard lock(_mutex);
+    Family& family = FindOrAdd(name, help, type);
+    family.valueCallback = std::move(callback);
+    return family.handle;
+}
+
+int MetricsRegistry::AddHistogramCallback(const std::string& name, const std::string& help, HistogramCallback callback)
+{
+    std::lock_guard lock(_mutex);
+    Family& family = FindOrAdd(name, help, MetricType_Histogram);
+    family.histogramCallback = std::move(callback);
+    return family.handle;
+}
+
+void MetricsRegistry::Remove(int handle)
+{
+    std::lock_guard lock(_mutex);
+    for (auto family = _families.begin(); family != _families.end(); ++family)
+    {
+        if ((*family)->handle == handle)
+        {
+            _families.erase(family);
+            return;
+        }
+    }
+}
+
+std::string MetricsRegistry::Render() const
+{
+    std::stringstream text;
+    text << std::setprecision(15); // Enough for exact microsecond bucket bounds without binary noise
+
+    std::lock_guard lock(_mutex);
+    for (const auto& family : _families)
+    {
+        text << "# HELP " << family->name << " " << family->help << "\n"
+            << "# TYPE " << family->name << " " << MetricTypeKeys[family->type] << "\n";
+
+        if (family->type == MetricType_Histogram)
+        {
+            const MetricHistogramValue value = (family->histogram ? family->histogram->Value() :
+                family->histogramCallback ? family->histogramCallback() : MetricHistogramValue{});
+
+            // Bucket N holds [2^(N-1), 2^N) microseconds, so its cumulative upper bound is 2^N microseconds.
+            // The last bucket is open-ended and only contributes to "+Inf".
+            int64_t cumulative = 0;
+            for (int i = 0; i < (LatencyHistogram::BucketCount - 1); i++)
+            {
+                cumulative += value.counts[i];
+                text << family->name << "_bucket{le=\"" << (static_cast<double>(int64_t(1) << i) / 1000000.0) << "\"} " << cumulative << "\n";
+            }
+            cumulative += value.counts[LatencyHistogram::BucketCount - 1];
+            text << family->name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+                << family->name << "_sum " << (value.sumNanoseconds / 1000000000.0) << "\n"
+                << family->name << "_count " << cumulative << "\n";
+        }
+        else
+        {
+            const double value = (family->counter ? static_cast<double>(family->counter->Value()) :
+                family->gauge ? family->gauge->Value() :
+                family->valueCallback ? family->valueCallback() : 0.0);
+            text << family->name << " " << value << "\n";
+        }
+    }
+    return text.str();
+}
+
+static MetricHistogramValue PythonLatency(PythonCall call, bool gilWait)
+{
+    const PythonCallMetricsSnapshot snapshot = PythonMetrics::Instance.Take()[call];
+    return (gilWait ? MetricHistogramValue{ snapshot.gilWaitLatency, snapshot.gilWaitNanoseconds }
+        : MetricHistogramValue{ snapshot.pythonLatency, snapshot.pythonNanoseconds });
+}
+
+static int64_t ResidentBytes()
+{
+#ifdef CHESSCOACH_WINDOWS
+    return 0;
+#else
+    // Fields are total program size and resident set size, in pages.
+    std::ifstream statm("/proc/self/statm");
+    int64_t sizePages = 0;
+    int64_t residentPages = 0;
+    statm >> sizePages >> residentPages;
+    return (residentPages * ::sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Samplers for process-wide statistics already kept elsewhere. Search, self-play and storage feed the registry directly.
+static void RegisterProcessMetrics()
+{
+    MetricsRegistry& registry = MetricsRegistry::Instance;
+
+    registry.AddCallback("chesscoach_prediction_cache_hit_ratio", "Prediction cache hits per probe since the last reset",
+        MetricType_Gauge, []() { return (PredictionCache::Instance.PermilleHits() / 1000.0); });
+    registry.AddCallback("chesscoach_prediction_cache_eviction_ratio", "Prediction cache evictions per probe since the last reset",
+        MetricType_Gauge, []() { return (PredictionCache::Instance.PermilleEvictions() / 1000.0); });
+    registry.AddCallback("chesscoach_prediction_cache_full_ratio", "Prediction cache entries used per capacity",
+        MetricType_Gauge, []() { return (PredictionCache::Instance.PermilleFull() / 1000.0); });
+
+    registry.AddCallback("chesscoach_network_predict_batch_calls_total", "Prediction batches sent to the network",
+        MetricType_Counter, []() { return static_cast<double>(PythonMetrics::Instance.Take()[PythonCall_PredictBatch].callCount); });
+    registry.AddHistogramCallback("chesscoach_network_predict_batch_seconds", "Time executing Python per prediction batch",
+        []() { return PythonLatency(PythonCall_PredictBatch, false /* gilWait */); });
+    registry.AddHistogramCallback("chesscoach_network_predict_batch_gil_wait_seconds", "Time waiting for the GIL per prediction batch",
+        []() { return PythonLatency(PythonCall_PredictBatch, true /* gilWait */); });
+
+    registry.AddCallback("chesscoach_process_resident_bytes", "Resident set size (Linux only)",
+        MetricType_Gauge, []() { return static_cast<double>(ResidentBytes()); });
+    registry.AddCallback("chesscoach_tree_nodes", "Search tree nodes currently allocated",
+        MetricType_Gauge, []() { return static_cast<double>(SelfPlayGame::TreeNodeCount()); });
+    registry.AddCallback("chesscoach_tree_bytes", "Search tree memory currently allocated, including heap overhead",
+        MetricType_Gauge, []() { return static_cast<double>(SelfPlayGame::TreeBytes()); });
+    registry.AddCallback("chesscoach_allocation_live_bytes", "Live bytes across subsystems with \"allocation_tracking\" enabled",
+        MetricType_Gauge, []()
+        {
+            int64_t liveBytes = 0;
+            for (const int64_t tagBytes : AllocationTracker::Take().liveBytes)
+            {
+                liveBytes += tagBytes;
+            }
+            return static_cast<double>(liveBytes);
+        });
+    registry.AddCallback("chesscoach_tablebase_warmup_files_total", "Tablebase files warmed for the page cache in the background",
+        MetricType_Counter, []() { return static_cast<double>(SyzygyWarmup::Instance.Stats().fileCount); });
+    registry.AddCallback("chesscoach_tablebase_warmup_requested_bytes_total", "Tablebase bytes requested for the page cache in the background (prefetch advice on Linux)",
+        MetricType_Counter, []() { return static_cast<double>(SyzygyWarmup::Instance.Stats().byteCount); });
+    registry.AddCallback("chesscoach_state_pool_bytes", "Memory held by the shared StateInfo pool",
+        MetricType_Gauge, []() { return static_cast<double>(Game::StateAllocator.Take().slabCount * SharedPoolAllocator::SlabBytes); });
+    registry.AddCallback("chesscoach_state_pool_allocations_total", "StateInfo pool allocations",
+        MetricType_Counter, []() { return static_cast<double>(Game::StateAllocator.Take().allocationCount); });
+    registry.AddCallback("chesscoach_state_pool_slabs_released_total", "StateInfo pool slabs returned to the OS",
+        MetricType_Counter, []() { return static_cast<double>(Game::StateAllocator.Take().releasedSlabCount); });
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    Stop();
+}
+
+void MetricsExporter::Start(const std::filesystem::path& file, const std::filesystem::path& socket, int intervalSeconds)
+{
+    Stop();
+
+    static std::once_flag registered;
+    std::call_once(registered, RegisterProcessMetrics);
+
+    _file = file;
+    _socket = socket;
+    _interval = std::chrono::seconds(std::max(1, intervalSeconds));
+    _stop = false;
+    if (!_socket.empty())
+    {
+        OpenSocket();
+    }
+    _thread = std::thread(&MetricsExporter::Loop, this);
+}
+
+void MetricsExporter::Stop()
+{
+    if (_thread.joinable())
+    {
+        _stop = true;
+        _thread.join();
+    }
+    CloseSocket();
+}
+
+void MetricsExporter::Loop()
+{
+    // Wake often enough to stop promptly, serving the socket in between file writes.
+    const std::chrono::milliseconds wake(100);
+    std::chrono::time_point<std::chrono::steady_clock> nextWrite = std::chrono::steady_clock::now();
+    while (!_stop)
+    {
+        if (!_file.empty() && (std::chrono::steady_clock::now() >= nextWrite))
+        {
+            WriteFile();
+            nextWrite += _interval;
+        }
+
+        if (_listenSocket >= 0)
+        {
+            ServeSocket(static_cast<int>(wake.count()));
+        }
+        else
+        {
+            std::this_thread::sleep_for(wake);
+        }
+    }
+}
+
+void MetricsExporter::WriteFile()
+{
+    // Write then rename so that scrapers never see a partial file.
+    std::filesystem::path temporary = _file;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+        file << MetricsRegistry::Instance.Render();
+        if (!file)
+        {
+            std::cerr << "Failed to write metrics: " << temporary.string() << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, _file, error);
+    if (error)
+    {
+        std::cerr << "Failed to write metrics: " << _file.string() << ": " << error.message() << std::endl;
+    }
+}
+
+void MetricsExporter::OpenSocket()
+{
+#ifdef CHESSCOACH_WINDOWS
+    std::cerr << "Metrics sockets are only available on Linux; ignoring \"export_socket\"" << std::endl;
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string path = _socket.string();
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw ChessCoachException("Metrics socket path is too long: " + path);
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // Replace any socket left behind by a previous process, but never anything else at a misconfigured path.
+    struct stat existing;
+    if ((::lstat(path.c_str(), &existing) == 0) && S_ISSOCK(existing.st_mode))
+    {
+        ::unlink(path.c_str());
+    }
+    _listenSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((_listenSocket < 0)
+        || (::bind(_listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        || (::listen(_listenSocket, 8) != 0))
+    {
+        const std::string reason = std::strerror(errno);
+        CloseSocket();
+        throw ChessCoachException("Failed to listen on metrics socket " + path + ": " + reason);
+    }
+#endif
+}
+
+void MetricsExporter::ServeSocket(int timeoutMilliseconds)
+{
+#ifndef CHESSCOACH_WINDOWS
+    pollfd listening{ _listenSocket, POLLIN, 0 };
+    if ((::poll(&listening, 1, timeoutMilliseconds) <= 0) || !(listening.revents & POLLIN))
+    {
+        return;
+    }
+
+    const int connection = ::accept(_listenSocket, nullptr, nullptr);
+    if (connection < 0)
+    {
+        return;
+    }
+
+    // Read whatever request arrives promptly, answering HTTP scrapers with a minimal response and anything else with the text alone.
+    // Time out sends too, so that a client that stops reading can't stall the exporter thread.
+    timeval timeout{ 0, 200 * 1000 };
+    ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[1024];
+    const ssize_t requestSize = ::recv(connection, request, sizeof(request), 0);
+    const bool http = ((requestSize >= 4) && (std::memcmp(request, "GET ", 4) == 0));
+
+    const std::string body = MetricsRegistry::Instance.Render();
+    std::string response;
+    if (http)
+    {
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+            + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    }
+    response += body;
+
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        const ssize_t result = ::send(connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0)
+        {
+            break;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    ::close(connection);
+#else
+    (void)timeoutMilliseconds;
+#endif
+}
+
+void MetricsExporter::CloseSocket()
+{
+#ifndef CHESSCOACH_WINDOWS
+    if (_listenSocket >= 0)
+    {
+        ::close(_listenSocket);
+        _listenSocket = -1;
+        ::unlink(_socket.string().c_str());
+    }
+#endif
+}
@@ -0,0 +1,181 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _METRICSREGISTRY_H_
+#define _METRICSREGISTRY_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+
+enum MetricType
+{
+    MetricType_Counter,
+    MetricType_Gauge,
+    MetricType_Histogram,
+
+    MetricType_Count,
+};
+constexpr const char* MetricTypeKeys[MetricType_Count] = { "counter", "gauge", "histogram" };
+static_assert(MetricType_Count == 3);
+
+// Bucket counts plus the sum, which power-of-two buckets can't recover.
+struct MetricHistogramValue
+{
+    LatencyHistogram::Counts counts;
+    int64_t sumNanoseconds;
+};
+
+class MetricCounter
+{
+public:
+
+    void Add(int64_t value)
+    {
+        _value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t Value() const;
+
+private:
+
+    std::atomic_int64_t _value{ 0 };
+};
+
+class MetricGauge
+{
+public:
+
+    void Set(double value)
+    {
+        _value.store(value, std::memory_order_relaxed);
+    }
+
+    double Value() const;
+
+private:
+
+    std::atomic<double> _value{ 0.0 };
+};
+
+class MetricHistogram
+{
+public:
+
+    void Record(std::chrono::nanoseconds duration);
+    MetricHistogramValue Value() const;
+
+private:
+
+    LatencyHistogram _histogram;
+    std::atomic_int64_t _sumNanoseconds{ 0 };
+};
+
+// Process-wide counters, gauges and latency histograms, rendered in Prometheus text format by "MetricsExporter"
+// so that long-running processes can be monitored without parsing logs. Names are unique: registering an existing
+// name returns the same instrument (or replaces the callback). Owned instruments live as long as the process.
+class MetricsRegistry
+{
+public:
+
+    static MetricsRegistry Instance;
+
+    using ValueCallback = std::function<double()>;
+    using HistogramCallback = std::function<MetricHistogramValue()>;
+
+public:
+
+    MetricCounter& Counter(const std::string& name, const std::string& help);
+    MetricGauge& Gauge(const std::string& name, const std::string& help);
+    MetricHistogram& Histogram(const std::string& name, const std::string& help);
+
+    // Callbacks are evaluated at render time to sample existing statistics without touching hot paths.
+    // "Remove" guarantees that the callback isn't running and won't run again, for sampled objects with limited lifetimes.
+    int AddCallback(const std::string& name, const std::string& help, MetricType type, ValueCallback callback);
+    int AddHistogramCallback(const std::string& name, const std::string& help, HistogramCallback callback);
+    void Remove(int handle);
+
+    // Text exposition format 0.0.4.
+    std::string Render() const;
+
+private:
+
+    struct Family
+    {
+        int handle;
+        std::string name;
+        std::string help;
+        MetricType type;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+        ValueCallback valueCallback;
+        HistogramCallback histogramCallback;
+    };
+
+    Family& FindOrAdd(const std::string& name, const std::string& help, MetricType type);
+
+private:
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<Family>> _families;
+    int _nextHandle = 0;
+};
+
+// Exports "MetricsRegistry" for a local scraper: rewriting a file atomically each interval (e.g. for the node_exporter
+// textfile collector), and/or serving each connection to a Unix domain socket on Linux (HTTP if requested via "GET").
+// Registers prediction cache, network and memory samplers when started.
+class MetricsExporter
+{
+public:
+
+    static MetricsExporter Instance;
+
+public:
+
+    ~MetricsExporter();
+
+    void Start(const std::filesystem::path& file, const std::filesystem::path& socket, int intervalSeconds);
+    void Stop();
+
+private:
+
+    void Loop();
+    void WriteFile();
+    void OpenSocket();
+    void ServeSocket(int timeoutMilliseconds);
+    void CloseSocket();
+
+private:
+
+    std::thread _thread;
+    std::atomic_bool _stop{ false };
+    std::filesystem::path _file;
+    std::filesystem::path _socket;
+    std::chrono::seconds _interval{ 0 };
+    int _listenSocket = -1;
+};
+
+#endif // _METRICSREGISTRY_H_
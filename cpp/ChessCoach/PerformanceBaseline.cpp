@@ -0,0 +1,204 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "PerformanceBaseline.h"
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#include "Platform.h"
+
+float StrengthTestPerformance::NodesPerSecond() const
+{
+    return ((seconds > 0.f) ? (nodes / seconds) : 0.f);
+}
+
+// Unsolved positions used the whole search without settling on the solution, so censor them at the full search.
+int StrengthTestPerformance::NodesToSolutionOrMaximum() const
+{
+    return (solved ? nodesToSolution : nodes);
+}
+
+float StrengthTestPerformance::SecondsToSolutionOrMaximum() const
+{
+    return (solved ? secondsToSolution : seconds);
+}
+
+void PerformanceBaseline::Save(const std::filesystem::path& path, const std::vector<StrengthTestPerformance>& performances)
+{
+    std::ofstream file(path, std::ios::out);
+    if (!file)
+    {
+        throw ChessCoachException("Failed to write performance baseline: " + path.string());
+    }
+
+    // FENs contain no commas.
+    file << "fen,solved,nodes,seconds,nodes_to_solution,seconds_to_solution" << std::endl;
+    for (const StrengthTestPerformance& performance : performances)
+    {
+        file << performance.fen << "," << (performance.solved ? 1 : 0) << "," << performance.nodes << "," << performance.seconds
+            << "," << performance.nodesToSolution << "," << performance.secondsToSolution << std::endl;
+    }
+}
+
+std::vector<StrengthTestPerformance> PerformanceBaseline::Load(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::in);
+    if (!file)
+    {
+        throw ChessCoachException("Failed to read performance baseline: " + path.string());
+    }
+
+    std::vector<StrengthTestPerformance> performances;
+    std::string line;
+    std::getline(file, line); // Header
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+
+        std::stringstream tokenizer(line);
+        std::string solved;
+        std::string nodes;
+        std::string seconds;
+        std::string nodesToSolution;
+        std::string secondsToSolution;
+        StrengthTestPerformance performance;
+        if (!std::getline(tokenizer, performance.fen, ',') ||
+            !std::getline(tokenizer, solved, ',') ||
+            !std::getline(tokenizer, nodes, ',') ||
+            !std::getline(tokenizer, seconds, ',') ||
+            !std::getline(tokenizer, nodesToSolution, ',') ||
+            !std::getline(tokenizer, secondsToSolution, ','))
+        {
+            throw ChessCoachException("Invalid performance baseline line: " + line);
+        }
+        performance.solved = (solved == "1");
+        performance.nodes = std::stoi(nodes);
+        performance.seconds = std::stof(seconds);
+        performance.nodesToSolution = std::stoi(nodesToSolution);
+        performance.secondsToSolution = std::stof(secondsToSolution);
+        performances.push_back(performance);
+    }
+    return performances;
+}
+
+PerformanceComparison PerformanceBaseline::Compare(const std::vector<StrengthTestPerformance>& baseline,
+    const std::vector<StrengthTestPerformance>& current, float tolerance, float zScore)
+{
+    PerformanceComparison comparison{};
+
+    std::map<std::string, const StrengthTestPerformance*> baselineByFen;
+    for (const StrengthTestPerformance& performance : baseline)
+    {
+        baselineByFen[performance.fen] = &performance;
+        comparison.baselineSolvedCount += (performance.solved ? 1 : 0);
+    }
+
+    // Pair positions by FEN, skipping any with no nodes or time (e.g. immediate mates). Positions solved in only
+    // one run still pair for nodes and time to solution, so losing solutions counts as slowing down.
+    std::vector<float> nodesPerSecondLogRatios;
+    std::vector<float> nodesToSolutionLogRatios;
+    std::vector<float> secondsToSolutionLogRatios;
+    for (const StrengthTestPerformance& performance : current)
+    {
+        comparison.currentSolvedCount += (performance.solved ? 1 : 0);
+
+        const auto match = baselineByFen.find(performance.fen);
+        if (match == baselineByFen.end())
+        {
+            continue;
+        }
+        const StrengthTestPerformance& previous = *match->second;
+        comparison.newlyUnsolvedCount += ((previous.solved && !performance.solved) ? 1 : 0);
+
+        if ((performance.NodesPerSecond() > 0.f) && (previous.NodesPerSecond() > 0.f))
+        {
+            nodesPerSecondLogRatios.push_back(std::log(performance.NodesPerSecond() / previous.NodesPerSecond()));
+        }
+        if (!performance.solved && !previous.solved)
+        {
+            continue;
+        }
+        if ((performance.NodesToSolutionOrMaximum() > 0) && (previous.NodesToSolutionOrMaximum() > 0))
+        {
+            nodesToSolutionLogRatios.push_back(std::log(static_cast<float>(performance.NodesToSolutionOrMaximum()) / previous.NodesToSolutionOrMaximum()));
+        }
+        if ((performance.SecondsToSolutionOrMaximum() > 0.f) && (previous.SecondsToSolutionOrMaximum() > 0.f))
+        {
+            secondsToSolutionLogRatios.push_back(std::log(performance.SecondsToSolutionOrMaximum() / previous.SecondsToSolutionOrMaximum()));
+        }
+    }
+
+    comparison.nodesPerSecond = CalculateRatio(nodesPerSecondLogRatios, zScore);
+    comparison.nodesToSolution = CalculateRatio(nodesToSolutionLogRatios, zScore);
+    comparison.secondsToSolution = CalculateRatio(secondsToSolutionLogRatios, zScore);
+
+    // Lower nodes per second and higher nodes or time to solution are worse.
+    const auto lower = [&](const PerformanceRatio& ratio)
+    {
+        return ((ratio.pairedCount > 0) && (ratio.geometricMeanRatio < (1.f - tolerance)) && (ratio.upperRatio < 1.f));
+    };
+    const auto higher = [&](const PerformanceRatio& ratio)
+    {
+        return ((ratio.pairedCount > 0) && (ratio.geometricMeanRatio > (1.f + tolerance)) && (ratio.lowerRatio > 1.f));
+    };
+    comparison.regressed = (lower(comparison.nodesPerSecond) || higher(comparison.nodesToSolution) || higher(comparison.secondsToSolution));
+
+    return comparison;
+}
+
+PerformanceRatio PerformanceBaseline::CalculateRatio(const std::vector<float>& logRatios, float zScore)
+{
+    PerformanceRatio ratio{};
+    ratio.pairedCount = static_cast<int>(logRatios.size());
+    if (logRatios.empty())
+    {
+        ratio.geometricMeanRatio = 1.f;
+        ratio.lowerRatio = 1.f;
+        ratio.upperRatio = 1.f;
+        return ratio;
+    }
+
+    double sum = 0.0;
+    for (const float logRatio : logRatios)
+    {
+        sum += logRatio;
+    }
+    const double mean = (sum / logRatios.size());
+
+    // With a single pair there's no variance estimate, so the interval can't exclude no change.
+    double standardError = std::numeric_limits<double>::infinity();
+    if (logRatios.size() > 1)
+    {
+        double squaredDeviations = 0.0;
+        for (const float logRatio : logRatios)
+        {
+            squaredDeviations += ((logRatio - mean) * (logRatio - mean));
+        }
+        standardError = std::sqrt(squaredDeviations / (logRatios.size() - 1) / logRatios.size());
+    }
+
+    ratio.geometricMeanRatio = static_cast<float>(std::exp(mean));
+    ratio.lowerRatio = static_cast<float>(std::exp(mean - (zScore * standardError)));
+    ratio.upperRatio = static_cast<float>(std::exp(mean + (zScore * standardError)));
+    return ratio;
+}
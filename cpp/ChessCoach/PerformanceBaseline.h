@@ -0,0 +1,78 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _PERFORMANCEBASELINE_H_
+#define _PERFORMANCEBASELINE_H_
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Search speed for a single strength test position. Time and nodes to solution are from the search start
+// until the best move last changed, and only meaningful when solved.
+struct StrengthTestPerformance
+{
+    std::string fen;
+    bool solved;
+    int nodes;
+    float seconds;
+    int nodesToSolution;
+    float secondsToSolution;
+
+    float NodesPerSecond() const;
+    int NodesToSolutionOrMaximum() const;
+    float SecondsToSolutionOrMaximum() const;
+};
+
+// Paired comparison of one metric across positions common to the baseline and current run,
+// using log ratios (current / baseline) so that each position contributes equally.
+struct PerformanceRatio
+{
+    int pairedCount;
+    float geometricMeanRatio;
+    float lowerRatio;
+    float upperRatio;
+};
+
+struct PerformanceComparison
+{
+    PerformanceRatio nodesPerSecond;
+    PerformanceRatio nodesToSolution; // Positions solved in either run, counting unsolved at the full search
+    PerformanceRatio secondsToSolution; // Positions solved in either run, counting unsolved at the full search
+    int baselineSolvedCount;
+    int currentSolvedCount;
+    int newlyUnsolvedCount; // Solved in the baseline but not the current run
+    bool regressed;
+};
+
+// Records strength test speed into a baseline file, then gates later runs on significant slowdowns:
+// a metric regresses when it's worse than the baseline by more than "tolerance" (e.g. 0.05 for 5%)
+// and the confidence interval at "zScore" standard errors excludes no change.
+class PerformanceBaseline
+{
+public:
+
+    static void Save(const std::filesystem::path& path, const std::vector<StrengthTestPerformance>& performances);
+    static std::vector<StrengthTestPerformance> Load(const std::filesystem::path& path);
+    static PerformanceComparison Compare(const std::vector<StrengthTestPerformance>& baseline,
+        const std::vector<StrengthTestPerformance>& current, float tolerance, float zScore);
+
+private:
+
+    static PerformanceRatio CalculateRatio(const std::vector<float>& logRatios, float zScore);
+};
+
+#endif // _PERFORMANCEBASELINE_H_
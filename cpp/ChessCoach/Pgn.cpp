@@ -93,7 +93,9 @@ std::tuple<int, int, int, int> Pgn::ParsePgn(std::istream& content, bool allowNo
             continue;
         }
 
-        gameHandler(SavedGame(result, std::move(moves), GenerateMctsValues(moves, result), GenerateChildVisits(moves)), std::move(commentary));
+        // Every position in a PGN game is a full training target (there is no playout cap randomization).
+        gameHandler(SavedGame(result, std::move(moves), GenerateMctsValues(moves, result), GenerateChildVisits(moves),
+            std::vector<uint8_t>(moves.size(), 1), Game::StartingPosition), std::move(commentary));
     }
 
     return { gamesSeen, fenGameCount, badMovesCount, badResultCount };
@@ -765,18 +767,30 @@ void Pgn::GeneratePgn(std::ostream& content, const SavedGame& game)
         << "[Round \"\"]" << std::endl
         << "[White \"\"]" << std::endl
         << "[Black \"\"]" << std::endl
-        << "[Result \"" << result << "\"]" << std::endl
-        << std::endl;
+        << "[Result \"" << result << "\"]" << std::endl;
+
+    // Games forked from positions in earlier games need their starting position.
+    if (game.startFen != Game::StartingPosition)
+    {
+        content << "[SetUp \"1\"]" << std::endl
+            << "[FEN \"" << game.startFen << "\"]" << std::endl;
+    }
+    content << std::endl;
 
     StateListPtr positionStates(new std::deque<StateInfo>(1));
     Position position;
-    position.set(Game::StartingPosition, false /* isChess960 */, &positionStates->back(), Threads.main());
+    position.set(game.startFen, false /* isChess960 */, &positionStates->back(), Threads.main());
 
     for (int i = 0; i < game.moveCount; i++)
     {
-        if ((i % 2) == 0)
+        const int ply = position.game_ply();
+        if ((ply % 2) == 0)
+        {
+            content << ((ply / 2) + 1) << ". ";
+        }
+        else if (i == 0)
         {
-            content << ((i / 2) + 1) << ". ";
+            content << ((ply / 2) + 1) << "... ";
         }
 
         const Move move = Move(game.moves[i]);
@@ -19,6 +19,8 @@
 #include <cstdlib>
 #include <fcntl.h>
 #include <cassert>
+#include <fstream>
+#include <limits>
 
 #ifdef CHESSCOACH_WINDOWS
 #include <io.h>
@@ -90,6 +92,30 @@ void Platform::SetEnvironmentVariable(const char* name, const char* value)
 #endif
 }
 
+// Includes reclaimable page cache, so filling the page cache doesn't shrink it much.
+int64_t Platform::AvailableMemoryBytes()
+{
+#ifdef CHESSCOACH_WINDOWS
+    MEMORYSTATUSEX status{};
+    status.dwLength = sizeof(status);
+    ::GlobalMemoryStatusEx(&status);
+    return static_cast<int64_t>(status.ullAvailPhys);
+#else
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    int64_t kibibytes;
+    while (meminfo >> key >> kibibytes)
+    {
+        if (key == "MemAvailable:")
+        {
+            return (kibibytes * 1024);
+        }
+        meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return (static_cast<int64_t>(::sysconf(_SC_AVPHYS_PAGES)) * ::sysconf(_SC_PAGESIZE));
+#endif
+}
+
 void Platform::DebugBreak()
 {
 #ifdef CHESSCOACH_WINDOWS
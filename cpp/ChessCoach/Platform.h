@@ -17,6 +17,7 @@
 #ifndef _PLATFORM_H_
 #define _PLATFORM_H_
 
+#include <cstdint>
 #include <string>
 #include <filesystem>
 
@@ -47,6 +48,7 @@ public:
 
     static std::string GetEnvironmentVariable(const char* name);
     static void SetEnvironmentVariable(const char* name, const char* value);
+    static int64_t AvailableMemoryBytes();
 
     static void DebugBreak();
 
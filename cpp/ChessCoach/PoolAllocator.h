@@ -86,10 +86,8 @@ public:
             AllocateBlock();
         }
 
-#ifdef _DEBUG
         _currentlyAllocatedCount++;
         _peakAllocatedCount = std::max(_peakAllocatedCount, _currentlyAllocatedCount);
-#endif
         
         void* allocation = _next;
         _next = _next->next;
@@ -104,9 +102,7 @@ public:
             return;
         }
 
-#ifdef _DEBUG
         _currentlyAllocatedCount--;
-#endif
 
         Chunk* asChunk = reinterpret_cast<Chunk*>(memory);
         
@@ -114,6 +110,7 @@ public:
         _next = asChunk;
     }
 
+    // Current and peak allocated item counts, tracked in all builds.
     std::pair<int, int> DebugAllocations()
     {
         return std::pair(_currentlyAllocatedCount, _peakAllocatedCount);
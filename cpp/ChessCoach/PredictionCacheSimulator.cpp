@@ -0,0 +1,192 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "PredictionCacheSimulator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <sstream>
+
+#include "Platform.h"
+#include "PredictionCache.h"
+
+static_assert(PredictionCacheSimulator::SlotBytes == sizeof(PredictionCacheEntry));
+static_assert(PredictionCacheSimulator::FirstSlotMoveCount == PredictionCacheEntry::MaxMoveCount);
+
+// Entries sit at fixed positions within their set so that CLOCK hands stay meaningful; "slots" of zero is empty.
+struct SimulatedEntry
+{
+    Key key;
+    uint32_t lastUsed;
+    uint8_t slots;
+    uint8_t frequency;
+    uint8_t referenced;
+    uint8_t reserved;
+};
+static_assert(sizeof(SimulatedEntry) == 16);
+
+std::string CacheGeometry::Describe() const
+{
+    std::stringstream description;
+    description << sizeMebibytes << "MiB " << ways << "-way " << CacheReplacementKeys[replacement] << " max_slots " << maxSlotsPerEntry;
+    return description.str();
+}
+
+double CacheSimulationResult::HitRate() const
+{
+    return (probeCount > 0) ? (static_cast<double>(hitCount) / probeCount) : 0.0;
+}
+
+int PredictionCacheSimulator::SlotsForMoveCount(int moveCount)
+{
+    const int extraMoves = std::max(0, moveCount - FirstSlotMoveCount);
+    return (1 + (extraMoves + ExtraSlotMoveCount - 1) / ExtraSlotMoveCount);
+}
+
+CacheSimulationResult PredictionCacheSimulator::Simulate(const CacheGeometry& geometry, const std::vector<PredictionCacheProbe>& probes)
+{
+    if ((geometry.sizeMebibytes <= 0) || (geometry.ways <= 0) || (geometry.ways > std::numeric_limits<uint8_t>::max())
+        || (geometry.maxSlotsPerEntry <= 0))
+    {
+        throw ChessCoachException("Invalid cache geometry: " + geometry.Describe());
+    }
+    if (probes.size() >= std::numeric_limits<uint32_t>::max())
+    {
+        throw ChessCoachException("Too many probes to simulate");
+    }
+
+    const int ways = geometry.ways;
+    const uint64_t slotCount = (static_cast<uint64_t>(geometry.sizeMebibytes) * 1024 * 1024 / SlotBytes);
+    const uint64_t setCount = std::max(uint64_t(1), (slotCount / ways));
+    std::vector<SimulatedEntry> entries(setCount * ways);
+    std::vector<int> usedSlots(setCount);
+    std::vector<uint8_t> hands(setCount);
+
+    CacheSimulationResult result = {};
+    result.geometry = geometry;
+
+    uint32_t now = 0;
+    for (const PredictionCacheProbe& probe : probes)
+    {
+        now++;
+        const bool oversize = (probe.moveCount > FirstSlotMoveCount);
+        result.probeCount++;
+        result.oversizeProbeCount += (oversize ? 1 : 0);
+
+        // Mix so that set counts other than powers of two still spread evenly.
+        const uint64_t mixed = ((probe.key ^ (probe.key >> 32)) * 0x9E3779B97F4A7C15ULL);
+        const uint64_t set = ((mixed >> 16) % setCount);
+        SimulatedEntry* setEntries = &entries[set * ways];
+
+        SimulatedEntry* found = nullptr;
+        for (int i = 0; i < ways; i++)
+        {
+            if (setEntries[i].slots && (setEntries[i].key == probe.key))
+            {
+                found = &setEntries[i];
+                break;
+            }
+        }
+
+        if (found)
+        {
+            result.hitCount++;
+            result.oversizeHitCount += (oversize ? 1 : 0);
+            found->lastUsed = now;
+            found->referenced = 1;
+            if (found->frequency == std::numeric_limits<uint8_t>::max())
+            {
+                // Halve the set's frequencies so that old popularity decays.
+                for (int i = 0; i < ways; i++)
+                {
+                    setEntries[i].frequency /= 2;
+                }
+            }
+            found->frequency++;
+            continue;
+        }
+
+        const int slots = SlotsForMoveCount(probe.moveCount);
+        if ((slots > geometry.maxSlotsPerEntry) || (slots > ways))
+        {
+            // Uncacheable, like oversize positions in the live cache.
+            continue;
+        }
+
+        // Evict until the new entry fits.
+        while ((ways - usedSlots[set]) < slots)
+        {
+            int victim = -1;
+            switch (geometry.replacement)
+            {
+            case CacheReplacement_Lru:
+            case CacheReplacement_Lfu:
+            {
+                for (int i = 0; i < ways; i++)
+                {
+                    if (!setEntries[i].slots)
+                    {
+                        continue;
+                    }
+                    if ((victim < 0)
+                        || ((geometry.replacement == CacheReplacement_Lfu) && (setEntries[i].frequency < setEntries[victim].frequency))
+                        || (((geometry.replacement == CacheReplacement_Lru) || (setEntries[i].frequency == setEntries[victim].frequency))
+                            && (setEntries[i].lastUsed < setEntries[victim].lastUsed)))
+                    {
+                        victim = i;
+                    }
+                }
+                break;
+            }
+            case CacheReplacement_Clock:
+            default:
+            {
+                // Give referenced entries a second chance; terminates within two sweeps.
+                while (victim < 0)
+                {
+                    SimulatedEntry& candidate = setEntries[hands[set]];
+                    if (candidate.slots && !candidate.referenced)
+                    {
+                        victim = hands[set];
+                    }
+                    candidate.referenced = 0;
+                    hands[set] = static_cast<uint8_t>((hands[set] + 1) % ways);
+                }
+                break;
+            }
+            }
+
+            assert(victim >= 0);
+            usedSlots[set] -= setEntries[victim].slots;
+            setEntries[victim].slots = 0;
+            result.evictionCount++;
+        }
+
+        // An empty position always exists because every entry takes at least one slot.
+        for (int i = 0; i < ways; i++)
+        {
+            if (!setEntries[i].slots)
+            {
+                setEntries[i] = { probe.key, now, static_cast<uint8_t>(slots), 1, 1, 0 };
+                usedSlots[set] += slots;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,78 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _PREDICTIONCACHESIMULATOR_H_
+#define _PREDICTIONCACHESIMULATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PredictionCacheTrace.h"
+
+enum CacheReplacement
+{
+    CacheReplacement_Lru,
+    CacheReplacement_Clock,
+    CacheReplacement_Lfu,
+
+    CacheReplacement_Count,
+};
+constexpr const char* CacheReplacementKeys[CacheReplacement_Count] = { "lru", "clock", "lfu" };
+static_assert(CacheReplacement_Count == 3);
+
+// Slots are 128 bytes, like "PredictionCacheEntry". The first slot holds the key, value and up to 56 priors;
+// each additional slot holds 64 more priors, so "maxSlotsPerEntry" of 1 matches the live cache.
+struct CacheGeometry
+{
+    int sizeMebibytes;
+    int ways; // Slots per set
+    int maxSlotsPerEntry;
+    CacheReplacement replacement;
+
+    std::string Describe() const;
+};
+
+struct CacheSimulationResult
+{
+    CacheGeometry geometry;
+    int64_t probeCount;
+    int64_t hitCount;
+    int64_t oversizeProbeCount; // Probes with more than "PredictionCacheEntry::MaxMoveCount" moves
+    int64_t oversizeHitCount;
+    int64_t evictionCount;
+
+    double HitRate() const;
+};
+
+// Replays captured probes against alternative cache geometries and replacement policies. Misses are stored
+// immediately, whereas the live cache stores after network evaluation, so hit rates are slightly optimistic.
+// LRU with 8 ways and 1 slot per entry approximates the live cache's age-based replacement.
+class PredictionCacheSimulator
+{
+public:
+
+    static const int SlotBytes = 128;
+    static const int FirstSlotMoveCount = 56;
+    static const int ExtraSlotMoveCount = 64;
+
+    static int SlotsForMoveCount(int moveCount);
+
+    // Memory needed is one-eighth of "sizeMebibytes".
+    static CacheSimulationResult Simulate(const CacheGeometry& geometry, const std::vector<PredictionCacheProbe>& probes);
+};
+
+#endif // _PREDICTIONCACHESIMULATOR_H_
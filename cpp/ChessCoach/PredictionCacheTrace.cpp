@@ -0,0 +1,174 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "PredictionCacheTrace.h"
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#include "Config.h"
+#include "Platform.h"
+#include "Storage.h"
+#include "Threading.h"
+
+constexpr const char ProbeTraceMagic[8] = { 'C', 'C', 'P', 'C', 'P', 'R', 'B', '1' };
+constexpr const int ProbeBatchSize = 4096;
+
+// Probes are appended by the owning thread and flushed by it when full, or by "Stop".
+struct ProbeBuffer
+{
+    std::mutex mutex;
+    std::vector<PredictionCacheProbe> probes;
+    std::atomic_bool owned{ false };
+};
+
+static ThreadBufferRegistry<ProbeBuffer> ProbeBuffers;
+thread_local static ThreadBuffer<ProbeBuffer> ThreadProbeBuffer;
+static std::mutex ProbeFileMutex;
+static std::ofstream ProbeFile;
+static int64_t ProbeFileCount = 0;
+
+std::atomic_bool PredictionCacheTrace::EnabledFlag(false);
+
+// Caller holds the buffer's mutex.
+static void FlushProbes(ProbeBuffer& buffer)
+{
+    if (buffer.probes.empty())
+    {
+        return;
+    }
+
+    std::lock_guard lock(ProbeFileMutex);
+    if (ProbeFile.is_open())
+    {
+        ProbeFile.write(reinterpret_cast<const char*>(buffer.probes.data()), (buffer.probes.size() * sizeof(PredictionCacheProbe)));
+        ProbeFileCount += static_cast<int64_t>(buffer.probes.size());
+    }
+    buffer.probes.clear();
+}
+
+std::filesystem::path PredictionCacheTrace::StartInLogs()
+{
+    std::stringstream filename;
+    const std::time_t time = std::time(nullptr);
+#pragma warning(disable:4996) // Internal buffer is immediately consumed and detached.
+    filename << std::put_time(std::localtime(&time), "ChessCoachProbes_%Y%m%d_%H%M%S.bin");
+#pragma warning(default:4996) // Internal buffer is immediately consumed and detached.
+
+    const std::filesystem::path path = (Storage::MakeLocalPath(Config::Misc.Paths_Logs) / filename.str());
+    Start(path);
+    return path;
+}
+
+void PredictionCacheTrace::Start(const std::filesystem::path& path)
+{
+    Stop();
+
+    // Discard probes recorded after any previous "Stop".
+    {
+        std::lock_guard lock(ProbeBuffers.Mutex());
+        for (const auto& buffer : ProbeBuffers.Buffers())
+        {
+            std::lock_guard bufferLock(buffer->mutex);
+            buffer->probes.clear();
+        }
+    }
+
+    {
+        std::lock_guard lock(ProbeFileMutex);
+        ProbeFile.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!ProbeFile)
+        {
+            throw ChessCoachException("Failed to write prediction cache probes: " + path.string());
+        }
+        ProbeFile.write(ProbeTraceMagic, sizeof(ProbeTraceMagic));
+        ProbeFileCount = 0;
+    }
+
+    EnabledFlag.store(true, std::memory_order_relaxed);
+}
+
+int64_t PredictionCacheTrace::Stop()
+{
+    EnabledFlag.store(false, std::memory_order_relaxed);
+
+    {
+        std::lock_guard lock(ProbeBuffers.Mutex());
+        for (const auto& buffer : ProbeBuffers.Buffers())
+        {
+            std::lock_guard bufferLock(buffer->mutex);
+            FlushProbes(*buffer);
+        }
+    }
+
+    std::lock_guard lock(ProbeFileMutex);
+    const int64_t count = ProbeFileCount;
+    if (ProbeFile.is_open())
+    {
+        ProbeFile.close();
+    }
+    ProbeFileCount = 0;
+    return count;
+}
+
+void PredictionCacheTrace::Record(Key key, int moveCount, bool hit)
+{
+    ProbeBuffer& buffer = ThreadProbeBuffer.Get(ProbeBuffers, [](int)
+        {
+            ProbeBuffer* created = new ProbeBuffer();
+            created->probes.reserve(ProbeBatchSize);
+            return created;
+        });
+
+    std::lock_guard lock(buffer.mutex);
+    PredictionCacheProbe& probe = buffer.probes.emplace_back();
+    probe.key = key;
+    probe.moveCount = static_cast<uint16_t>(moveCount);
+    probe.hit = (hit ? 1 : 0);
+    std::memset(probe.reserved, 0, sizeof(probe.reserved));
+    if (buffer.probes.size() >= ProbeBatchSize)
+    {
+        FlushProbes(buffer);
+    }
+}
+
+std::vector<PredictionCacheProbe> PredictionCacheTrace::Load(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    char magic[sizeof(ProbeTraceMagic)];
+    if (!file || !file.read(magic, sizeof(magic)) || (std::memcmp(magic, ProbeTraceMagic, sizeof(magic)) != 0))
+    {
+        throw ChessCoachException("Failed to read prediction cache probes: " + path.string());
+    }
+
+    // Ignore any partial trailing record.
+    const std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff size = (file.tellg() - start);
+    file.seekg(start);
+
+    std::vector<PredictionCacheProbe> probes(static_cast<size_t>(size / sizeof(PredictionCacheProbe)));
+    file.read(reinterpret_cast<char*>(probes.data()), (probes.size() * sizeof(PredictionCacheProbe)));
+    if (!file)
+    {
+        throw ChessCoachException("Failed to read prediction cache probes: " + path.string());
+    }
+    return probes;
+}
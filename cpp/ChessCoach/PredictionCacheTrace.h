@@ -0,0 +1,63 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _PREDICTIONCACHETRACE_H_
+#define _PREDICTIONCACHETRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <Stockfish/types.h>
+
+// A single prediction cache probe, including positions with too many moves to probe the live cache.
+struct PredictionCacheProbe
+{
+    Key key;
+    uint16_t moveCount;
+    uint8_t hit; // Whether the live cache hit
+    uint8_t reserved[5];
+};
+static_assert(sizeof(PredictionCacheProbe) == 16);
+
+// Captures prediction cache probe keys and move counts during search/self-play into a binary file,
+// for offline replay against alternative cache geometries via "PredictionCacheSimulator". Capture is off
+// unless started via the UCI "cachetrace" command or the "trace_probes" config key (per self-play stage).
+// Probes are batched per thread, so ordering across threads is approximate.
+class PredictionCacheTrace
+{
+public:
+
+    static bool Enabled()
+    {
+        return EnabledFlag.load(std::memory_order_relaxed);
+    }
+
+    static std::filesystem::path StartInLogs();
+    static void Start(const std::filesystem::path& path);
+    static int64_t Stop(); // Returns the probe count written
+
+    static void Record(Key key, int moveCount, bool hit);
+
+    static std::vector<PredictionCacheProbe> Load(const std::filesystem::path& path);
+
+private:
+
+    static std::atomic_bool EnabledFlag;
+};
+
+#endif // _PREDICTIONCACHETRACE_H_
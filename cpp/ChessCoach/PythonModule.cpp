@@ -148,7 +148,7 @@ PyObject* PythonModule::LoadPosition(PyObject*/* self*/, PyObject* args)
         NonPythonContext context;
 
         // Reach the requested position.
-        Game game;
+        Game game(savedGame.startFen, {});
         for (int i = 0; i < position; i++)
         {
             game.ApplyMove(Move(savedGame.moves[i]));
@@ -260,7 +260,7 @@ PyObject* PythonModule::EvaluateParameters(PyObject*/* self*/, PyObject* args)
         const std::filesystem::path epdPath = (Platform::InstallationDataPath() / "StrengthTests" / Config::Misc.Optimization_Epd);
         auto [score, total, positions, totalNodesRequired] = workerGroup.controllerWorker->StrengthTestEpd(
             workerGroup.workCoordinator.get(), epdPath, Config::Misc.Optimization_EpdMovetimeMilliseconds, Config::Misc.Optimization_EpdNodes,
-            Config::Misc.Optimization_EpdFailureNodes, Config::Misc.Optimization_EpdPositionLimit, nullptr /* progress */);
+            Config::Misc.Optimization_EpdFailureNodes, Config::Misc.Optimization_EpdPositionLimit, nullptr /* progress */, nullptr /* performancesOut */);
 
         evaluationScore = totalNodesRequired;
         workerGroup.ShutDown();
@@ -344,7 +344,7 @@ PyObject* PythonModule::GenerateCommentaryImageForPosition(PyObject*/* self*/, P
         NonPythonContext context;
 
         // Reach the requested position.
-        Game game;
+        Game game(savedGame.startFen, {});
         for (int i = 0; i < position; i++)
         {
             game.ApplyMove(Move(savedGame.moves[i]));
@@ -22,13 +22,19 @@
 #include <numpy/arrayobject.h>
 
 #include "Platform.h"
+#include "Trace.h"
 
 thread_local PyGILState_STATE PythonContext::GilState;
 thread_local PyThreadState* PythonContext::ThreadState = nullptr;
 
-PythonContext::PythonContext()
+PythonContext::PythonContext(PythonCall call)
+    : _call(call)
+    , _python(0)
 {
+    CHESSCOACH_TRACE_SCOPE("AcquireGil");
+
     // Re-acquire the GIL.
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     if (!ThreadState)
     {
         GilState = PyGILState_Ensure();
@@ -37,10 +43,16 @@ PythonContext::PythonContext()
     {
         PyEval_RestoreThread(ThreadState);
     }
+    _acquired = std::chrono::steady_clock::now();
+    _gilWait = (_acquired - start);
 }
 
 PythonContext::~PythonContext()
 {
+    // Record while still holding the GIL, so that metrics writes never contend.
+    const std::chrono::nanoseconds held = (std::chrono::steady_clock::now() - _acquired);
+    PythonMetrics::Instance.Record(_call, _gilWait, _python, (held - _python));
+
     // Release the GIL.
     ThreadState = PyEval_SaveThread();
 }
@@ -151,7 +163,9 @@ PythonNetwork::~PythonNetwork()
 
 PredictionStatus PythonNetwork::PredictBatch(NetworkType networkType, int batchSize, InputPlanes* images, float* values, OutputPlanes* policies)
 {
-    PythonContext context;
+    CHESSCOACH_TRACE_SCOPE("PredictBatch");
+
+    PythonContext context(PythonCall_PredictBatch);
 
     // Make the predict call.
     npy_intp imageDims[2]{ batchSize, InputPlaneCount };
@@ -159,7 +173,7 @@ PredictionStatus PythonNetwork::PredictBatch(NetworkType networkType, int batchS
         Py_ARRAY_LENGTH(imageDims), imageDims, NPY_INT64, images);
     PyAssert(pythonImages);
 
-    PyObject* tupleResult = PyObject_CallFunctionObjArgs(_predictBatchFunction[networkType], pythonImages, nullptr);
+    PyObject* tupleResult = context.Call(_predictBatchFunction[networkType], pythonImages);
     PyAssert(tupleResult);
     PyAssert(PyTuple_Check(tupleResult));
 
@@ -202,7 +216,7 @@ PredictionStatus PythonNetwork::PredictBatch(NetworkType networkType, int batchS
 
 std::vector<std::string> PythonNetwork::PredictCommentaryBatch(int batchSize, CommentaryInputPlanes* images)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_PredictCommentaryBatch);
 
     // Make the predict call.
     npy_intp imageDims[2]{ batchSize, CommentaryInputPlaneCount };
@@ -210,7 +224,7 @@ std::vector<std::string> PythonNetwork::PredictCommentaryBatch(int batchSize, Co
         Py_ARRAY_LENGTH(imageDims), imageDims, NPY_INT64, images);
     PyAssert(pythonImages);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_predictCommentaryBatchFunction, pythonImages, nullptr);
+    PyObject* result = context.Call(_predictCommentaryBatchFunction, pythonImages);
     PyAssert(result);
     PyAssert(PyArray_Check(result));
 
@@ -236,7 +250,7 @@ std::vector<std::string> PythonNetwork::PredictCommentaryBatch(int batchSize, Co
 
 void PythonNetwork::Train(NetworkType networkType, int step, int checkpoint)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_Train);
 
     PyObject* pythonStep = PyLong_FromLong(step);
     PyAssert(pythonStep);
@@ -244,7 +258,7 @@ void PythonNetwork::Train(NetworkType networkType, int step, int checkpoint)
     PyObject* pythonCheckpoint = PyLong_FromLong(checkpoint);
     PyAssert(pythonCheckpoint);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_trainFunction[networkType], pythonStep, pythonCheckpoint, nullptr);
+    PyObject* result = context.Call(_trainFunction[networkType], pythonStep, pythonCheckpoint);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -254,7 +268,7 @@ void PythonNetwork::Train(NetworkType networkType, int step, int checkpoint)
 
 void PythonNetwork::TrainCommentary(int step, int checkpoint)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_Train);
 
     PyObject* pythonStep = PyLong_FromLong(step);
     PyAssert(pythonStep);
@@ -262,7 +276,7 @@ void PythonNetwork::TrainCommentary(int step, int checkpoint)
     PyObject* pythonCheckpoint = PyLong_FromLong(checkpoint);
     PyAssert(pythonCheckpoint);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_trainCommentaryFunction, pythonStep, pythonCheckpoint, nullptr);
+    PyObject* result = context.Call(_trainCommentaryFunction, pythonStep, pythonCheckpoint);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -272,7 +286,7 @@ void PythonNetwork::TrainCommentary(int step, int checkpoint)
 
 void PythonNetwork::LogScalars(NetworkType networkType, int step, const std::vector<std::string> names, float* values)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_LogScalars);
 
     PyObject* pythonStep = PyLong_FromLong(step);
     PyAssert(pythonStep);
@@ -284,7 +298,7 @@ void PythonNetwork::LogScalars(NetworkType networkType, int step, const std::vec
         Py_ARRAY_LENGTH(valueDims), valueDims, NPY_FLOAT32, values);
     PyAssert(pythonValues);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_logScalarsFunction[networkType], pythonStep, pythonNames, pythonValues, nullptr);
+    PyObject* result = context.Call(_logScalarsFunction[networkType], pythonStep, pythonNames, pythonValues);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -295,12 +309,12 @@ void PythonNetwork::LogScalars(NetworkType networkType, int step, const std::vec
 
 void PythonNetwork::SaveNetwork(NetworkType networkType, int checkpoint)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_SaveNetwork);
 
     PyObject* pythonCheckpoint = PyLong_FromLong(checkpoint);
     PyAssert(pythonCheckpoint);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_saveNetworkFunction[networkType], pythonCheckpoint, nullptr);
+    PyObject* result = context.Call(_saveNetworkFunction[networkType], pythonCheckpoint);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -309,12 +323,12 @@ void PythonNetwork::SaveNetwork(NetworkType networkType, int checkpoint)
 
 void PythonNetwork::SaveSwaNetwork(NetworkType networkType, int checkpoint)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_SaveNetwork);
 
     PyObject* pythonCheckpoint = PyLong_FromLong(checkpoint);
     PyAssert(pythonCheckpoint);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_saveSwaNetworkFunction[networkType], pythonCheckpoint, nullptr);
+    PyObject* result = context.Call(_saveSwaNetworkFunction[networkType], pythonCheckpoint);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -323,12 +337,12 @@ void PythonNetwork::SaveSwaNetwork(NetworkType networkType, int checkpoint)
 
 void PythonNetwork::UpdateNetworkWeights(const std::string& networkWeights)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_UpdateNetworkWeights);
 
     PyObject* pythonNetworkWeights = PyUnicode_FromStringAndSize(networkWeights.data(), networkWeights.size());
     PyAssert(pythonNetworkWeights);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_updateNetworkWeightsFunction, pythonNetworkWeights, nullptr);
+    PyObject* result = context.Call(_updateNetworkWeightsFunction, pythonNetworkWeights);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -337,9 +351,9 @@ void PythonNetwork::UpdateNetworkWeights(const std::string& networkWeights)
 
 void PythonNetwork::GetNetworkInfo(NetworkType networkType, int* stepCountOut, int* swaStepCountOut, int* trainingChunkCountOut, std::string* relativePathOut)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_GetNetworkInfo);
 
-    PyObject* tupleResult = PyObject_CallFunctionObjArgs(_getNetworkInfoFunction[networkType], nullptr);
+    PyObject* tupleResult = context.Call(_getNetworkInfoFunction[networkType]);
     PyAssert(tupleResult);
     PyAssert(PyTuple_Check(tupleResult));
 
@@ -382,7 +396,7 @@ void PythonNetwork::GetNetworkInfo(NetworkType networkType, int* stepCountOut, i
 
 void PythonNetwork::SaveFile(const std::string& relativePath, const std::string& data)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_FileIo);
 
     PyObject* pythonRelativePath = PyUnicode_FromStringAndSize(relativePath.data(), relativePath.size());
     PyAssert(pythonRelativePath);
@@ -390,7 +404,7 @@ void PythonNetwork::SaveFile(const std::string& relativePath, const std::string&
     PyObject* pythonData = PyBytes_FromStringAndSize(data.data(), data.size());
     PyAssert(pythonData);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_saveFileFunction, pythonRelativePath, pythonData, nullptr);
+    PyObject* result = context.Call(_saveFileFunction, pythonRelativePath, pythonData);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -400,12 +414,12 @@ void PythonNetwork::SaveFile(const std::string& relativePath, const std::string&
 
 std::string PythonNetwork::LoadFile(const std::string& relativePath)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_FileIo);
 
     PyObject* pythonRelativePath = PyUnicode_FromStringAndSize(relativePath.data(), relativePath.size());
     PyAssert(pythonRelativePath);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_loadFileFunction, pythonRelativePath, nullptr);
+    PyObject* result = context.Call(_loadFileFunction, pythonRelativePath);
     PyAssert(result);
     PyAssert(PyBytes_Check(result));
 
@@ -422,12 +436,12 @@ std::string PythonNetwork::LoadFile(const std::string& relativePath)
 
 bool PythonNetwork::FileExists(const std::string& relativePath)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_FileIo);
 
     PyObject* pythonRelativePath = PyUnicode_FromStringAndSize(relativePath.data(), relativePath.size());
     PyAssert(pythonRelativePath);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_fileExistsFunction, pythonRelativePath, nullptr);
+    PyObject* result = context.Call(_fileExistsFunction, pythonRelativePath);
     PyAssert(result);
     PyAssert(PyBool_Check(result));
     const bool exists = PyObject_IsTrue(result);
@@ -440,12 +454,12 @@ bool PythonNetwork::FileExists(const std::string& relativePath)
 
 void PythonNetwork::LaunchGui(const std::string& mode)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_Gui);
 
     PyObject* pythonMode = PyUnicode_FromStringAndSize(mode.data(), mode.size());
     PyAssert(pythonMode);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_launchGuiFunction, pythonMode, nullptr);
+    PyObject* result = context.Call(_launchGuiFunction, pythonMode);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -456,7 +470,7 @@ void PythonNetwork::UpdateGui(const std::string& fen, const std::string& line, i
     const std::vector<std::string>& sans, const std::vector<std::string>& froms, const std::vector<std::string>& tos, std::vector<float>& targets,
     std::vector<float>& priors, std::vector<float>& values, std::vector<float>& puct, std::vector<int>& visits, std::vector<int>& weights)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_Gui);
 
     PyObject* pythonFen = PyUnicode_FromStringAndSize(fen.data(), fen.size());
     PyAssert(pythonFen);
@@ -502,8 +516,8 @@ void PythonNetwork::UpdateGui(const std::string& fen, const std::string& line, i
         Py_ARRAY_LENGTH(moveDims), moveDims, NPY_INT32, weights.data());
     PythonNetwork::PyAssert(pythonWeights);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_updateGuiFunction, pythonFen, pythonLine, pythonNodeCount, pythonEvaluation, pythonPrincipalVariation,
-        pythonSans, pythonFroms, pythonTos, pythonTargets, pythonPriors, pythonValues, pythonPuct, pythonVisits, pythonWeights, nullptr);
+    PyObject* result = context.Call(_updateGuiFunction, pythonFen, pythonLine, pythonNodeCount, pythonEvaluation, pythonPrincipalVariation,
+        pythonSans, pythonFroms, pythonTos, pythonTargets, pythonPriors, pythonValues, pythonPuct, pythonVisits, pythonWeights);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -527,7 +541,7 @@ void PythonNetwork::DebugDecompress(int positionCount, int policySize, float* re
     int64_t* policyRowLengths, int64_t* policyIndices, float* policyValues, int decompressPositionsModulus,
     InputPlanes* imagesOut, float* valuesOut, OutputPlanes* policiesOut)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_Debug);
 
     // Compressed probabilities are already in Python/TensorFlow [-1, 1] range (see Storage::PopulateGame).
 
@@ -558,8 +572,8 @@ void PythonNetwork::DebugDecompress(int positionCount, int policySize, float* re
     PyAssert(pythonDecompressPositionsModulus);
 
     // Make the call.
-    PyObject* tupleResult = PyObject_CallFunctionObjArgs(_debugDecompressFunction, pythonResult, pythonImagePiecesAuxiliary,
-        pythonPolicyRowLengths, pythonPolicyIndices, pythonPolicyValues, pythonDecompressPositionsModulus, nullptr);
+    PyObject* tupleResult = context.Call(_debugDecompressFunction, pythonResult, pythonImagePiecesAuxiliary,
+        pythonPolicyRowLengths, pythonPolicyIndices, pythonPolicyValues, pythonDecompressPositionsModulus);
     PyAssert(tupleResult);
     PyAssert(PyTuple_Check(tupleResult));
 
@@ -611,9 +625,9 @@ void PythonNetwork::DebugDecompress(int positionCount, int policySize, float* re
 
 void PythonNetwork::OptimizeParameters()
 {
-    PythonContext context;
+    PythonContext context(PythonCall_OptimizeParameters);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_optimizeParametersFunction, nullptr);
+    PyObject* result = context.Call(_optimizeParametersFunction);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -621,9 +635,9 @@ void PythonNetwork::OptimizeParameters()
 
 void PythonNetwork::RunBot()
 {
-    PythonContext context;
+    PythonContext context(PythonCall_RunBot);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_runBotFunction, nullptr);
+    PyObject* result = context.Call(_runBotFunction);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -631,7 +645,7 @@ void PythonNetwork::RunBot()
 
 void PythonNetwork::PlayBotMove(const std::string& gameId, const std::string& move)
 {
-    PythonContext context;
+    PythonContext context(PythonCall_PlayBotMove);
 
     PyObject* pythonGameId = PyUnicode_FromStringAndSize(gameId.data(), gameId.size());
     PyAssert(pythonGameId);
@@ -639,7 +653,7 @@ void PythonNetwork::PlayBotMove(const std::string& gameId, const std::string& mo
     PyObject* pythonMove = PyUnicode_FromStringAndSize(move.data(), move.size());
     PyAssert(pythonMove);
 
-    PyObject* result = PyObject_CallFunctionObjArgs(_playBotMoveFunction, pythonGameId, pythonMove, nullptr);
+    PyObject* result = context.Call(_playBotMoveFunction, pythonGameId, pythonMove);
     PyAssert(result);
 
     Py_DECREF(result);
@@ -17,8 +17,10 @@
 #ifndef _PYTHONNETWORK_H_
 #define _PYTHONNETWORK_H_
 
+#include <chrono>
 #include <vector>
 
+#include "Metrics.h"
 #include "Network.h"
 #include "Threading.h"
 
@@ -33,6 +35,8 @@
 #define PY_ARRAY_UNIQUE_SYMBOL ChessCoach_ArrayApi
 #define NO_IMPORT_ARRAY
 
+// Holds the GIL for its lifetime, recording time spent waiting for the GIL, inside Python functions
+// called via "Call", and the remainder (marshalling) into "PythonMetrics" for the given call type.
 class PythonContext
 {
 private:
@@ -42,8 +46,24 @@ private:
 
 public:
 
-    PythonContext();
+    explicit PythonContext(PythonCall call = PythonCall_Other);
     ~PythonContext();
+
+    template <typename... Args>
+    PyObject* Call(PyObject* function, Args... args)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        PyObject* result = PyObject_CallFunctionObjArgs(function, args..., nullptr);
+        _python += (std::chrono::steady_clock::now() - start);
+        return result;
+    }
+
+private:
+
+    PythonCall _call;
+    std::chrono::steady_clock::time_point _acquired;
+    std::chrono::nanoseconds _gilWait;
+    std::chrono::nanoseconds _python;
 };
 
 class NonPythonContext
@@ -16,18 +16,28 @@
 
 #include "SavedGame.h"
 
+#include <algorithm>
+
+#include "AllocationTracker.h"
+#include "Game.h"
+
 SavedGame::SavedGame()
     : result(-1.0f)
     , moveCount(0)
+    , startFen(Game::StartingPosition)
 {
 }
 
-SavedGame::SavedGame(float setResult, const std::vector<Move>& setMoves, const std::vector<float>& setMctsValues, const std::vector<std::map<Move, float>>& setChildVisits)
+SavedGame::SavedGame(float setResult, const std::vector<Move>& setMoves, const std::vector<float>& setMctsValues, const std::vector<std::map<Move, float>>& setChildVisits,
+    const std::vector<uint8_t>& setPolicyRecorded, const std::string& setStartFen)
     : result(setResult)
     , moves(setMoves.size())
     , mctsValues(setMctsValues)
+    , policyRecorded(setPolicyRecorded)
+    , startFen(setStartFen)
 {
     assert(setMoves.size() == setChildVisits.size());
+    assert(setMoves.size() == setPolicyRecorded.size());
 
     for (int i = 0; i < setMoves.size(); i++)
     {
@@ -38,13 +48,37 @@ SavedGame::SavedGame(float setResult, const std::vector<Move>& setMoves, const s
     childVisits = setChildVisits;
 
     moveCount = static_cast<int>(moves.size());
+
+    if (AllocationTracker::Enabled())
+    {
+        // Three vectors, plus an entry per child visit.
+        int64_t childVisitCount = 0;
+        for (const std::map<Move, float>& visits : childVisits)
+        {
+            childVisitCount += visits.size();
+        }
+        AllocationTracker::Allocate(AllocationTag_SavedGame, ((moves.size() * sizeof(uint16_t)) + (mctsValues.size() * sizeof(float))
+            + (policyRecorded.size() * sizeof(uint8_t)) + (childVisits.size() * sizeof(std::map<Move, float>))), 4);
+        AllocationTracker::Allocate(AllocationTag_SavedGame,
+            (childVisitCount * AllocationTracker::MapNodeBytes<std::map<Move, float>>()), childVisitCount);
+    }
 }
 
-SavedGame::SavedGame(float setResult, std::vector<uint16_t>&& setMoves, std::vector<float>&& setMctsValues, std::vector<std::map<Move, float>>&& setChildVisits)
+SavedGame::SavedGame(float setResult, std::vector<uint16_t>&& setMoves, std::vector<float>&& setMctsValues, std::vector<std::map<Move, float>>&& setChildVisits,
+    std::vector<uint8_t>&& setPolicyRecorded, const std::string& setStartFen)
     : result(setResult)
     , moves(std::move(setMoves))
     , mctsValues(std::move(setMctsValues))
     , childVisits(std::move(setChildVisits))
+    , policyRecorded(std::move(setPolicyRecorded))
+    , startFen(setStartFen)
 {
+    assert(moves.size() == policyRecorded.size());
+
     moveCount = static_cast<int>(moves.size());
+}
+
+int SavedGame::PolicyRecordedCount() const
+{
+    return static_cast<int>(std::count(policyRecorded.begin(), policyRecorded.end(), 1));
 }
\ No newline at end of file
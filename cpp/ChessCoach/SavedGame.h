@@ -20,6 +20,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <string>
 
 #include <Stockfish/types.h>
 
@@ -28,14 +29,25 @@
 struct SavedGame
 {
     SavedGame();
-    SavedGame(float setResult, const std::vector<Move>& setMoves, const std::vector<float>& setMctsValues, const std::vector<std::map<Move, float>>& setChildVisits);
-    SavedGame(float setResult, std::vector<uint16_t>&& setMoves, std::vector<float>&& setMctsValues, std::vector<std::map<Move, float>>&& setChildVisits);
+    SavedGame(float setResult, const std::vector<Move>& setMoves, const std::vector<float>& setMctsValues, const std::vector<std::map<Move, float>>& setChildVisits,
+        const std::vector<uint8_t>& setPolicyRecorded, const std::string& setStartFen);
+    SavedGame(float setResult, std::vector<uint16_t>&& setMoves, std::vector<float>&& setMctsValues, std::vector<std::map<Move, float>>&& setChildVisits,
+        std::vector<uint8_t>&& setPolicyRecorded, const std::string& setStartFen);
+
+    int PolicyRecordedCount() const;
 
     float result;
     int moveCount;
     std::vector<uint16_t> moves;
     std::vector<float> mctsValues;
     std::vector<std::map<Move, float>> childVisits;
+
+    // Whether each position searched with the full simulation cap and should be used for training
+    // (playout cap randomization). Fast-searched positions are still stored for image history.
+    std::vector<uint8_t> policyRecorded;
+
+    // Games forked from positions in earlier games start from this FEN rather than the standard starting position.
+    std::string startFen;
 };
 
 struct SavedComment
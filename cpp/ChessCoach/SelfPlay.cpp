@@ -24,14 +24,21 @@
 #include <numeric>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
+#include <thread>
 
 #include <Stockfish/thread.h>
 #include <Stockfish/uci.h>
 
+#include "AllocationTracker.h"
 #include "Config.h"
+#include "MetricsRegistry.h"
 #include "Pgn.h"
+#include "PredictionCacheTrace.h"
 #include "Random.h"
 #include "Syzygy.h"
+#include "Trace.h"
+#include "TreeStatistics.h"
 
 int8_t TerminalValue::Draw()
 {
@@ -415,6 +422,22 @@ Node* Node::Child(Move match)
     return nullptr;
 }
 
+std::atomic_int64_t SelfPlayGame::ChildNodeCount(0);
+std::atomic_int64_t SelfPlayGame::ChildArrayCount(0);
+
+// Search roots are allocated individually, whereas other nodes are allocated as child arrays on expansion.
+static Node* NewRootNode()
+{
+    AllocationTracker::Allocate(AllocationTag_Node, sizeof(Node));
+    return new Node();
+}
+
+static void DeleteRootNode(Node* root)
+{
+    AllocationTracker::Free(AllocationTag_Node, sizeof(Node));
+    delete root;
+}
+
 // Fast default-constructor with no resource ownership, used to size out vectors.
 SelfPlayGame::SelfPlayGame()
     : _root(nullptr)
@@ -424,19 +447,24 @@ SelfPlayGame::SelfPlayGame()
     , _policy(nullptr)
     , _tablebaseCardinality(nullptr)
     , _searchRootPly(Ply())
+    , _fullSearch(true)
+    , _adaptiveBudget{}
     , _result(CHESSCOACH_VALUE_UNINITIALIZED)
 {
 }
 
 SelfPlayGame::SelfPlayGame(INetwork::InputPlanes* image, float* value, INetwork::OutputPlanes* policy, int* tablebaseCardinality)
     : Game()
-    , _root(new Node())
+    , _root(NewRootNode())
     , _tryHard(false)
     , _image(image)
     , _value(value)
     , _policy(policy)
     , _tablebaseCardinality(tablebaseCardinality)
     , _searchRootPly(Ply())
+    , _fullSearch(true)
+    , _startFen(StartingPosition)
+    , _adaptiveBudget{}
     , _result(CHESSCOACH_VALUE_UNINITIALIZED)
 {
 }
@@ -444,13 +472,16 @@ SelfPlayGame::SelfPlayGame(INetwork::InputPlanes* image, float* value, INetwork:
 SelfPlayGame::SelfPlayGame(const std::string& fen, const std::vector<Move>& moves, bool tryHard,
     INetwork::InputPlanes* image, float* value, INetwork::OutputPlanes* policy, int* tablebaseCardinality)
     : Game(fen, moves)
-    , _root(new Node())
+    , _root(NewRootNode())
     , _tryHard(tryHard)
     , _image(image)
     , _value(value)
     , _policy(policy)
     , _tablebaseCardinality(tablebaseCardinality)
     , _searchRootPly(Ply()) // Important for this to be FEN ply + moves.size() when searching positions.
+    , _fullSearch(true)
+    , _startFen(fen)
+    , _adaptiveBudget{}
     , _result(CHESSCOACH_VALUE_UNINITIALIZED)
 {
 }
@@ -464,6 +495,8 @@ SelfPlayGame::SelfPlayGame(const SelfPlayGame& other)
     , _policy(other._policy)
     , _tablebaseCardinality(other._tablebaseCardinality)
     , _searchRootPly(other.Ply()) // Scratch games during MCTS need to snap off higher search roots.
+    , _fullSearch(other._fullSearch)
+    , _adaptiveBudget{} // Scratch games don't need the root's adaptive budget history.
     , _result(other._result)
 {
     assert(&other != this);
@@ -482,6 +515,8 @@ SelfPlayGame& SelfPlayGame::operator=(const SelfPlayGame& other)
     _policy = other._policy;
     _tablebaseCardinality = other._tablebaseCardinality;
     _searchRootPly = other.Ply(); // Scratch games during MCTS need to snap off higher search roots.
+    _fullSearch = other._fullSearch;
+    _adaptiveBudget = {}; // Scratch games don't need the root's adaptive budget history.
     _result = other._result;
 
     return *this;
@@ -496,8 +531,12 @@ SelfPlayGame::SelfPlayGame(SelfPlayGame&& other) noexcept
     , _policy(other._policy)
     , _tablebaseCardinality(other._tablebaseCardinality)
     , _searchRootPly(other._searchRootPly)
+    , _fullSearch(other._fullSearch)
     , _mctsValues(std::move(other._mctsValues))
     , _childVisits(std::move(other._childVisits))
+    , _policyRecorded(std::move(other._policyRecorded))
+    , _startFen(std::move(other._startFen))
+    , _adaptiveBudget(std::move(other._adaptiveBudget))
     , _result(other._result)
 {
     assert(&other != this);
@@ -518,8 +557,12 @@ SelfPlayGame& SelfPlayGame::operator=(SelfPlayGame&& other) noexcept
     _policy = other._policy;
     _tablebaseCardinality = other._tablebaseCardinality;
     _searchRootPly = other._searchRootPly;
+    _fullSearch = other._fullSearch;
     _mctsValues = std::move(other._mctsValues);
     _childVisits = std::move(other._childVisits);
+    _policyRecorded = std::move(other._policyRecorded);
+    _startFen = std::move(other._startFen);
+    _adaptiveBudget = std::move(other._adaptiveBudget);
     _result = other._result;
 
     other._root = nullptr;
@@ -588,8 +631,11 @@ bool SelfPlayGame::TakeExpansionOwnership(Node* node)
 }
 
 float SelfPlayGame::ExpandAndEvaluate(SelfPlayState& state, PredictionCacheChunk*& cacheStore, SearchState* searchState,
-    bool isSearchRoot, bool generateUniformPredictions)
+    SelfPlayMetrics* metrics, bool isSearchRoot, bool generateUniformPredictions)
 {
+    CHESSCOACH_TRACE_SCOPE("ExpandAndEvaluate");
+    const HardwareCounterScope counters(CounterPhase_Expansion);
+
     Node* root = _root;
 
     // A known-terminal leaf will remain a leaf, so be prepared to
@@ -700,14 +746,28 @@ float SelfPlayGame::ExpandAndEvaluate(SelfPlayState& state, PredictionCacheChunk
         cacheStore = nullptr;
         float cachedValue = std::numeric_limits<float>::quiet_NaN();
         bool hitCached = false;
-        if (!generateUniformPredictions &&
-            (workingMoveCount <= PredictionCacheEntry::MaxMoveCount) &&
-            (TryHard() || (Ply() <= Config::Misc.PredictionCache_MaxPly)))
+        const bool cacheEligible = (!generateUniformPredictions &&
+            (TryHard() || (Ply() <= Config::Misc.PredictionCache_MaxPly)));
+        if (cacheEligible && (workingMoveCount <= PredictionCacheEntry::MaxMoveCount))
         {
             // Note that "_imageKey" may be stale whenever "cacheStore" is null.
             _imageKey = GenerateImageKey(TryHard());
             hitCached = PredictionCache::Instance.TryGetPrediction(_imageKey, workingMoveCount,
                 &cacheStore, &cachedValue, _quantizedPriors.data());
+            if (metrics)
+            {
+                metrics->predictionCacheProbeCount.fetch_add(1, std::memory_order_relaxed);
+                metrics->predictionCacheHitCount.fetch_add((hitCached ? 1 : 0), std::memory_order_relaxed);
+            }
+            if (PredictionCacheTrace::Enabled())
+            {
+                PredictionCacheTrace::Record(_imageKey, workingMoveCount, hitCached);
+            }
+        }
+        else if (cacheEligible && PredictionCacheTrace::Enabled())
+        {
+            // Also capture positions with too many moves for the live cache so that larger entries can be simulated.
+            PredictionCacheTrace::Record(GenerateImageKey(TryHard()), workingMoveCount, false);
         }
         if (hitCached)
         {
@@ -723,6 +783,7 @@ float SelfPlayGame::ExpandAndEvaluate(SelfPlayState& state, PredictionCacheChunk
         state = SelfPlayState::WaitingForPrediction;
         if (!generateUniformPredictions)
         {
+            const HardwareCounterScope imageCounters(CounterPhase_ImageGeneration);
             GenerateImage(*_image);
             return std::numeric_limits<float>::quiet_NaN();
         }
@@ -790,20 +851,54 @@ float SelfPlayGame::FinishExpanding(SelfPlayState& state, PredictionCacheChunk*&
     }
 
     // Expand child nodes with the evaluated or cached priors.
-    const float firstPlayUrgency = (isSearchRoot ? CHESSCOACH_FIRST_PLAY_URGENCY_ROOT : CHESSCOACH_FIRST_PLAY_URGENCY_DEFAULT);
-    Expand(moveCount, firstPlayUrgency);
+    //
+    // Once the tree memory budget is reached, give up expansion ownership instead, leaving the node as a leaf.
+    // Later visits re-evaluate it (usually via the prediction cache) and keep refining values and visits
+    // throughout the existing tree.
+    if (WithinTreeMemoryBudget(searchState, isSearchRoot))
+    {
+        const float firstPlayUrgency = (isSearchRoot ? CHESSCOACH_FIRST_PLAY_URGENCY_ROOT : CHESSCOACH_FIRST_PLAY_URGENCY_DEFAULT);
+        Expand(moveCount, firstPlayUrgency);
+    }
+    else
+    {
+        _root->expansion.store(Expansion::None, std::memory_order_release);
+    }
 
     // Probe endgame tablebases for a WDL score for the parent.
     // No need to update "value" here for a successful probe: handled generally in Backpropagate().
-    if (Syzygy::ProbeWdl(*this, isSearchRoot))
+    bool tablebaseCacheHit;
+    if (Syzygy::ProbeWdl(*this, isSearchRoot, tablebaseCacheHit))
     {
         searchState->tablebaseHitCount.fetch_add(1, std::memory_order_relaxed);
+        if (tablebaseCacheHit)
+        {
+            searchState->tablebaseCacheHitCount.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
     state = SelfPlayState::Working;
     return value;
 }
 
+bool SelfPlayGame::WithinTreeMemoryBudget(SearchState* searchState, bool isSearchRoot) const
+{
+    // Only searches are budgeted, and the search root always needs children to make a move.
+    const int64_t budgetBytes = (static_cast<int64_t>(Config::Misc.Search_TreeMemoryMebibytes) << 20);
+    if (!TryHard() || isSearchRoot || (budgetBytes <= 0))
+    {
+        return true;
+    }
+
+    if (TreeBytes() < budgetBytes)
+    {
+        return true;
+    }
+
+    searchState->treeMemoryExhausted.store(true, std::memory_order_relaxed);
+    return false;
+}
+
 void SelfPlayGame::Expand(int moveCount, float firstPlayUrgency)
 {
     Node* root = _root;
@@ -811,8 +906,11 @@ void SelfPlayGame::Expand(int moveCount, float firstPlayUrgency)
     assert(moveCount > 0);
     assert(moveCount <= std::numeric_limits<uint8_t>::max());
 
+    AllocationTracker::Allocate(AllocationTag_NodeChildren, (moveCount * sizeof(Node)));
     root->children = new Node[moveCount]{};
     root->childCount = static_cast<uint8_t>(moveCount);
+    ChildNodeCount.fetch_add(moveCount, std::memory_order_relaxed);
+    ChildArrayCount.fetch_add(1, std::memory_order_relaxed);
     for (int i = 0; i < moveCount; i++)
     {
         root->children[i].move = static_cast<uint16_t>(_expandAndEvaluate_moves[i].move);
@@ -896,7 +994,13 @@ void SelfPlayGame::StoreSearchStatistics()
     {
         visits[Move(child.move)] = static_cast<float>(child.visitCount.load(std::memory_order_relaxed)) / sumChildVisits;
     }
+    AllocationTracker::Allocate(AllocationTag_ChildVisits,
+        (visits.size() * AllocationTracker::MapNodeBytes<std::map<Move, float>>()), visits.size());
     _mctsValues.push_back(CalculateMctsValue());
+
+    // Keep statistics for fast searches too so that stored positions line up with moves,
+    // but flag them so that training only samples positions with full searches.
+    _policyRecorded.push_back(_fullSearch ? 1 : 0);
 }
 
 void SelfPlayGame::Complete()
@@ -910,13 +1014,24 @@ void SelfPlayGame::Complete()
     PruneAll();
 }
 
+// Complete an adjudicated game (resignation or tablebases) with a result from white's perspective.
+void SelfPlayGame::Complete(float result)
+{
+    _result = result;
+
+    // Clear and detach from all nodes.
+    PruneAll();
+}
+
 SavedGame SelfPlayGame::Save() const
 {
-    return SavedGame(Result(), _moves, _mctsValues, _childVisits);
+    return SavedGame(Result(), _moves, _mctsValues, _childVisits, _policyRecorded, _startFen);
 }
 
 void SelfPlayGame::PruneExcept(Node* root, Node*& except)
 {
+    CHESSCOACH_TRACE_SCOPE("PruneExcept");
+
     if (!root)
     {
         return;
@@ -927,6 +1042,7 @@ void SelfPlayGame::PruneExcept(Node* root, Node*& except)
     assert(_root == except);
 
     // Hoist "except" from an array member to its own root allocation.
+    AllocationTracker::Allocate(AllocationTag_Node, sizeof(Node));
     _root = new Node(*except);
 
     // Don't let "except"'s descendants get pruned when the original is deleted.
@@ -935,20 +1051,22 @@ void SelfPlayGame::PruneExcept(Node* root, Node*& except)
 
     // Prune, then update the caller's "except" pointer (now deleted) to the clone.
     PruneAllInternal(root);
-    delete root;
+    DeleteRootNode(root);
     root = nullptr;
     except = _root;
 }
 
 void SelfPlayGame::PruneAll()
 {
+    CHESSCOACH_TRACE_SCOPE("PruneAll");
+
     if (!_root)
     {
         return;
     }
 
     PruneAllInternal(_root);
-    delete _root;
+    DeleteRootNode(_root);
     _root = nullptr;
 }
 
@@ -961,11 +1079,29 @@ void SelfPlayGame::PruneAllInternal(Node* node)
             PruneAllInternal(&child);
         }
     }
+    ChildNodeCount.fetch_sub(node->childCount, std::memory_order_relaxed);
+    if (node->children)
+    {
+        ChildArrayCount.fetch_sub(1, std::memory_order_relaxed);
+        AllocationTracker::Free(AllocationTag_NodeChildren, (node->childCount * sizeof(Node)));
+    }
     delete[] node->children;
     node->children = nullptr;
     node->childCount = 0;
 }
 
+int64_t SelfPlayGame::TreeNodeCount()
+{
+    return ChildNodeCount.load(std::memory_order_relaxed);
+}
+
+// Live tree memory, including heap overhead per child array, which matters most for small arrays near the leaves.
+int64_t SelfPlayGame::TreeBytes()
+{
+    return ((ChildNodeCount.load(std::memory_order_relaxed) * static_cast<int64_t>(sizeof(Node)))
+        + (ChildArrayCount.load(std::memory_order_relaxed) * ChildArrayOverheadBytes));
+}
+
 void SelfPlayGame::AddExplorationNoise()
 {
     std::gamma_distribution<float> gamma(Config::Network.SelfPlay.RootDirichletAlpha, 1.f);
@@ -1006,6 +1142,16 @@ int& SelfPlayGame::TablebaseCardinality()
     return *_tablebaseCardinality;
 }
 
+bool& SelfPlayGame::FullSearch()
+{
+    return _fullSearch;
+}
+
+AdaptiveBudgetState& SelfPlayGame::AdaptiveBudget()
+{
+    return _adaptiveBudget;
+}
+
 Move SelfPlayGame::ParseSan(const std::string& san)
 {
     return Pgn::ParseSan(_position, san);
@@ -1014,6 +1160,30 @@ Move SelfPlayGame::ParseSan(const std::string& san)
 // Don't clear the prediction cache more than once every 5 minutes
 // (aimed at preventing N self-play worker threads from each clearing).
 Throttle SelfPlayWorker::PredictionCacheResetThrottle(300 * 1000 /* durationMilliseconds */);
+AdjudicationStatistics SelfPlayWorker::AdjudicationStats[AdjudicationType_Count];
+// Games saved across self-play workers in this process, the same span as "AdjudicationStats",
+// for estimating plies saved per game.
+std::atomic_int SelfPlayWorker::AdjudicationGameCount;
+SlotStatistics SelfPlayWorker::SlotStats;
+
+// Print and reset slot occupancy across self-play workers, e.g. after each self-play stage.
+void SelfPlayWorker::PrintSlotStatistics()
+{
+    const int64_t slotCount = SlotStats.slotCount.exchange(0, std::memory_order_relaxed);
+    const int64_t occupiedSlotCount = SlotStats.occupiedSlotCount.exchange(0, std::memory_order_relaxed);
+    const int64_t batchCount = SlotStats.batchCount.exchange(0, std::memory_order_relaxed);
+    const int64_t boundarySlotCount = SlotStats.boundarySlotCount.exchange(0, std::memory_order_relaxed);
+    const int64_t boundaryOccupiedSlotCount = SlotStats.boundaryOccupiedSlotCount.exchange(0, std::memory_order_relaxed);
+    const int64_t boundaryBatchCount = SlotStats.boundaryBatchCount.exchange(0, std::memory_order_relaxed);
+    if (slotCount == 0)
+    {
+        return;
+    }
+
+    std::cout << "Slot occupancy: " << (static_cast<float>(occupiedSlotCount) / slotCount) << " over " << batchCount << " batches"
+        << ", round boundaries " << ((boundarySlotCount == 0) ? 1.f : (static_cast<float>(boundaryOccupiedSlotCount) / boundarySlotCount))
+        << " over " << boundaryBatchCount << " batches" << std::endl;
+}
 
 void SearchState::Reset(const TimeControl& setTimeControl, std::chrono::time_point<std::chrono::high_resolution_clock> setSearchStart)
 {
@@ -1021,15 +1191,24 @@ void SearchState::Reset(const TimeControl& setTimeControl, std::chrono::time_poi
     lastPrincipalVariationPrint = setSearchStart;
     lastBestMove = MOVE_NONE;
     lastBestNodes = 0;
+    lastBestTime = setSearchStart;
     timeControl = setTimeControl;
     previousNodeCount = 0;
     guiLine.clear();
     guiLineMoves.clear();
+    if (HardwareCounters::Enabled())
+    {
+        hardwareCountersStart = HardwareCounters::Take();
+    }
 
     nodeCount = 0;
     failedNodeCount = 0;
     tablebaseHitCount = 0;
+    tablebaseCacheHitCount = 0;
     principalVariationChanged = false;
+    treeMemoryExhausted = false;
+    tablebaseRootNanoseconds = -1;
+    tablebaseRootThreadCount = 0;
 }
 
 SelfPlayWorker::SelfPlayWorker(Storage* storage, SearchState* searchState, int gameCount)
@@ -1045,16 +1224,21 @@ SelfPlayWorker::SelfPlayWorker(Storage* storage, SearchState* searchState, int g
     , _gameStarts(gameCount)
     , _mctsSimulations(gameCount, 0)
     , _mctsSimulationLimits(gameCount, 0)
+    , _adjudications(gameCount)
+    , _treeReuses(gameCount)
     , _searchPaths(gameCount)
     , _cacheStores(gameCount)
+    , _metrics{}
     , _searchState(searchState)
+    , _workCoordinator(nullptr)
     , _currentParallelism(0)
+    , _slowstartWoken(false)
 {
 }
 
 void SelfPlayWorker::Initialize()
 {
-    // Allocate pooled StateInfos on the worker thread.
+    // Allocate pooled StateInfos on the worker thread, from its own cache.
     assert(_games.empty());
     assert(_scratchGames.empty());
     _games.resize(_states.size());
@@ -1063,17 +1247,17 @@ void SelfPlayWorker::Initialize()
 
 void SelfPlayWorker::Finalize()
 {
-    // Deallocate pooled StateInfos on the allocating worker thread.
+    // Free pooled StateInfos promptly so that idle slabs return to the OS.
     _scratchGames.clear();
     _games.clear();
 }
 
-void SelfPlayWorker::LoopSelfPlay(WorkCoordinator* workCoordinator, INetwork* network, NetworkType networkType, int /* threadIndex */)
+void SelfPlayWorker::LoopSelfPlay(WorkCoordinator* workCoordinator, INetwork* network, NetworkType networkType, int threadIndex)
 {
     Initialize();
 
     // Wait until games are required.
-    while (workCoordinator->WaitForWorkItems())
+    while (workCoordinator->WaitForWorkItems(threadIndex))
     {
         // Generate uniform predictions for the first network (rather than use random weights).
         _generateUniformPredictions = workCoordinator->GenerateUniformPredictions();
@@ -1111,6 +1295,7 @@ void SelfPlayWorker::LoopSelfPlay(WorkCoordinator* workCoordinator, INetwork* ne
         while (!workCoordinator->AllWorkItemsCompleted())
         {
             // CPU work
+            const std::chrono::time_point<std::chrono::high_resolution_clock> cpuStart = std::chrono::high_resolution_clock::now();
             for (int i = 0; i < _games.size(); i++)
             {
                 Play(i);
@@ -1128,9 +1313,15 @@ void SelfPlayWorker::LoopSelfPlay(WorkCoordinator* workCoordinator, INetwork* ne
             }
 
             // GPU work
+            const std::chrono::time_point<std::chrono::high_resolution_clock> predictStart = std::chrono::high_resolution_clock::now();
+            _metrics.cpuNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(predictStart - cpuStart).count(), std::memory_order_relaxed);
             if (!_generateUniformPredictions)
             {
+                RecordSlotOccupancy(workCoordinator->AllWorkItemsCompleted());
                 const PredictionStatus status = network->PredictBatch(networkType, static_cast<int>(_images.size()), _images.data(), _values.data(), _policies.data());
+                const std::chrono::nanoseconds predictDuration = (std::chrono::high_resolution_clock::now() - predictStart);
+                _metrics.predictNanoseconds.fetch_add(predictDuration.count(), std::memory_order_relaxed);
+                _metrics.predictLatency.Record(predictDuration);
                 if ((status & PredictionStatus_UpdatedNetwork) && PredictionCacheResetThrottle.TryFire())
                 {
                     // This thread has permission to clear the prediction cache after seeing an updated network.
@@ -1147,9 +1338,14 @@ void SelfPlayWorker::LoopSelfPlay(WorkCoordinator* workCoordinator, INetwork* ne
     Finalize();
 }
 
-int SelfPlayWorker::ChooseSimulationLimit()
+// Playout cap randomization (KataGo): only a proportion of moves get a full search and are recorded as policy targets.
+// The remaining moves use a much smaller cap, without exploration noise, just to advance the game, so that more games
+// (and so more independent value targets) are produced per unit of GPU time. Search (TryHard) always searches fully.
+int SelfPlayWorker::ChooseSimulationLimit(SelfPlayGame& game)
 {
-    return Config::Network.SelfPlay.NumSimulations;
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+    game.FullSearch() = (game.TryHard() || (distribution(Random::Engine) < Config::Network.SelfPlay.FullSimulationProportion));
+    return (game.FullSearch() ? Config::Network.SelfPlay.NumSimulations : Config::Network.SelfPlay.NumSimulationsFast);
 }
 
 void SelfPlayWorker::ClearGame(int index, const std::chrono::time_point<std::chrono::high_resolution_clock>& now)
@@ -1157,21 +1353,101 @@ void SelfPlayWorker::ClearGame(int index, const std::chrono::time_point<std::chr
     _states[index] = SelfPlayState::Working;
     _gameStarts[index] = now;
     _mctsSimulations[index] = 0;
-    _mctsSimulationLimits[index] = ChooseSimulationLimit();
+    _mctsSimulationLimits[index] = ChooseSimulationLimit(_games[index]);
     _searchPaths[index].clear();
     _cacheStores[index] = nullptr;
+
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+    _adjudications[index] = {};
+    _adjudications[index].verification = (distribution(Random::Engine) < Config::Network.SelfPlay.AdjudicationVerificationProportion);
+
+    _treeReuses[index] = {};
+    _treeReuses[index].simulationBudget = _mctsSimulationLimits[index];
 }
 
 void SelfPlayWorker::SetUpGame(int index, const std::chrono::time_point<std::chrono::high_resolution_clock>& now)
 {
+    // Set up the game before clearing so that the simulation limit can be chosen for it.
+    const std::string startFen = ChooseStartingPosition();
+    if (startFen == Game::StartingPosition)
+    {
+        _games[index] = SelfPlayGame(&_images[index], &_values[index], &_policies[index], &_tablebaseCardinalities[index]);
+    }
+    else
+    {
+        _games[index] = SelfPlayGame(startFen, {}, false /* tryHard */, &_images[index], &_values[index], &_policies[index], &_tablebaseCardinalities[index]);
+    }
     ClearGame(index, now);
-    _games[index] = SelfPlayGame(&_images[index], &_values[index], &_policies[index], &_tablebaseCardinalities[index]);
+}
+
+// Fork a proportion of games from positions remembered from recent games (see "AddForkPosition"),
+// giving more unique training positions per network evaluation than replaying the opening from the
+// starting position, which is mostly served from the prediction cache anyway. Each fork position is used once.
+std::string SelfPlayWorker::ChooseStartingPosition()
+{
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+    if (_forkPositions.empty() || (distribution(Random::Engine) >= Config::Network.SelfPlay.ForkProportion))
+    {
+        return Game::StartingPosition;
+    }
+
+    std::uniform_int_distribution<size_t> positionDistribution(0, _forkPositions.size() - 1);
+    const auto position = (_forkPositions.begin() + positionDistribution(Random::Engine));
+    const std::string fen = std::move(*position);
+    _forkPositions.erase(position);
+    return fen;
+}
+
+// Remember the position before the largest swing in MCTS value over a single move, from the moving player's
+// perspective, as a fork position for future games. A large drop usually means a blunder (e.g. a move sampled
+// for diversity) and a large rise means an unsettled evaluation; either way, the position deserves more data.
+void SelfPlayWorker::AddForkPosition(const SavedGame& savedGame)
+{
+    if (Config::Network.SelfPlay.ForkProportion <= 0.f)
+    {
+        return;
+    }
+
+    // Only trust values from full searches (playout cap randomization).
+    int forkMove = -1;
+    float largestSwing = Config::Network.SelfPlay.ForkValueSwingThreshold;
+    for (int m = 0; m < (savedGame.moveCount - 1); m++)
+    {
+        if (!savedGame.policyRecorded[m] || !savedGame.policyRecorded[m + 1])
+        {
+            continue;
+        }
+
+        const float swing = std::abs(savedGame.mctsValues[m] - Game::FlipValue(savedGame.mctsValues[m + 1]));
+        if (swing >= largestSwing)
+        {
+            largestSwing = swing;
+            forkMove = m;
+        }
+    }
+    if (forkMove < 0)
+    {
+        return;
+    }
+
+    Game scratchGame(savedGame.startFen, {});
+    for (int m = 0; m < forkMove; m++)
+    {
+        scratchGame.ApplyMove(Move(savedGame.moves[m]));
+    }
+
+    if (_forkPositions.size() >= ForkPositionCapacity)
+    {
+        _forkPositions.pop_front();
+    }
+    _forkPositions.emplace_back(scratchGame.GetPosition().fen());
 }
 
 void SelfPlayWorker::SetUpGame(int index, const std::chrono::time_point<std::chrono::high_resolution_clock>& now, const std::string& fen, const std::vector<Move>& moves, bool tryHard)
 {
-    ClearGame(index, now);
+    // Set up the game before clearing so that the simulation limit can be chosen for it.
     _games[index] = SelfPlayGame(fen, moves, tryHard, &_images[index], &_values[index], &_policies[index], &_tablebaseCardinalities[index]);
+    ClearGame(index, now);
 }
 
 void SelfPlayWorker::SetUpGameExisting(int index, const std::chrono::time_point<std::chrono::high_resolution_clock>& now, const std::vector<Move>& moves, int applyNewMovesOffset)
@@ -1208,7 +1484,7 @@ void SelfPlayWorker::SetUpGameExisting(int index, const std::chrono::time_point<
         }
         else
         {
-            newRoot = ((i == (moves.size() - 1)) ? new Node() : nullptr);
+            newRoot = ((i == (moves.size() - 1)) ? NewRootNode() : nullptr);
             game.PruneAll();
             game.ApplyMoveWithRoot(move, newRoot);
         }
@@ -1265,7 +1541,7 @@ void SelfPlayWorker::StrengthTestNetwork(WorkCoordinator* workCoordinator, INetw
     const std::filesystem::path epdPath = (Platform::InstallationDataPath() / "StrengthTests" / "STS.epd");
     std::cout << "Testing " << epdPath.filename() << "..." << std::endl;
     const auto [score, total, positions, totalNodesRequired] = StrengthTestEpd(workCoordinator, epdPath,
-        moveTimeMs, 0 /* nodes */, 0 /* failureNodes */, 0 /* positionLimit */, nullptr /* progress */);
+        moveTimeMs, 0 /* nodes */, 0 /* failureNodes */, 0 /* positionLimit */, nullptr /* progress */, nullptr /* performancesOut */);
 
     // Estimate an Elo rating using logic here: https://github.com/fsmosca/STS-Rating/blob/master/sts_rating.py
     const float slope = 445.23f;
@@ -1286,10 +1562,11 @@ void SelfPlayWorker::StrengthTestNetwork(WorkCoordinator* workCoordinator, INetw
     network->LogScalars(networkType, checkpoint, names, values.data());
 }
 
-// Returns (score, total, positions, totalNodesRequired).
+// Returns (score, total, positions, totalNodesRequired), and optionally appends search speed per position.
 std::tuple<int, int, int, int> SelfPlayWorker::StrengthTestEpd(WorkCoordinator* workCoordinator, const std::filesystem::path& epdPath,
     int moveTimeMs, int nodes, int failureNodes, int positionLimit,
-    std::function<void(const std::string&, const std::string&, const std::string&, int, int, int)> progress)
+    std::function<void(const std::string&, const std::string&, const std::string&, int, int, int)> progress,
+    std::vector<StrengthTestPerformance>* performancesOut)
 {
     int score = 0;
     int total = 0;
@@ -1310,8 +1587,19 @@ std::tuple<int, int, int, int> SelfPlayWorker::StrengthTestEpd(WorkCoordinator*
     for (int i = 0; i < positions; i++)
     {
         const StrengthTestSpec& spec = specs[i];
-        const auto [move, points, nodesRequired] = StrengthTestPosition(workCoordinator, spec, moveTimeMs, nodes, failureNodes);
+        StrengthTestPerformance performance;
+        const auto [move, points, nodesRequired] = StrengthTestPosition(workCoordinator, spec, moveTimeMs, nodes, failureNodes, performance);
         const int available = (spec.points.empty() ? 1 : *std::max_element(spec.points.begin(), spec.points.end()));
+        if (performancesOut)
+        {
+            performance.solved = (points == available);
+            if (!performance.solved)
+            {
+                performance.nodesToSolution = 0;
+                performance.secondsToSolution = 0.f;
+            }
+            performancesOut->push_back(performance);
+        }
         score += points;
         total += available;
         totalNodesRequired += nodesRequired;
@@ -1338,7 +1626,8 @@ std::tuple<int, int, int, int> SelfPlayWorker::StrengthTestEpd(WorkCoordinator*
 
 // For best-move tests returns 1 if correct or 0 if incorrect.
 // For points/alternative tests returns N points or 0 if incorrect.
-std::tuple<Move, int, int> SelfPlayWorker::StrengthTestPosition(WorkCoordinator* workCoordinator, const StrengthTestSpec& spec, int moveTimeMs, int nodes, int failureNodes)
+std::tuple<Move, int, int> SelfPlayWorker::StrengthTestPosition(WorkCoordinator* workCoordinator, const StrengthTestSpec& spec, int moveTimeMs, int nodes, int failureNodes,
+    StrengthTestPerformance& performanceOut)
 {
     // Make sure that the workers are ready.
     workCoordinator->WaitForWorkers();
@@ -1355,6 +1644,14 @@ std::tuple<Move, int, int> SelfPlayWorker::StrengthTestPosition(WorkCoordinator*
     // Run the search.
     workCoordinator->ResetWorkItemsRemaining(1);
     workCoordinator->WaitForWorkers();
+    const std::chrono::time_point<std::chrono::high_resolution_clock> searchEnd = std::chrono::high_resolution_clock::now();
+
+    // Record search speed. The caller judges whether the position was solved.
+    performanceOut.fen = spec.fen;
+    performanceOut.nodes = _searchState->nodeCount.load(std::memory_order_relaxed);
+    performanceOut.seconds = std::chrono::duration<float>(searchEnd - _searchState->searchStart).count();
+    performanceOut.nodesToSolution = _searchState->lastBestNodes;
+    performanceOut.secondsToSolution = std::chrono::duration<float>(_searchState->lastBestTime - _searchState->searchStart).count();
 
     // Pick a best move and judge points.
     const Node* best = SelectMove(_games[0], false /* allowDiversity */);
@@ -1425,10 +1722,33 @@ void SelfPlayWorker::Play(int index)
         assert(mctsFinished);
         assert(selected != nullptr);
         game.StoreSearchStatistics();
+        if (game.FullSearch())
+        {
+            _treeReuses[index].policyEntropySum += CalculatePolicyEntropy(root);
+            _treeReuses[index].policyEntropyCount++;
+        }
+
+        // Choose the next search's limit before applying the move, since preparing an already-expanded
+        // new root adds exploration noise only for full searches.
+        _mctsSimulationLimits[index] = ChooseSimulationLimit(game);
+        const float whiteValue = Game::FlipValue(game.ToPlay(), root->BestChild()->Value());
         game.ApplyMoveWithRootAndExpansion(Move(selected->move), selected, *this);
         game.PruneExcept(root, selected /* == game.Root() */);
         // Use release-store to synchronize with the acquire-load of the PV printing so that the PV is updated.
         _searchState->principalVariationChanged.store(true, std::memory_order_release); // First move in PV is now gone.
+
+        // Avoid playing out games that are already decided. Terminal positions won't be searched,
+        // so only book tree reuse for the next search otherwise.
+        if (!IsTerminal(game))
+        {
+            if (Adjudicate(index, whiteValue))
+            {
+                state = SelfPlayState::Finished;
+                return;
+            }
+
+            ReuseTree(index);
+        }
     }
 
     // Clean up resources in use and save the result.
@@ -1442,17 +1762,219 @@ bool SelfPlayWorker::IsTerminal(const SelfPlayGame& game) const
     return (game.Root()->terminalValue.load(std::memory_order_relaxed).IsImmediate() || (game.Ply() >= Config::Network.SelfPlay.MaxMoves));
 }
 
+// Record a verification game played out to "ply" with "result" (from white's perspective), returning whether
+// the adjudication was a false positive.
+bool AdjudicationStatistics::RecordVerified(const AdjudicationState& adjudication, int ply, float result)
+{
+    const bool falsePositive = (result != adjudication.result);
+    verifiedCount.fetch_add(1, std::memory_order_relaxed);
+    verifiedFalsePositiveCount.fetch_add(falsePositive ? 1 : 0, std::memory_order_relaxed);
+    verifiedPliesRemaining.fetch_add(ply - adjudication.ply, std::memory_order_relaxed);
+    return falsePositive;
+}
+
+float AdjudicationStatistics::FalsePositiveRate() const
+{
+    const int verified = verifiedCount.load(std::memory_order_relaxed);
+    return ((verified > 0) ? (static_cast<float>(verifiedFalsePositiveCount.load(std::memory_order_relaxed)) / verified) : 0.f);
+}
+
+float AdjudicationStatistics::AveragePliesRemaining() const
+{
+    const int verified = verifiedCount.load(std::memory_order_relaxed);
+    return ((verified > 0) ? (static_cast<float>(verifiedPliesRemaining.load(std::memory_order_relaxed)) / verified) : 0.f);
+}
+
+// Resign when one side has been clearly lost for enough consecutive plies, or adjudicate using tablebases.
+// Returns true if the game was completed. The value is the MCTS value for the previous position, from white's perspective.
+bool SelfPlayWorker::Adjudicate(int index, float whiteValue)
+{
+    SelfPlayGame& game = _games[index];
+    AdjudicationState& adjudication = _adjudications[index];
+
+    // Verification games only need to remember the first adjudication.
+    if (adjudication.verification && (adjudication.type != AdjudicationType_None))
+    {
+        return false;
+    }
+
+    // Count consecutive plies that each side has been clearly losing.
+    const float threshold = Config::Network.SelfPlay.ResignValueThreshold;
+    adjudication.lostPlies[WHITE] = ((whiteValue <= threshold) ? (adjudication.lostPlies[WHITE] + 1) : 0);
+    adjudication.lostPlies[BLACK] = ((whiteValue >= (CHESSCOACH_VALUE_WIN - threshold)) ? (adjudication.lostPlies[BLACK] + 1) : 0);
+
+    const int resignPlies = Config::Network.SelfPlay.ResignConsecutivePlies;
+    AdjudicationType type = AdjudicationType_None;
+    float result = CHESSCOACH_VALUE_UNINITIALIZED;
+    if ((resignPlies > 0) && (adjudication.lostPlies[WHITE] >= resignPlies))
+    {
+        type = AdjudicationType_Resignation;
+        result = CHESSCOACH_VALUE_LOSS;
+    }
+    else if ((resignPlies > 0) && (adjudication.lostPlies[BLACK] >= resignPlies))
+    {
+        type = AdjudicationType_Resignation;
+        result = CHESSCOACH_VALUE_WIN;
+    }
+    else if (Config::Network.SelfPlay.AdjudicateTablebases && Syzygy::ProbeWdlAdjudication(game, result))
+    {
+        type = AdjudicationType_Tablebase;
+    }
+
+    if (type == AdjudicationType_None)
+    {
+        return false;
+    }
+
+    adjudication.type = type;
+    adjudication.ply = game.Ply();
+    adjudication.result = result;
+
+    // Play out verification games to measure false positives and plies saved (see "SaveToStorageAndLog").
+    if (adjudication.verification)
+    {
+        return false;
+    }
+
+    AdjudicationStats[type].adjudicatedCount.fetch_add(1, std::memory_order_relaxed);
+    game.Complete(result);
+    return true;
+}
+
+// The MCTS tree is always reused between moves. If configured, count the visits inherited by the new root
+// towards its simulation budget, but leave enough new simulations for exploration noise on the reused root
+// (see "PrepareExpandedRoot") to have an effect; otherwise, inherited visits allocated without noise would dominate.
+void SelfPlayWorker::ReuseTree(int index)
+{
+    TreeReuseState& treeReuse = _treeReuses[index];
+    const int simulationLimit = _mctsSimulationLimits[index];
+    treeReuse.simulationBudget += simulationLimit;
+
+    if (Config::Network.SelfPlay.SimulationBudgetCountsInherited)
+    {
+        // Lower the limit rather than crediting the simulation count, so that "RunMcts" only counts
+        // new simulations, for simulations per game and second and for adaptive budget checks.
+        assert(_mctsSimulations[index] == 0);
+        const int inheritedVisits = _games[index].Root()->visitCount.load(std::memory_order_relaxed);
+        const int maximumSaved = std::max(0, simulationLimit - Config::Network.SelfPlay.TreeReuseMinimumSimulations);
+        const int simulationsSaved = std::clamp(inheritedVisits, 0, maximumSaved);
+        _mctsSimulationLimits[index] -= simulationsSaved;
+        treeReuse.simulationsSaved += simulationsSaved;
+    }
+}
+
+// Entropy of the root's child visit distribution, measuring the sharpness of the policy training target.
+float SelfPlayWorker::CalculatePolicyEntropy(const Node* root) const
+{
+    float sumChildVisits = 0.f;
+    for (const Node& child : *root)
+    {
+        sumChildVisits += static_cast<float>(child.visitCount.load(std::memory_order_relaxed));
+    }
+
+    float entropy = 0.f;
+    for (const Node& child : *root)
+    {
+        const float probability = (static_cast<float>(child.visitCount.load(std::memory_order_relaxed)) / sumChildVisits);
+        if (probability > 0.f)
+        {
+            entropy -= (probability * std::log(probability));
+        }
+    }
+    return entropy;
+}
+
 void SelfPlayWorker::SaveToStorageAndLog(INetwork* network, int index)
 {
     const SelfPlayGame& game = _games[index];
 
     const int ply = game.Ply();
     const float result = game.Result();
-    const int gameNumber = _storage->AddTrainingGame(network, game.Save());
+    SavedGame savedGame = game.Save();
+    const int moveCount = savedGame.moveCount;
+    const int recorded = savedGame.PolicyRecordedCount();
+    const bool forked = (savedGame.startFen != Game::StartingPosition);
+    AddForkPosition(savedGame);
+
+    // Time saving separately (within CPU work) since it includes chunking, with compression and I/O.
+    const std::chrono::time_point<std::chrono::high_resolution_clock> storageStart = std::chrono::high_resolution_clock::now();
+    const int gameNumber = _storage->AddTrainingGame(network, std::move(savedGame));
+    _metrics.storageNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - storageStart).count(), std::memory_order_relaxed);
 
     const float gameTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - _gameStarts[index]).count();
-    const float mctsTime = (gameTime / ply);
-    std::cout << "Game " << gameNumber << ", ply " << ply << ", time " << gameTime << ", mcts time " << mctsTime << ", result " << result << std::endl;
+    const float mctsTime = (gameTime / moveCount);
+    std::cout << "Game " << gameNumber << ", ply " << ply << ", recorded " << recorded << ", time " << gameTime << ", mcts time " << mctsTime << ", result " << result;
+    if (forked)
+    {
+        std::cout << ", forked";
+    }
+
+    // Log the proportion of the simulation budget saved by tree reuse alongside policy target sharpness (mean entropy).
+    const TreeReuseState& treeReuse = _treeReuses[index];
+    const float simulationsSavedProportion = (treeReuse.simulationBudget > 0)
+        ? (static_cast<float>(treeReuse.simulationsSaved) / treeReuse.simulationBudget) : 0.f;
+    const float policyEntropy = (treeReuse.policyEntropyCount > 0)
+        ? (treeReuse.policyEntropySum / treeReuse.policyEntropyCount) : 0.f;
+    std::cout << ", reuse saved " << simulationsSavedProportion << ", policy entropy " << policyEntropy;
+
+    // Log simulations spent on the game, which vary with playout cap randomization, tree reuse and adaptive simulations.
+    const AdaptiveBudgetState& adaptiveBudget = _games[index].AdaptiveBudget();
+    _metrics.gameCount.fetch_add(1, std::memory_order_relaxed);
+    _metrics.plyCount.fetch_add(moveCount, std::memory_order_relaxed);
+    _metrics.simulationCount.fetch_add(adaptiveBudget.simulationsUsed, std::memory_order_relaxed);
+    std::cout << ", simulations " << adaptiveBudget.simulationsUsed << " (" << (static_cast<float>(adaptiveBudget.simulationsUsed) / std::max(1, adaptiveBudget.movesSearched)) << "/move)";
+
+    // Log adjudication, using verification games to estimate the plies and time saved per adjudicated game.
+    const AdjudicationState& adjudication = _adjudications[index];
+    const int adjudicationGameCount = (AdjudicationGameCount.fetch_add(1, std::memory_order_relaxed) + 1);
+    if (adjudication.type != AdjudicationType_None)
+    {
+        AdjudicationStatistics& statistics = AdjudicationStats[adjudication.type];
+        if (adjudication.verification)
+        {
+            const bool falsePositive = statistics.RecordVerified(adjudication, ply, result);
+            std::cout << ", verified " << AdjudicationTypeNames[adjudication.type] << " at ply " << adjudication.ply
+                << (falsePositive ? " (false positive)" : " (correct)") << ", false positive rate "
+                << statistics.FalsePositiveRate();
+        }
+        else
+        {
+            std::cout << ", " << AdjudicationTypeNames[adjudication.type];
+            if (statistics.verifiedCount.load(std::memory_order_relaxed) > 0)
+            {
+                const float pliesSaved = statistics.AveragePliesRemaining();
+                const int64_t estimatedPliesSaved = (statistics.estimatedPliesSaved.fetch_add(static_cast<int64_t>(pliesSaved), std::memory_order_relaxed)
+                    + static_cast<int64_t>(pliesSaved));
+                std::cout << ", saved ~" << pliesSaved << " plies (~" << (pliesSaved * mctsTime) << " s), average ~"
+                    << (static_cast<float>(estimatedPliesSaved) / adjudicationGameCount) << " plies/game";
+            }
+        }
+    }
+    std::cout << std::endl;
+}
+
+// Count slots waiting on predictions per batch, overall and at round boundaries, to measure device utilization.
+// Idle slots (finished games at a round boundary) are still submitted with the full batch, since the
+// work coordinator's games are complete and compacting only that final batch wouldn't pay for extra warm-up shapes.
+void SelfPlayWorker::RecordSlotOccupancy(bool roundBoundary)
+{
+    const int slotCount = static_cast<int>(_games.size());
+    const int occupiedCount = static_cast<int>(std::count(_states.begin(), _states.end(), SelfPlayState::WaitingForPrediction));
+
+    _metrics.batchCount.fetch_add(1, std::memory_order_relaxed);
+    _metrics.batchSlotCount.fetch_add(slotCount, std::memory_order_relaxed);
+    _metrics.batchOccupiedSlotCount.fetch_add(occupiedCount, std::memory_order_relaxed);
+
+    SlotStats.batchCount.fetch_add(1, std::memory_order_relaxed);
+    SlotStats.slotCount.fetch_add(slotCount, std::memory_order_relaxed);
+    SlotStats.occupiedSlotCount.fetch_add(occupiedCount, std::memory_order_relaxed);
+    if (roundBoundary)
+    {
+        SlotStats.boundaryBatchCount.fetch_add(1, std::memory_order_relaxed);
+        SlotStats.boundarySlotCount.fetch_add(slotCount, std::memory_order_relaxed);
+        SlotStats.boundaryOccupiedSlotCount.fetch_add(occupiedCount, std::memory_order_relaxed);
+    }
 }
 
 void SelfPlayWorker::PredictBatchUniform(int batchSize, INetwork::InputPlanes* /*images*/, float* values, INetwork::OutputPlanes* policies)
@@ -1467,6 +1989,8 @@ void SelfPlayWorker::PredictBatchUniform(int batchSize, INetwork::InputPlanes* /
 bool SelfPlayWorker::RunMcts(SelfPlayGame& game, SelfPlayGame& scratchGame, SelfPlayState& state, int& mctsSimulation, int& mctsSimulationLimit,
     std::vector<WeightedNode>& searchPath, PredictionCacheChunk*& cacheStore, bool finishOnly)
 {
+    CHESSCOACH_TRACE_SCOPE("RunMcts");
+
     // Don't get stuck in here forever during search (TryHard) looping on cache hits or terminal nodes.
     // We need to break out and check for PV changes, search stopping, etc. However, need to keep number
     // high enough to get good speed-up from prediction cache hits. Go with 1000 for now.
@@ -1486,6 +2010,9 @@ bool SelfPlayWorker::RunMcts(SelfPlayGame& game, SelfPlayGame& scratchGame, Self
                 return false;
             }
 
+            CHESSCOACH_TRACE_SCOPE("SelectChildren");
+            const HardwareCounterScope counters(CounterPhase_Selection);
+
             // MCTS tree parallelism - enabled when searching, not when training - needs some guidance
             // to avoid repeating the same deterministic child selections:
             // - Avoid branches + leaves by incrementing "visitingCount" while selecting a search path,
@@ -1530,7 +2057,7 @@ bool SelfPlayWorker::RunMcts(SelfPlayGame& game, SelfPlayGame& scratchGame, Self
         // because beyond trivially cached terminal evaluations, both depend on move generation.
         const bool wasImmediateMate = (scratchGame.Root()->terminalValue.load(std::memory_order_relaxed) == TerminalValue::MateIn<1>());
         const bool isSearchRoot = (game.Root() == scratchGame.Root());
-        float value = scratchGame.ExpandAndEvaluate(state, cacheStore, _searchState, isSearchRoot, _generateUniformPredictions);
+        float value = scratchGame.ExpandAndEvaluate(state, cacheStore, _searchState, &_metrics, isSearchRoot, _generateUniformPredictions);
         if (state == SelfPlayState::WaitingForPrediction)
         {
             // Wait for network evaluation/priors to come back.
@@ -1600,11 +2127,29 @@ bool SelfPlayWorker::RunMcts(SelfPlayGame& game, SelfPlayGame& scratchGame, Self
         {
             scratchGame.Root()->expansion.store(Expansion::Expanded, std::memory_order_release);
         }
+
+        // Self-play can stop full searches early once the root visit distribution converges (adaptive simulations).
+        // "mctsSimulation" only counts new simulations (tree reuse lowers the limit instead), so the check interval
+        // and minimum don't count visits inherited from the previous search.
+        if (!game.TryHard() && game.FullSearch() && Config::Network.SelfPlay.AdaptiveSimulations &&
+            (((mctsSimulation + 1) % Config::Network.SelfPlay.AdaptiveCheckInterval) == 0))
+        {
+            UpdateAdaptiveBudget(game, (mctsSimulation + 1), mctsSimulationLimit);
+        }
     }
 
-    // Self-play resets the simulation count/limit here between moves within a game.
+    // Track simulations per game, and forget the previous root's visit distribution.
+    if (!game.TryHard())
+    {
+        AdaptiveBudgetState& adaptiveBudget = game.AdaptiveBudget();
+        adaptiveBudget.visitSnapshot.clear();
+        adaptiveBudget.simulationsUsed += mctsSimulation;
+        adaptiveBudget.movesSearched++;
+    }
+
+    // Self-play resets the simulation count here between moves within a game. The limit for the next search
+    // is chosen in "Play" after the search statistics are stored, since they depend on this search's limit.
     mctsSimulation = 0;
-    mctsSimulationLimit = ChooseSimulationLimit();
     return true;
 }
 
@@ -1618,6 +2163,11 @@ void SelfPlayWorker::FailNode(std::vector<WeightedNode>& searchPath)
     _searchState->failedNodeCount.fetch_add(1, std::memory_order_relaxed);
 }
 
+const SelfPlayMetrics& SelfPlayWorker::Metrics() const
+{
+    return _metrics;
+}
+
 void SelfPlayWorker::UpdateGameForNewSearchRoot(SelfPlayGame& game)
 {
     // Update the search root ply for draw-checking.
@@ -1631,12 +2181,70 @@ void SelfPlayWorker::UpdateGameForNewSearchRoot(SelfPlayGame& game)
     }
 }
 
+// Stop the search once the root visit distribution has converged, banking the remaining budget.
+// If instead the budget has run out without converging, extend the search using banked simulations
+// (if configured), one check interval at a time, up to the maximum.
+// Stops early and banks the rest of the limit once converged, after at least the minimum new simulations.
+// Otherwise, at the limit, extends it from the bank by up to one check interval, capped at the maximum.
+void SelfPlayWorker::UpdateAdaptiveBudget(SelfPlayGame& game, int simulations, int& simulationLimit)
+{
+    AdaptiveBudgetState& adaptiveBudget = game.AdaptiveBudget();
+    const float divergence = CalculateVisitDivergence(game.Root(), adaptiveBudget.visitSnapshot);
+    const bool converged = (divergence < Config::Network.SelfPlay.AdaptiveDivergenceThreshold);
+
+    if (converged && (simulations >= Config::Network.SelfPlay.AdaptiveMinimumSimulations))
+    {
+        adaptiveBudget.simulationBank += (simulationLimit - simulations);
+        simulationLimit = simulations;
+    }
+    else if (!converged && (simulations >= simulationLimit) && Config::Network.SelfPlay.AdaptiveReassignSaved)
+    {
+        const int extension = std::min({ adaptiveBudget.simulationBank, Config::Network.SelfPlay.AdaptiveCheckInterval,
+            (Config::Network.SelfPlay.AdaptiveMaximumSimulations - simulationLimit) });
+        if (extension > 0)
+        {
+            adaptiveBudget.simulationBank -= extension;
+            simulationLimit += extension;
+        }
+    }
+}
+
+// KL divergence of the root's current visit distribution from the snapshot at the previous check,
+// using add-one smoothing so that unvisited children don't divide by zero. Updates the snapshot.
+// Returns infinity if there's no comparable snapshot yet.
+float SelfPlayWorker::CalculateVisitDivergence(const Node* root, std::vector<float>& visitSnapshot) const
+{
+    float sumChildVisits = 0.f;
+    for (const Node& child : *root)
+    {
+        sumChildVisits += static_cast<float>(child.visitCount.load(std::memory_order_relaxed));
+    }
+
+    const bool comparable = (visitSnapshot.size() == root->childCount);
+    visitSnapshot.resize(root->childCount);
+
+    float divergence = 0.f;
+    for (int i = 0; i < root->childCount; i++)
+    {
+        const float probability = ((static_cast<float>(root->children[i].visitCount.load(std::memory_order_relaxed)) + 1.f)
+            / (sumChildVisits + root->childCount));
+        if (comparable)
+        {
+            divergence += (probability * std::log(probability / visitSnapshot[i]));
+        }
+        visitSnapshot[i] = probability;
+    }
+    return (comparable ? divergence : std::numeric_limits<float>::infinity());
+}
+
 // This is a common path for self-play and search, (a) when expanding an initial/updated root, or (b) when updating the root to an already-expanded child.
 // - For both self-play and search, case (a) is recognized by "isSearchRoot" in "RunMcts".
 // - For self-play, case (b) will almost always be hit after the starting position, since each immediate child should be visited at least once, and we reuse the MCTS tree.
 // - For search, case (b) will be hit when we're able to reuse an existing position; e.g., after moves have been played, or searching deeper positions without a "ucinewgame".
 void SelfPlayWorker::PrepareExpandedRoot(SelfPlayGame& game)
 {
+    CHESSCOACH_TRACE_SCOPE("PrepareExpandedRoot");
+
     // Set first-play urgency (FPU) to a win here for children of the root.
     for (Node& child : *game.Root())
     {
@@ -1650,8 +2258,9 @@ void SelfPlayWorker::PrepareExpandedRoot(SelfPlayGame& game)
         }
     }
 
-    // Add exploration noise if not searching.
-    if (!game.TryHard())
+    // Add exploration noise if not searching, and only for full searches that will be recorded for training
+    // (see "ChooseSimulationLimit"). Fast searches just advance the game.
+    if (!game.TryHard() && game.FullSearch())
     {
         game.AddExplorationNoise();
     }
@@ -1667,8 +2276,20 @@ void SelfPlayWorker::PrepareExpandedRoot(SelfPlayGame& game)
     // When there are too many pieces at the root to probe endgame tablebases, we can still try
     // to probe individual leaf positions when they reach few enough pieces. We only probe win/draw/loss (WDL)
     // "at zero", when progress has just been made (pawn move or capture). Accurate search is still very necessary.
-    if (Syzygy::ProbeTablebasesAtRoot(game))
+    //
+    // When searching, share root probes with threads idling in slowstart (see "SearchPlay") so that
+    // the first batch isn't delayed by probing every root move on this thread.
+    TablebaseRootRanking* const ranking = ((game.TryHard() && _workCoordinator) ? &_searchState->tablebaseRanking : nullptr);
+    const std::chrono::time_point<std::chrono::high_resolution_clock> probeStart = std::chrono::high_resolution_clock::now();
+    if (Syzygy::ProbeTablebasesAtRoot(game, ranking, _workCoordinator))
     {
+        if (ranking)
+        {
+            const std::chrono::nanoseconds probeTime = (std::chrono::high_resolution_clock::now() - probeStart);
+            _searchState->tablebaseRootNanoseconds.store(probeTime.count(), std::memory_order_relaxed);
+            _searchState->tablebaseRootThreadCount.store(ranking->LastThreadCount(), std::memory_order_relaxed);
+        }
+
         // In addition to setting tablebase ranks, which we use even before proven mate categories for move selection,
         // we just updated root child value: not just FPU, but bounded value for nodes with existing valueWeight too.
         // Fix up the principal variation to take all of this into account. This may result in a "bestChild", or
@@ -1942,6 +2563,9 @@ float PuctContext::VirtualExploration(const Node* node) const
 
 void SelfPlayWorker::Backpropagate(std::vector<WeightedNode>& searchPath, float value, float rootValue)
 {
+    CHESSCOACH_TRACE_SCOPE("Backpropagate");
+    const HardwareCounterScope counters(CounterPhase_Backpropagation);
+
     // Each ply has a different player, so flip each time.
     const float movingAverageBuild = Config::Network.SelfPlay.MovingAverageBuild;
     const float movingAverageCap = Config::Network.SelfPlay.MovingAverageCap;
@@ -2241,6 +2865,16 @@ void SelfPlayWorker::DebugGame(int index, SelfPlayGame** gameOut, SelfPlayState*
     if (policiesOut) *policiesOut = &_policies[index];
 }
 
+int SelfPlayWorker::DebugSimulationLimit(int index) const
+{
+    return _mctsSimulationLimits[index];
+}
+
+const AdjudicationState& SelfPlayWorker::DebugAdjudication(int index) const
+{
+    return _adjudications[index];
+}
+
 // Doesn't try to clear or set up games appropriately, just resets allocations.
 void SelfPlayWorker::DebugResetGame(int index)
 {
@@ -2252,6 +2886,7 @@ void SelfPlayWorker::LoopSearch(WorkCoordinator* workCoordinator, INetwork* netw
 {
     const bool primary = (threadIndex == 0);
     Initialize();
+    _workCoordinator = workCoordinator;
 
     // Warm up the GIL and predictions.
     // It's important to hit TPUs with each possible batch size to avoid 2+ second latency later
@@ -2260,18 +2895,19 @@ void SelfPlayWorker::LoopSearch(WorkCoordinator* workCoordinator, INetwork* netw
     WarmUpPredictions(network, networkType, static_cast<int>(_games.size()));
 
     // Wait until searching is required.
-    while (workCoordinator->WaitForWorkItems())
+    while (workCoordinator->WaitForWorkItems(threadIndex))
     {
         // Initialize the search. Multiple threads will race to make shadows of the reference position,
         // which is safe because the shallow fields don't mutate. Care just needs to be taken with the
         // shared Node tree.
         SearchInitialize(_searchState->position);
+        std::chrono::nanoseconds firstBatchLatency(-1);
 
         // Search until stopped.
         while (!workCoordinator->AllWorkItemsCompleted())
         {
             // CPU work
-            if (!SearchPlay(threadIndex))
+            if (!SearchPlay(workCoordinator, threadIndex))
             {
                 continue;
             }
@@ -2284,6 +2920,11 @@ void SelfPlayWorker::LoopSearch(WorkCoordinator* workCoordinator, INetwork* netw
                 CheckUpdateGui(network, false /* forceUpdate */);
 
                 CheckTimeControl(workCoordinator);
+
+                if (firstBatchLatency.count() < 0)
+                {
+                    firstBatchLatency = workCoordinator->SinceWorkRequested();
+                }
             }
 
             // GPU work
@@ -2297,7 +2938,7 @@ void SelfPlayWorker::LoopSearch(WorkCoordinator* workCoordinator, INetwork* netw
         if (primary)
         {
             CheckUpdateGui(network, true /* forceUpdate */);
-            const Move bestMove = OnSearchFinished();
+            const Move bestMove = OnSearchFinished(workCoordinator, firstBatchLatency);
 
             // Report the best move to bot code in Python.
             if (!_searchState->botGameId.empty() && !_searchState->timeControl.pondering)
@@ -2315,6 +2956,7 @@ void SelfPlayWorker::LoopStrengthTest(WorkCoordinator* workCoordinator, INetwork
 {
     const bool primary = (threadIndex == 0);
     Initialize();
+    _workCoordinator = workCoordinator;
 
     // Warm up the GIL and predictions.
     // It's important to hit TPUs with each possible batch size to avoid 2+ second latency later
@@ -2323,7 +2965,7 @@ void SelfPlayWorker::LoopStrengthTest(WorkCoordinator* workCoordinator, INetwork
     WarmUpPredictions(network, networkType, static_cast<int>(_games.size()));
 
     // Wait until searching is required.
-    while (workCoordinator->WaitForWorkItems())
+    while (workCoordinator->WaitForWorkItems(threadIndex))
     {
         // Initialize the search. Multiple threads will race to make shadows of the reference position,
         // which is safe because the shallow fields don't mutate. Care just needs to be taken with the
@@ -2334,7 +2976,7 @@ void SelfPlayWorker::LoopStrengthTest(WorkCoordinator* workCoordinator, INetwork
         while (!workCoordinator->AllWorkItemsCompleted())
         {
             // CPU work
-            if (!SearchPlay(threadIndex))
+            if (!SearchPlay(workCoordinator, threadIndex))
             {
                 continue;
             }
@@ -2351,6 +2993,7 @@ void SelfPlayWorker::LoopStrengthTest(WorkCoordinator* workCoordinator, INetwork
                     {
                         _searchState->lastBestMove = newBest;
                         _searchState->lastBestNodes = _searchState->nodeCount;
+                        _searchState->lastBestTime = std::chrono::high_resolution_clock::now();
                     }
                 }
 
@@ -2368,8 +3011,10 @@ void SelfPlayWorker::LoopStrengthTest(WorkCoordinator* workCoordinator, INetwork
     Finalize();
 }
 
-bool SelfPlayWorker::SearchPlay(int threadIndex)
+bool SelfPlayWorker::SearchPlay(WorkCoordinator* workCoordinator, int threadIndex)
 {
+    CHESSCOACH_TRACE_SCOPE("SearchPlay");
+
     // Finish off MCTS for any nodes that were waiting on a network prediction by expanding, backpropagating, etc.,
     // across all parallel games. This gives us maximum knowledge for the selection of new nodes.
     for (int i = 0; i < _currentParallelism; i++)
@@ -2384,21 +3029,36 @@ bool SelfPlayWorker::SearchPlay(int threadIndex)
     int parallelism = static_cast<int>(_games.size());
     if (nodeCount < Config::Misc.Search_SlowstartNodes)
     {
-        // This thread may not be needed yet.
+        // This thread may not be needed yet. Help rank root moves using tablebases if that's holding up
+        // the first batch, otherwise sleep until the primary (or root ranking) wakes it, or the search stops.
         if (threadIndex >= Config::Misc.Search_SlowstartThreads)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // ~1-15 milliseconds
+            if (!_searchState->tablebaseRanking.Help())
+            {
+                workCoordinator->WaitForWake(threadIndex, SlowstartWaitMilliseconds);
+            }
             return false;
         }
 
         // This thread is needed, but limit parallelism.
         parallelism = std::min(parallelism, Config::Misc.Search_SlowstartParallelism);
     }
+    else if (!_slowstartWoken && (threadIndex == 0))
+    {
+        // Wake threads sleeping above now that the tree is large enough.
+        _slowstartWoken = true;
+        workCoordinator->WakeWorkers();
+    }
 
     // Now we can select new nodes based on latest knowledge and chosen parallelism. Cache hits and terminals can still be finished and keep looping.
+    // Give up on the batch as soon as the search stops: in-flight paths are fixed up by "FinalizeMcts".
     _currentParallelism = parallelism;
     for (int i = 0; i < parallelism; i++)
     {
+        if (workCoordinator->AllWorkItemsCompleted())
+        {
+            return false;
+        }
         RunMcts(_games[i], _scratchGames[i], _states[i], _mctsSimulations[i], _mctsSimulationLimits[i], _searchPaths[i], _cacheStores[i], false /* finishOnly */);
     }
     
@@ -2462,13 +3122,76 @@ void SelfPlayWorker::FinalizeMcts()
     }
 }
 
-Move SelfPlayWorker::OnSearchFinished()
+Move SelfPlayWorker::OnSearchFinished(WorkCoordinator* workCoordinator, std::chrono::nanoseconds firstBatchLatency)
 {
     // Print the final PV info and bestmove.
     const Node* selected = SelectMove(_games[0], true /* allowDiversity */);
     const Move bestMove = Move(selected->move);
     PrintPrincipalVariation(true /* searchFinished */);
     std::cout << "bestmove " << UCI::move(bestMove, false /* chess960 */) << std::endl;
+
+    // Measure responsiveness: "go" until the first batch is sent, and "stop" (or time control) until "bestmove".
+    static MetricHistogram& firstBatchLatencies = MetricsRegistry::Instance.Histogram("chesscoach_search_first_batch_seconds", "Time from \"go\" until the first prediction batch");
+    static MetricHistogram& bestMoveLatencies = MetricsRegistry::Instance.Histogram("chesscoach_search_stop_bestmove_seconds", "Time from stopping a search until \"bestmove\"");
+    static MetricHistogram& tablebaseFirstBatchLatencies = MetricsRegistry::Instance.Histogram("chesscoach_search_tablebase_first_batch_seconds",
+        "Time from \"go\" until the first prediction batch when root moves were ranked using tablebases");
+    const std::chrono::nanoseconds bestMoveLatency = workCoordinator->SinceStopRequested();
+    const int64_t tablebaseRootNanoseconds = _searchState->tablebaseRootNanoseconds.load(std::memory_order_relaxed);
+    bestMoveLatencies.Record(bestMoveLatency);
+    if (firstBatchLatency.count() >= 0)
+    {
+        firstBatchLatencies.Record(firstBatchLatency);
+        if (tablebaseRootNanoseconds >= 0)
+        {
+            tablebaseFirstBatchLatencies.Record(firstBatchLatency);
+        }
+    }
+    if (_searchState->debug.load(std::memory_order_relaxed))
+    {
+        std::cout << "info string [latency] go_first_batch_ms " << (firstBatchLatency.count() / 1000000.0)
+            << " stop_bestmove_ms " << (bestMoveLatency.count() / 1000000.0);
+        if (tablebaseRootNanoseconds >= 0)
+        {
+            std::cout << " tablebase_root_ms " << (tablebaseRootNanoseconds / 1000000.0)
+                << " tablebase_root_threads " << _searchState->tablebaseRootThreadCount.load(std::memory_order_relaxed);
+        }
+        std::cout << std::endl;
+    }
+
+    // Feed search metrics for live export.
+    static MetricCounter& searches = MetricsRegistry::Instance.Counter("chesscoach_search_searches_total", "Searches finished");
+    static MetricCounter& searchNodes = MetricsRegistry::Instance.Counter("chesscoach_search_nodes_total", "Nodes searched");
+    static MetricGauge& searchNodesPerSecond = MetricsRegistry::Instance.Gauge("chesscoach_search_nodes_per_second", "Nodes per second in the last search");
+    const int nodeCount = _searchState->nodeCount.load(std::memory_order_relaxed);
+    const float searchSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - _searchState->searchStart).count();
+    static MetricCounter& tablebaseHits = MetricsRegistry::Instance.Counter("chesscoach_search_tablebase_hits_total", "Successful tablebase probes during search");
+    static MetricCounter& tablebaseCacheHits = MetricsRegistry::Instance.Counter("chesscoach_search_tablebase_cache_hits_total", "Tablebase WDL probes answered by the shared cache during search");
+    searches.Add(1);
+    searchNodes.Add(nodeCount);
+    tablebaseHits.Add(_searchState->tablebaseHitCount.load(std::memory_order_relaxed));
+    tablebaseCacheHits.Add(_searchState->tablebaseCacheHitCount.load(std::memory_order_relaxed));
+    searchNodesPerSecond.Set((searchSeconds > 0.f) ? (nodeCount / searchSeconds) : 0.0);
+
+    // Walk the tree after "bestmove" so that collection doesn't cost search time.
+    if (Config::Misc.Search_TreeStatistics)
+    {
+        DumpTreeStatistics();
+    }
+
+    // Report hardware counters per phase and thread for this search in debug mode.
+    if (HardwareCounters::Enabled() && _searchState->debug.load(std::memory_order_relaxed))
+    {
+        for (const std::string& line : HardwareCounters::Describe(HardwareCounters::Take(), _searchState->hardwareCountersStart))
+        {
+            std::cout << "info string " << line << std::endl;
+        }
+    }
+
+    // Report tablebase probe latency in debug mode once tablebases are in play.
+    if ((_searchState->tablebaseHitCount.load(std::memory_order_relaxed) > 0) && _searchState->debug.load(std::memory_order_relaxed))
+    {
+        std::cout << "info string " << Syzygy::DescribeProbes() << std::endl;
+    }
     return bestMove;
 }
 
@@ -2491,6 +3214,8 @@ void SelfPlayWorker::CheckUpdateGui(INetwork* network, bool forceUpdate)
     if (_searchState->gui && (forceUpdate ||
         ((nodeCount / interval) > (_searchState->previousNodeCount / interval))))
     {
+        CHESSCOACH_TRACE_SCOPE("CheckUpdateGui");
+
         // Drill down to the requested line.
         SelfPlayGame lineGame = _games[0];
         for (const Move move : _searchState->guiLineMoves)
@@ -2802,8 +3527,12 @@ void SelfPlayWorker::PrintPrincipalVariation(bool searchFinished)
     std::cout << " tbhits " << tablebaseHitCount << " time " << searchTimeMs << " hashfull " << hashfullPermille;
     if (debug)
     {
+        const int64_t treeNodeCount = SelfPlayGame::TreeNodeCount();
         std::cout << " hashhit " << PredictionCache::Instance.PermilleHits()
-            << " hashevict " << PredictionCache::Instance.PermilleEvictions();
+            << " hashevict " << PredictionCache::Instance.PermilleEvictions()
+            << " treenodes " << treeNodeCount << " treemb " << (SelfPlayGame::TreeBytes() >> 20)
+            << " tbcachehit " << ((tablebaseHitCount > 0)
+                ? (_searchState->tablebaseCacheHitCount.load(std::memory_order_relaxed) * 1000LL / tablebaseHitCount) : 0);
     }
     std::cout << " pv";
     for (Move move : principalVariation)
@@ -2811,12 +3540,49 @@ void SelfPlayWorker::PrintPrincipalVariation(bool searchFinished)
         std::cout << " " << UCI::move(move, false /* chess960 */);
     }
     std::cout << std::endl;
+
+    // Report live tree memory against the budget, if set.
+    if (Config::Misc.Search_TreeMemoryMebibytes > 0)
+    {
+        const int64_t treeNodeCount = SelfPlayGame::TreeNodeCount();
+        std::cout << "info string tree " << (SelfPlayGame::TreeBytes() >> 20) << " MiB of "
+            << Config::Misc.Search_TreeMemoryMebibytes << " MiB, " << treeNodeCount << " nodes"
+            << (_searchState->treeMemoryExhausted.load(std::memory_order_relaxed) ? ", no longer expanding" : "") << std::endl;
+    }
+}
+
+TreeStatistics SelfPlayWorker::CollectTreeStatistics()
+{
+    const int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    TreeStatistics treeStatistics = TreeStatistics::Collect(_games[0].GetPosition(), _games[0].Root(), threadCount);
+    treeStatistics.searchNodeCount = _searchState->nodeCount.load(std::memory_order_relaxed);
+    treeStatistics.searchFailedNodeCount = _searchState->failedNodeCount.load(std::memory_order_relaxed);
+    return treeStatistics;
+}
+
+// Print tree shape after a search and append it to a CSV in the logs directory for offline plotting,
+// identifying each search by wall-clock milliseconds.
+void SelfPlayWorker::DumpTreeStatistics()
+{
+    const TreeStatistics treeStatistics = CollectTreeStatistics();
+    treeStatistics.Print(std::cout, "info string ");
+
+    const std::filesystem::path path = (Storage::MakeLocalPath(Config::Misc.Paths_Logs) / "tree_statistics.csv");
+    const bool writeHeader = !std::filesystem::exists(path);
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+    {
+        TreeStatistics::WriteCsvHeader(csv);
+    }
+    const int64_t searchId = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    treeStatistics.WriteCsv(csv, searchId);
 }
 
 void SelfPlayWorker::SearchInitialize(const SelfPlayGame* position)
 {
     // Set up parallelism. Make N games share a tree but have their own image/value/policy slots.
     _currentParallelism = 0;
+    _slowstartWoken = false;
     const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < _games.size(); i++)
     {
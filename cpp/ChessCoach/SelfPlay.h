@@ -22,6 +22,8 @@
 #include <atomic>
 #include <functional>
 #include <optional>
+#include <deque>
+#include <string>
 
 #include <Stockfish/position.h>
 #include <Stockfish/movegen.h>
@@ -33,6 +35,10 @@
 #include "Threading.h"
 #include "PredictionCache.h"
 #include "Epd.h"
+#include "HardwareCounters.h"
+#include "Metrics.h"
+#include "PerformanceBaseline.h"
+#include "Syzygy.h"
 
 class TerminalValue
 {
@@ -186,6 +192,7 @@ struct ScoredNode
 
 class SelfPlayWorker;
 struct SearchState;
+class TreeStatistics;
 
 class PuctContext
 {
@@ -222,6 +229,73 @@ enum class SelfPlayState
     Finished,
 };
 
+enum AdjudicationType
+{
+    AdjudicationType_None,
+    AdjudicationType_Resignation,
+    AdjudicationType_Tablebase,
+
+    AdjudicationType_Count,
+};
+constexpr const char* AdjudicationTypeNames[AdjudicationType_Count] = { "none", "resignation", "tablebase" };
+static_assert(AdjudicationType_Count == 3);
+
+// Tracks resignation and tablebase adjudication for a single self-play game.
+// Verification games are played out anyway, remembering the first adjudication.
+struct AdjudicationState
+{
+    bool verification;
+    int lostPlies[COLOR_NB];
+    AdjudicationType type;
+    int ply;
+    float result;
+};
+
+// Tracks simulations saved by tree reuse and the resulting policy target sharpness for a single self-play game.
+struct TreeReuseState
+{
+    int64_t simulationBudget;
+    int64_t simulationsSaved;
+    float policyEntropySum;
+    int policyEntropyCount;
+};
+
+// Shared across self-play workers: how many slots were waiting on predictions per batch, overall and at
+// round boundaries (when the work coordinator's games are complete but other games are still in progress).
+struct SlotStatistics
+{
+    std::atomic_int64_t batchCount;
+    std::atomic_int64_t slotCount;
+    std::atomic_int64_t occupiedSlotCount;
+    std::atomic_int64_t boundaryBatchCount;
+    std::atomic_int64_t boundarySlotCount;
+    std::atomic_int64_t boundaryOccupiedSlotCount;
+};
+
+// Tracks the adaptive simulation budget for a single self-play game: the root visit distribution
+// at the previous convergence check, and simulations saved on converged moves.
+struct AdaptiveBudgetState
+{
+    std::vector<float> visitSnapshot;
+    int simulationBank;
+    int64_t simulationsUsed;
+    int movesSearched;
+};
+
+// Shared across self-play workers: verification games estimate false positives and plies saved.
+struct AdjudicationStatistics
+{
+    std::atomic_int adjudicatedCount;
+    std::atomic_int verifiedCount;
+    std::atomic_int verifiedFalsePositiveCount;
+    std::atomic_int64_t verifiedPliesRemaining;
+    std::atomic_int64_t estimatedPliesSaved;
+
+    bool RecordVerified(const AdjudicationState& adjudication, int ply, float result);
+    float FalsePositiveRate() const;
+    float AveragePliesRemaining() const;
+};
+
 struct TimeControl
 {
     bool pondering;
@@ -262,7 +336,7 @@ public:
     void ApplyMoveWithRoot(Move move, Node* newRoot);
     void ApplyMoveWithRootAndExpansion(Move move, Node* newRoot, SelfPlayWorker& selfPlayWorker);
     float ExpandAndEvaluate(SelfPlayState& state, PredictionCacheChunk*& cacheStore, SearchState* searchState,
-        bool isSearchRoot, bool generateUniformPredictions);
+        SelfPlayMetrics* metrics, bool isSearchRoot, bool generateUniformPredictions);
 
     void PruneExcept(Node* root, Node*& except);
     void PruneAll();
@@ -271,18 +345,25 @@ public:
     void UpdateSearchRootPly();
     bool ShouldProbeTablebases();
     int& TablebaseCardinality();
+    bool& FullSearch();
+    AdaptiveBudgetState& AdaptiveBudget();
 
     void StoreSearchStatistics();
     void Complete();
+    void Complete(float result);
     SavedGame Save() const;
 
     void DebugExpandCanonicalOrdering();
 
+    static int64_t TreeNodeCount();
+    static int64_t TreeBytes();
+
 private:
 
     bool TakeExpansionOwnership(Node* node);
     void PruneAllInternal(Node* root);
     float FinishExpanding(SelfPlayState& state, PredictionCacheChunk*& cacheStore, SearchState* searchState, bool isSearchRoot, int moveCount, float value);
+    bool WithinTreeMemoryBudget(SearchState* searchState, bool isSearchRoot) const;
     void Expand(int moveCount, float firstPlayUrgency);
 
     bool IsDrawByTwofoldRepetition(int plyToSearchRoot);
@@ -299,11 +380,15 @@ private:
     INetwork::OutputPlanes* _policy;
     int* _tablebaseCardinality;
     int _searchRootPly;
+    bool _fullSearch;
 
     // Stored history and statistics.
     // Only used for real games, so no need to copy, but may make sense for primitives.
     std::vector<float> _mctsValues;
     std::vector<std::map<Move, float>> _childVisits;
+    std::vector<uint8_t> _policyRecorded;
+    std::string _startFen;
+    AdaptiveBudgetState _adaptiveBudget;
     float _result;
 
     // Coroutine state.
@@ -313,6 +398,13 @@ private:
     Key _imageKey;
     std::array<float, MAX_MOVES> _priors;
     std::array<uint16_t, MAX_MOVES> _quantizedPriors;
+
+    // Approximate heap bookkeeping per child array: e.g. glibc's chunk header plus rounding to 16 bytes.
+    static constexpr const int64_t ChildArrayOverheadBytes = 16;
+
+    // Child nodes and arrays allocated by "Expand" and not yet pruned, across all games and threads.
+    static std::atomic_int64_t ChildNodeCount;
+    static std::atomic_int64_t ChildArrayCount;
 };
 
 struct SearchState
@@ -329,10 +421,12 @@ struct SearchState
     std::chrono::time_point<std::chrono::high_resolution_clock> lastPrincipalVariationPrint;
     uint16_t lastBestMove;
     int lastBestNodes;
+    std::chrono::time_point<std::chrono::high_resolution_clock> lastBestTime;
     TimeControl timeControl;
     int previousNodeCount;
     std::string guiLine;
     std::vector<Move> guiLineMoves;
+    HardwareCounterSnapshot hardwareCountersStart;
 
     // All workers
     SelfPlayGame* position;
@@ -340,17 +434,33 @@ struct SearchState
     std::atomic_int nodeCount;
     std::atomic_int failedNodeCount;
     std::atomic_int tablebaseHitCount;
+    std::atomic_int tablebaseCacheHitCount;
     std::atomic_bool principalVariationChanged;
+    std::atomic_bool treeMemoryExhausted;
+    TablebaseRootRanking tablebaseRanking;
+    std::atomic_int64_t tablebaseRootNanoseconds; // Negative unless the root was ranked using tablebases during this search
+    std::atomic_int tablebaseRootThreadCount;
 };
 
 class SelfPlayWorker
 {
+public:
+
+    static constexpr const int ForkPositionCapacity = 256;
+
 private:
 
+    static constexpr const int SlowstartWaitMilliseconds = 5; // Fallback if a wakeup from the primary is missed
+
     static Throttle PredictionCacheResetThrottle;
+    static AdjudicationStatistics AdjudicationStats[AdjudicationType_Count];
+    static std::atomic_int AdjudicationGameCount;
+    static SlotStatistics SlotStats;
 
 public:
 
+    static void PrintSlotStatistics();
+
     SelfPlayWorker(Storage* storage, SearchState* searchState, int gameCount);
 
     SelfPlayWorker(const SelfPlayWorker& other) = delete;
@@ -372,6 +482,7 @@ public:
     void SaveNetwork(INetwork* network, NetworkType networkType, int checkpoint);
     void SaveSwaNetwork(INetwork* network, NetworkType networkType, int checkpoint);
     void StrengthTestNetwork(WorkCoordinator* workCoordinator, INetwork* network, NetworkType networkType, int checkpoint);
+    void Backpropagate(std::vector<WeightedNode>& searchPath, float value, float rootValue);
     void BackpropagateMate(const std::vector<WeightedNode>& searchPath);
     bool WorseThan(const Node* lhs, const Node* rhs) const;
     void SearchUpdatePosition(const std::string& fen, const std::vector<Move>& moves, bool forceNewPosition);
@@ -380,11 +491,22 @@ public:
     void Play(int index);
     Node* SelectMove(const SelfPlayGame& game, bool allowDiversity) const;
     void PrepareExpandedRoot(SelfPlayGame& game);
+    bool Adjudicate(int index, float whiteValue);
+    std::string ChooseStartingPosition();
+    void AddForkPosition(const SavedGame& savedGame);
+    void UpdateAdaptiveBudget(SelfPlayGame& game, int simulations, int& simulationLimit);
+    float CalculateVisitDivergence(const Node* root, std::vector<float>& visitSnapshot) const;
     std::tuple<int, int, int, int> StrengthTestEpd(WorkCoordinator* workCoordinator, const std::filesystem::path& epdPath,
         int moveTimeMs, int nodes, int failureNodes, int positionLimit,
-        std::function<void(const std::string&, const std::string&, const std::string&, int, int, int)> progress);
+        std::function<void(const std::string&, const std::string&, const std::string&, int, int, int)> progress,
+        std::vector<StrengthTestPerformance>* performancesOut);
+
+    const SelfPlayMetrics& Metrics() const;
+    TreeStatistics CollectTreeStatistics();
 
     void DebugGame(int index, SelfPlayGame** gameOut, SelfPlayState** stateOut, float** valuesOut, INetwork::OutputPlanes** policiesOut);
+    int DebugSimulationLimit(int index) const;
+    const AdjudicationState& DebugAdjudication(int index) const;
     void DebugResetGame(int index);
 
 private:
@@ -393,25 +515,29 @@ private:
     void FailNode(std::vector<WeightedNode>& searchPath);
 
     void FinalizeMcts();
-    Move OnSearchFinished();
+    Move OnSearchFinished(WorkCoordinator* workCoordinator, std::chrono::nanoseconds firstBatchLatency);
     void CheckPrincipalVariation();
     void CheckUpdateGui(INetwork* network, bool forceUpdate);
     void CheckTimeControl(WorkCoordinator* workCoordinator);
     void PrintPrincipalVariation(bool searchFinished);
+    void DumpTreeStatistics();
     void SearchInitialize(const SelfPlayGame* position);
-    bool SearchPlay(int threadIndex);
+    bool SearchPlay(WorkCoordinator* workCoordinator, int threadIndex);
 
-    std::tuple<Move, int, int> StrengthTestPosition(WorkCoordinator* workCoordinator, const StrengthTestSpec& spec, int moveTimeMs, int nodes, int failureNodes);
+    std::tuple<Move, int, int> StrengthTestPosition(WorkCoordinator* workCoordinator, const StrengthTestSpec& spec, int moveTimeMs, int nodes, int failureNodes,
+        StrengthTestPerformance& performanceOut);
     std::pair<int, int> JudgeStrengthTestPosition(const StrengthTestSpec& spec, Move move, int lastBestNodes, int failureNodes);
 
-    int ChooseSimulationLimit();
+    int ChooseSimulationLimit(SelfPlayGame& game);
     void ClearGame(int index, const std::chrono::time_point<std::chrono::high_resolution_clock>& now);
     bool IsTerminal(const SelfPlayGame& game) const;
+    void ReuseTree(int index);
+    float CalculatePolicyEntropy(const Node* root) const;
     void SaveToStorageAndLog(INetwork* network, int index);
     void PredictBatchUniform(int batchSize, INetwork::InputPlanes* images, float* values, INetwork::OutputPlanes* policies);
+    void RecordSlotOccupancy(bool roundBoundary);
     bool RunMcts(SelfPlayGame& game, SelfPlayGame& scratchGame, SelfPlayState& state, int& mctsSimulation, int& mctsSimulationLimit,
         std::vector<WeightedNode>& searchPath, PredictionCacheChunk*& cacheStore, bool finishOnly);
-    void Backpropagate(std::vector<WeightedNode>& searchPath, float value, float rootValue);
     void BackpropagateVisitsOnly(std::vector<WeightedNode>& searchPath, int index);
     void FixPrincipalVariation(const std::vector<WeightedNode>& searchPath, Node* node);
     void UpdatePrincipalVariation(const std::vector<WeightedNode>& searchPath);
@@ -440,12 +566,18 @@ private:
     std::vector<std::chrono::time_point<std::chrono::high_resolution_clock>> _gameStarts;
     std::vector<int> _mctsSimulations;
     std::vector<int> _mctsSimulationLimits;
+    std::vector<AdjudicationState> _adjudications;
+    std::vector<TreeReuseState> _treeReuses;
     std::vector<std::vector<WeightedNode>> _searchPaths;
     std::vector<PredictionCacheChunk*> _cacheStores;
+    std::deque<std::string> _forkPositions;
+    SelfPlayMetrics _metrics;
 
     SearchState* _searchState;
+    WorkCoordinator* _workCoordinator; // Only set when searching (UCI or strength tests), for sharing root tablebase probes.
 
     int _currentParallelism;
+    bool _slowstartWoken;
 };
 
 #endif // _SELFPLAY_H_
\ No newline at end of file
@@ -0,0 +1,377 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SharedPoolAllocator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+#include "Platform.h"
+
+#ifdef CHESSCOACH_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Pools by ID, null once destroyed, so that exiting threads only release caches of live pools.
+// Intentionally leaked so that static pools in other translation units can be destroyed in any order.
+struct PoolRegistry
+{
+    std::mutex mutex;
+    std::vector<SharedPoolAllocator*> pools;
+};
+
+static PoolRegistry& Registry()
+{
+    static PoolRegistry* registry = new PoolRegistry();
+    return *registry;
+}
+
+thread_local SharedPoolAllocator::ThreadCaches SharedPoolAllocator::LocalCaches;
+
+SharedPoolAllocator::SharedPoolAllocator(const char* name, size_t itemSizeBytes, size_t itemAlignment)
+    : _name(name)
+    , _id(0)
+    , _uncachedFreeCount(0)
+    , _releasedSlabCount(0)
+{
+    const size_t alignment = std::max({ static_cast<size_t>(__STDCPP_DEFAULT_NEW_ALIGNMENT__), itemAlignment, alignof(Chunk) });
+    _itemStrideBytes = (((std::max(itemSizeBytes, sizeof(Chunk)) + alignment - 1) / alignment) * alignment);
+    _firstItemOffsetBytes = (((sizeof(SharedPoolSlab) + alignment - 1) / alignment) * alignment);
+    _itemsPerSlab = ((_firstItemOffsetBytes < SlabBytes) ? static_cast<int>((SlabBytes - _firstItemOffsetBytes) / _itemStrideBytes) : 0);
+    if (_itemsPerSlab <= 0)
+    {
+        throw ChessCoachException("Items are too large for pool: " + _name);
+    }
+
+    PoolRegistry& registry = Registry();
+    std::lock_guard lock(registry.mutex);
+    _id = registry.pools.size();
+    registry.pools.push_back(this);
+}
+
+// Any items still allocated become invalid.
+SharedPoolAllocator::~SharedPoolAllocator()
+{
+    PoolRegistry& registry = Registry();
+    std::lock_guard registryLock(registry.mutex);
+    registry.pools[_id] = nullptr;
+
+    std::lock_guard lock(_caches.Mutex());
+    for (const auto& cache : _caches.Buffers())
+    {
+        for (SharedPoolSlab* slab : cache->slabs)
+        {
+            FreeSlabMemory(slab);
+        }
+    }
+}
+
+SharedPoolAllocator::ThreadCaches::~ThreadCaches()
+{
+    PoolRegistry& registry = Registry();
+    std::lock_guard lock(registry.mutex);
+    for (size_t id = 0; id < caches.size(); id++)
+    {
+        if (caches[id] && registry.pools[id])
+        {
+            registry.pools[id]->ReleaseCache(*caches[id]);
+        }
+    }
+    caches.clear();
+}
+
+SharedPoolCache* SharedPoolAllocator::ClaimCache()
+{
+    // Reuse a cache released by an exited thread if possible, adopting its slabs.
+    SharedPoolCache* claimed = _caches.Claim([](int threadId)
+        {
+            SharedPoolCache* cache = new SharedPoolCache();
+            cache->threadId = threadId;
+            return cache;
+        });
+
+    std::vector<SharedPoolCache*>& caches = LocalCaches.caches;
+    if (caches.size() <= _id)
+    {
+        caches.resize(_id + 1);
+    }
+    caches[_id] = claimed;
+    return claimed;
+}
+
+// Called with the registry mutex held when the owning thread exits.
+void SharedPoolAllocator::ReleaseCache(SharedPoolCache& cache)
+{
+    CollectRemoteFrees(cache);
+
+    // Return every idle slab to the OS since this thread won't reuse them.
+    for (int i = (static_cast<int>(cache.slabs.size()) - 1); i >= 0; i--)
+    {
+        if (cache.slabs[i]->liveCount == 0)
+        {
+            ReleaseSlab(cache, *cache.slabs[i]);
+        }
+    }
+
+    ThreadBufferRegistry<SharedPoolCache>::Release(cache);
+}
+
+SharedPoolSlab* SharedPoolAllocator::Refill(SharedPoolCache& cache)
+{
+    // Prefer items freed by other threads over growing.
+    if (cache.hasRemoteFrees.load(std::memory_order_relaxed))
+    {
+        CollectRemoteFrees(cache);
+        if (cache.available)
+        {
+            return cache.available;
+        }
+    }
+
+    void* memory = AllocateSlabMemory();
+    SharedPoolSlab* slab = new (memory) SharedPoolSlab();
+    slab->owner = &cache;
+    slab->index = static_cast<int>(cache.slabs.size());
+    cache.slabs.push_back(slab);
+    cache.slabCount.store(static_cast<int64_t>(cache.slabs.size()), std::memory_order_relaxed);
+    cache.idleSlabCount++;
+
+    char* item = (reinterpret_cast<char*>(memory) + _firstItemOffsetBytes);
+    slab->localFree = reinterpret_cast<Chunk*>(item);
+    for (int i = 0; i < (_itemsPerSlab - 1); i++)
+    {
+        reinterpret_cast<Chunk*>(item)->next = reinterpret_cast<Chunk*>(item + _itemStrideBytes);
+        item += _itemStrideBytes;
+    }
+    reinterpret_cast<Chunk*>(item)->next = nullptr;
+
+    LinkAvailable(cache, *slab);
+    return slab;
+}
+
+void SharedPoolAllocator::CollectRemoteFrees(SharedPoolCache& cache)
+{
+    cache.hasRemoteFrees.exchange(false, std::memory_order_acquire);
+
+    // Iterate backwards so that releasing a slab only moves already-visited slabs.
+    for (int i = (static_cast<int>(cache.slabs.size()) - 1); i >= 0; i--)
+    {
+        SharedPoolSlab& slab = *cache.slabs[i];
+        Chunk* remote = slab.remoteFree.exchange(nullptr, std::memory_order_acquire);
+        if (!remote)
+        {
+            continue;
+        }
+
+        int count = 1;
+        Chunk* tail = remote;
+        while (tail->next)
+        {
+            tail = tail->next;
+            count++;
+        }
+        tail->next = slab.localFree;
+        slab.localFree = remote;
+        if (!slab.available)
+        {
+            LinkAvailable(cache, slab);
+        }
+
+        cache.liveCount -= count;
+        slab.liveCount -= count;
+        if (slab.liveCount == 0)
+        {
+            OnSlabIdle(cache, slab);
+        }
+    }
+}
+
+void SharedPoolAllocator::FreeRemote(SharedPoolCache* cache, SharedPoolSlab& slab, Chunk* item)
+{
+    // Read the owner before publishing the item, after which the owner may collect it and release the slab.
+    SharedPoolCache* owner = slab.owner;
+
+    Chunk* head = slab.remoteFree.load(std::memory_order_relaxed);
+    do
+    {
+        item->next = head;
+    } while (!slab.remoteFree.compare_exchange_weak(head, item, std::memory_order_release, std::memory_order_relaxed));
+    owner->hasRemoteFrees.store(true, std::memory_order_release);
+
+    if (cache)
+    {
+        IncrementOwned(cache->freeCount);
+    }
+    else
+    {
+        _uncachedFreeCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SharedPoolAllocator::OnSlabIdle(SharedPoolCache& cache, SharedPoolSlab& slab)
+{
+    cache.idleSlabCount++;
+    if (cache.idleSlabCount > SpareSlabsPerThread)
+    {
+        ReleaseSlab(cache, slab);
+    }
+}
+
+void SharedPoolAllocator::ReleaseSlab(SharedPoolCache& cache, SharedPoolSlab& slab)
+{
+    assert(slab.liveCount == 0);
+
+    if (slab.available)
+    {
+        UnlinkAvailable(cache, slab);
+    }
+    SharedPoolSlab* last = cache.slabs.back();
+    cache.slabs[slab.index] = last;
+    last->index = slab.index;
+    cache.slabs.pop_back();
+    cache.slabCount.store(static_cast<int64_t>(cache.slabs.size()), std::memory_order_relaxed);
+    cache.idleSlabCount--;
+
+    FreeSlabMemory(&slab);
+    _releasedSlabCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* SharedPoolAllocator::AllocateSlabMemory()
+{
+#ifdef CHESSCOACH_WINDOWS
+    // VirtualAlloc aligns to the 64 KiB allocation granularity.
+    static_assert(SlabBytes == (64 * 1024));
+    void* memory = ::VirtualAlloc(nullptr, SlabBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+#else
+    // Map twice the size then trim so that the slab is aligned to its size.
+    void* mapped = ::mmap(nullptr, (2 * SlabBytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    const uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+    const uintptr_t aligned = ((start + SlabBytes - 1) & ~static_cast<uintptr_t>(SlabBytes - 1));
+    if (aligned > start)
+    {
+        ::munmap(mapped, (aligned - start));
+    }
+    const uintptr_t end = (start + (2 * SlabBytes));
+    if (end > (aligned + SlabBytes))
+    {
+        ::munmap(reinterpret_cast<void*>(aligned + SlabBytes), (end - (aligned + SlabBytes)));
+    }
+    return reinterpret_cast<void*>(aligned);
+#endif
+}
+
+void SharedPoolAllocator::FreeSlabMemory(void* memory)
+{
+#ifdef CHESSCOACH_WINDOWS
+    ::VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    ::munmap(memory, SlabBytes);
+#endif
+}
+
+std::pair<int, int> SharedPoolAllocator::DebugAllocations() const
+{
+    const SharedPoolSnapshot snapshot = Take();
+    int64_t peak = 0;
+    for (const SharedPoolThreadSnapshot& thread : snapshot.threads)
+    {
+        peak += thread.peakLiveCount;
+    }
+    return std::pair(static_cast<int>(snapshot.allocationCount - snapshot.freeCount), static_cast<int>(peak));
+}
+
+int SharedPoolAllocator::DebugSlabCount() const
+{
+    return static_cast<int>(Take().slabCount);
+}
+
+SharedPoolSnapshot SharedPoolAllocator::Take() const
+{
+    SharedPoolSnapshot snapshot{};
+    snapshot.time = std::chrono::steady_clock::now();
+    snapshot.freeCount = _uncachedFreeCount.load(std::memory_order_relaxed);
+    snapshot.releasedSlabCount = _releasedSlabCount.load(std::memory_order_relaxed);
+
+    std::lock_guard lock(_caches.Mutex());
+    for (const auto& cache : _caches.Buffers())
+    {
+        SharedPoolThreadSnapshot& thread = snapshot.threads.emplace_back();
+        thread.threadId = cache->threadId;
+        thread.allocationCount = cache->allocationCount.load(std::memory_order_relaxed);
+        thread.freeCount = cache->freeCount.load(std::memory_order_relaxed);
+        thread.slabCount = cache->slabCount.load(std::memory_order_relaxed);
+        thread.peakLiveCount = cache->peakLiveCount.load(std::memory_order_relaxed);
+
+        snapshot.allocationCount += thread.allocationCount;
+        snapshot.freeCount += thread.freeCount;
+        snapshot.slabCount += thread.slabCount;
+    }
+    return snapshot;
+}
+
+std::vector<std::string> SharedPoolAllocator::Describe(const SharedPoolSnapshot& current, const SharedPoolSnapshot& previous) const
+{
+    const double seconds = std::max(1e-9, std::chrono::duration<double>(current.time - previous.time).count());
+    const auto mebibytes = [](int64_t slabCount) { return (static_cast<double>(slabCount * SlabBytes) / (1024.0 * 1024.0)); };
+
+    std::vector<std::string> lines;
+    std::stringstream total;
+    total << std::fixed << std::setprecision(2) << "pool " << _name << " mib " << mebibytes(current.slabCount)
+        << " slabs_released " << (current.releasedSlabCount - previous.releasedSlabCount)
+        << " allocations_per_second " << ((current.allocationCount - previous.allocationCount) / seconds)
+        << " frees_per_second " << ((current.freeCount - previous.freeCount) / seconds);
+    lines.push_back(total.str());
+
+    // Threads may be new since the previous snapshot. Slabs held per thread approximate its resident memory.
+    for (const SharedPoolThreadSnapshot& thread : current.threads)
+    {
+        SharedPoolThreadSnapshot previousThread{};
+        for (const SharedPoolThreadSnapshot& candidate : previous.threads)
+        {
+            if (candidate.threadId == thread.threadId)
+            {
+                previousThread = candidate;
+                break;
+            }
+        }
+        const int64_t allocationCount = (thread.allocationCount - previousThread.allocationCount);
+        const int64_t freeCount = (thread.freeCount - previousThread.freeCount);
+        if ((allocationCount <= 0) && (freeCount <= 0) && (thread.slabCount <= 0))
+        {
+            continue;
+        }
+
+        std::stringstream line;
+        line << std::fixed << std::setprecision(2) << "pool " << _name << " thread " << thread.threadId
+            << " mib " << mebibytes(thread.slabCount) << " peak_live " << thread.peakLiveCount
+            << " allocations_per_second " << (allocationCount / seconds) << " frees_per_second " << (freeCount / seconds);
+        lines.push_back(line.str());
+    }
+    return lines;
+}
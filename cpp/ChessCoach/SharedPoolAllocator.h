@@ -0,0 +1,248 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _SHAREDPOOLALLOCATOR_H_
+#define _SHAREDPOOLALLOCATOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PoolAllocator.h"
+#include "Threading.h"
+
+struct SharedPoolCache;
+
+// Slabs are aligned to their size so that frees can find the header by masking.
+struct SharedPoolSlab
+{
+    SharedPoolCache* owner;
+    Chunk* localFree;                   // Owner only
+    std::atomic<Chunk*> remoteFree;     // Pushed by other threads, taken whole by the owner
+    SharedPoolSlab* previousAvailable;  // Owner only, while "localFree" is non-empty
+    SharedPoolSlab* nextAvailable;
+    int liveCount;                      // Owner only, items outstanding including uncollected remote frees
+    int index;                          // Position in the owner's "slabs"
+    bool available;
+};
+
+// Per-thread cache of slabs. Caches outlive their threads: on exit, idle slabs return to the OS and the cache
+// is released for reuse by a later thread, which then owns its remaining slabs. Statistics are written only by
+// the owning thread (see "IncrementOwned").
+struct SharedPoolCache
+{
+    int threadId;
+    std::atomic_bool owned;
+    std::atomic_bool hasRemoteFrees;
+    SharedPoolSlab* available;
+    std::vector<SharedPoolSlab*> slabs;
+    int idleSlabCount;
+    int liveCount;
+
+    std::atomic_int64_t allocationCount;
+    std::atomic_int64_t freeCount;
+    std::atomic_int64_t slabCount;
+    std::atomic_int64_t peakLiveCount;
+};
+
+struct SharedPoolThreadSnapshot
+{
+    int threadId;
+    int64_t allocationCount;
+    int64_t freeCount;
+    int64_t slabCount;
+    int64_t peakLiveCount;
+};
+
+struct SharedPoolSnapshot
+{
+    std::chrono::steady_clock::time_point time;
+    int64_t allocationCount;
+    int64_t freeCount;
+    int64_t slabCount;
+    int64_t releasedSlabCount;
+    std::vector<SharedPoolThreadSnapshot> threads;
+};
+
+// Fixed-size item pool that any thread may allocate from or free to, replacing a thread-local "PoolAllocator"
+// that reserved a large block per thread and required frees on the allocating thread. Each thread allocates from
+// its own cache of 64 KiB slabs, growing a slab at a time. Frees by the owning thread are plain list pushes;
+// frees by other threads push onto the slab's lock-free return list, collected by the owner before it grows.
+// Beyond a few spares, slabs that become idle are returned to the OS.
+class SharedPoolAllocator
+{
+public:
+
+    static constexpr const size_t SlabBytes = (64 * 1024);
+    static constexpr const int SpareSlabsPerThread = 2;
+
+public:
+
+    SharedPoolAllocator(const char* name, size_t itemSizeBytes, size_t itemAlignment);
+    ~SharedPoolAllocator();
+
+    SharedPoolAllocator(const SharedPoolAllocator& other) = delete;
+    SharedPoolAllocator& operator=(const SharedPoolAllocator& other) = delete;
+
+    void* Allocate()
+    {
+        SharedPoolCache* cache = LocalCache();
+        if (!cache)
+        {
+            cache = ClaimCache();
+        }
+        SharedPoolSlab* slab = cache->available;
+        if (!slab)
+        {
+            slab = Refill(*cache);
+        }
+
+        Chunk* item = slab->localFree;
+        slab->localFree = item->next;
+        if (!slab->localFree)
+        {
+            UnlinkAvailable(*cache, *slab);
+        }
+        if (slab->liveCount++ == 0)
+        {
+            cache->idleSlabCount--;
+        }
+        if (++cache->liveCount > cache->peakLiveCount.load(std::memory_order_relaxed))
+        {
+            cache->peakLiveCount.store(cache->liveCount, std::memory_order_relaxed);
+        }
+        IncrementOwned(cache->allocationCount);
+        return item;
+    }
+
+    void Free(void* memory)
+    {
+        if (!memory)
+        {
+            return;
+        }
+
+        SharedPoolSlab* slab = SlabOf(memory);
+        Chunk* item = reinterpret_cast<Chunk*>(memory);
+        SharedPoolCache* cache = LocalCache();
+        if (!cache || (slab->owner != cache))
+        {
+            FreeRemote(cache, *slab, item);
+            return;
+        }
+
+        item->next = slab->localFree;
+        slab->localFree = item;
+        if (!slab->available)
+        {
+            LinkAvailable(*cache, *slab);
+        }
+        cache->liveCount--;
+        IncrementOwned(cache->freeCount);
+        if (--slab->liveCount == 0)
+        {
+            OnSlabIdle(*cache, *slab);
+        }
+    }
+
+    // Current and peak allocated item counts (peak summed over threads), as with "PoolAllocator".
+    std::pair<int, int> DebugAllocations() const;
+    int DebugSlabCount() const;
+
+    SharedPoolSnapshot Take() const;
+    std::vector<std::string> Describe(const SharedPoolSnapshot& current, const SharedPoolSnapshot& previous) const;
+
+private:
+
+    static SharedPoolSlab* SlabOf(void* memory)
+    {
+        return reinterpret_cast<SharedPoolSlab*>(reinterpret_cast<uintptr_t>(memory) & ~static_cast<uintptr_t>(SlabBytes - 1));
+    }
+
+    static void LinkAvailable(SharedPoolCache& cache, SharedPoolSlab& slab)
+    {
+        slab.available = true;
+        slab.previousAvailable = nullptr;
+        slab.nextAvailable = cache.available;
+        if (cache.available)
+        {
+            cache.available->previousAvailable = &slab;
+        }
+        cache.available = &slab;
+    }
+
+    static void UnlinkAvailable(SharedPoolCache& cache, SharedPoolSlab& slab)
+    {
+        slab.available = false;
+        if (slab.previousAvailable)
+        {
+            slab.previousAvailable->nextAvailable = slab.nextAvailable;
+        }
+        else
+        {
+            cache.available = slab.nextAvailable;
+        }
+        if (slab.nextAvailable)
+        {
+            slab.nextAvailable->previousAvailable = slab.previousAvailable;
+        }
+    }
+
+    SharedPoolCache* LocalCache() const
+    {
+        const std::vector<SharedPoolCache*>& caches = LocalCaches.caches;
+        return ((_id < caches.size()) ? caches[_id] : nullptr);
+    }
+
+    SharedPoolCache* ClaimCache();
+    void ReleaseCache(SharedPoolCache& cache);
+    SharedPoolSlab* Refill(SharedPoolCache& cache);
+    void CollectRemoteFrees(SharedPoolCache& cache);
+    void FreeRemote(SharedPoolCache* cache, SharedPoolSlab& slab, Chunk* item);
+    void OnSlabIdle(SharedPoolCache& cache, SharedPoolSlab& slab);
+    void ReleaseSlab(SharedPoolCache& cache, SharedPoolSlab& slab);
+
+    static void* AllocateSlabMemory();
+    static void FreeSlabMemory(void* memory);
+
+private:
+
+    // Caches claimed by this thread, indexed by pool ID, released when the thread exits.
+    struct ThreadCaches
+    {
+        std::vector<SharedPoolCache*> caches;
+
+        ~ThreadCaches();
+    };
+    thread_local static ThreadCaches LocalCaches;
+
+    std::string _name;
+    size_t _id;
+    size_t _itemStrideBytes;
+    size_t _firstItemOffsetBytes;
+    int _itemsPerSlab;
+
+    ThreadBufferRegistry<SharedPoolCache> _caches;
+    std::atomic_int64_t _uncachedFreeCount;
+    std::atomic_int64_t _releasedSlabCount;
+};
+
+#endif // _SHAREDPOOLALLOCATOR_H_
@@ -36,11 +36,14 @@
 #include <crc32c/include/crc32c/crc32c.h>
 #include <Stockfish/movegen.h>
 
+#include "AllocationTracker.h"
 #include "Config.h"
+#include "MetricsRegistry.h"
 #include "Pgn.h"
 #include "Platform.h"
 #include "Preprocessing.h"
 #include "Random.h"
+#include "Trace.h"
 
 Storage::Storage()
     : _trainingGameCount(0)
@@ -49,6 +52,8 @@ Storage::Storage()
     , _sessionNonce("UNINITIALIZED")
     , _sessionGameCount(0)
     , _sessionChunkCount(0)
+    , _sessionPositionCount(0)
+    , _sessionPolicyRecordedCount(0)
 {
     _relativeTrainingGamePath = Config::Network.Training.GamesPathTraining;
     _localTrainingGamePath = MakeLocalPath(_relativeTrainingGamePath);
@@ -87,8 +92,14 @@ void Storage::InitializeLocalGamesChunks(INetwork* network)
 // AddTrainingGame can be called from multiple self-play worker threads.
 int Storage::AddTrainingGame(INetwork* network, SavedGame&& game)
 {
+    CHESSCOACH_TRACE_SCOPE("AddTrainingGame");
+
     // Give this game a number and filename.
     const int gameNumber = ++_sessionGameCount;
+    _sessionPositionCount += game.moveCount;
+    _sessionPolicyRecordedCount += game.PolicyRecordedCount();
+    static MetricCounter& gamesSaved = MetricsRegistry::Instance.Counter("chesscoach_storage_games_saved_total", "Training games saved locally");
+    gamesSaved.Add(1);
     const std::string filenameStem = GenerateFilename(gameNumber);
 
     // Save locally for chunking later.
@@ -141,6 +152,9 @@ void Storage::TryChunkMultiple(INetwork* network)
 
 void Storage::ChunkGames(INetwork* network, std::vector<std::filesystem::path>& gamePaths)
 {
+    CHESSCOACH_TRACE_SCOPE("ChunkGames");
+    const std::chrono::time_point<std::chrono::high_resolution_clock> chunkStart = std::chrono::high_resolution_clock::now();
+
     // Set up a buffer for the TFRecord file contents, compressing with zlib.
     // Reserve 128 MB in advance, roughly enough to hold any chunk.
     std::string buffer;
@@ -191,6 +205,9 @@ void Storage::ChunkGames(INetwork* network, std::vector<std::filesystem::path>&
 
     // Update stats.
     _trainingGameCount -= _gamesPerChunk;
+    static MetricHistogram& chunkDuration = MetricsRegistry::Instance.Histogram("chesscoach_storage_chunk_seconds",
+        "Time to combine, save and clean up each chunk of games");
+    chunkDuration.Record(std::chrono::high_resolution_clock::now() - chunkStart);
 }
 
 // Training is only done on chunks, not individual games, so round the target up to the nearest chunk.
@@ -202,6 +219,27 @@ int Storage::TrainingGamesToPlay(int trainingChunkCount, int targetGameCount, bo
     return std::max(0, roundedTarget - existingCount);
 }
 
+int Storage::SessionGameCount() const
+{
+    return _sessionGameCount;
+}
+
+int64_t Storage::SessionPositionCount() const
+{
+    return _sessionPositionCount;
+}
+
+int64_t Storage::SessionPolicyRecordedCount() const
+{
+    return _sessionPolicyRecordedCount;
+}
+
+// Games across all sessions: chunked games in storage, plus local games not yet chunked.
+int Storage::TotalGameCount(int trainingChunkCount) const
+{
+    return ((trainingChunkCount * _gamesPerChunk) + _trainingGameCount);
+}
+
 std::string Storage::GenerateSimpleChunkFilename(int chunkNumber) const
 {
     std::stringstream suffix;
@@ -229,6 +267,8 @@ std::string Storage::GenerateFilename(int number)
 
 void Storage::SaveChunk(const std::filesystem::path& path, const std::vector<SavedGame>& games) const
 {
+    CHESSCOACH_TRACE_SCOPE("SaveChunk");
+
     // Compress the TFRecord file using zlib.
     PosixFile file(path, true /* write */);
     google::protobuf::io::FileOutputStream wrapped(file.FileDescriptor());
@@ -241,7 +281,7 @@ void Storage::SaveChunk(const std::filesystem::path& path, const std::vector<Sav
     std::string buffer;
     for (const SavedGame& game : games)
     {
-        PopulateGame(_startingPosition, game, storeGame);
+        PopulateGame(StartingGame(game), game, storeGame);
         WriteTfRecord(zip, buffer, storeGame);
     }
 }
@@ -276,6 +316,10 @@ void Storage::LoadGameFromChunk(const std::string& chunkContents, int gameIndex,
     {
         throw ChessCoachException("Failed to parse game");
     }
+    if (AllocationTracker::Enabled())
+    {
+        AllocationTracker::Allocate(AllocationTag_Storage, compressedGame.SpaceUsedLong());
+    }
 
     // The first 12 planes of "image_pieces_auxiliary" contain the pieces for each position in the game.
     auto& features = compressedGame.features().feature();
@@ -286,17 +330,36 @@ void Storage::LoadGameFromChunk(const std::string& chunkContents, int gameIndex,
     auto& policyRowLengths = features.at("policy_row_lengths").int64_list().value();
     auto& policyIndices = features.at("policy_indices").int64_list().value();
     auto& policyValues = features.at("policy_values").float_list().value();
+    auto policyRecorded = features.find("policy_recorded");
+    auto startFen = features.find("start_fen");
 
-    // Set up result and MCTS values directly.
-    // MCTS deals with probabilities in [0, 1]. Network deals with tanh outputs/targets in (-1, 1)/[-1, 1].
+    // Games forked from positions in earlier games store their starting position.
     *gameOut = SavedGame();
-    gameOut->result = INetwork::MapProbability11To01(result[0]);
+    if (startFen != features.end())
+    {
+        gameOut->startFen = startFen->second.bytes_list().value(0);
+    }
+    Game game(gameOut->startFen, {});
+
+    // Set up result and MCTS values directly. The result is stored from the first player's perspective.
+    // MCTS deals with probabilities in [0, 1]. Network deals with tanh outputs/targets in (-1, 1)/[-1, 1].
+    gameOut->result = Game::FlipValue(game.ToPlay(), INetwork::MapProbability11To01(result[0]));
     gameOut->moveCount = mctsValues.size();
     gameOut->mctsValues.insert(gameOut->mctsValues.begin(), mctsValues.begin(), mctsValues.end());
     INetwork::MapProbabilities11To01(gameOut->mctsValues.size(), gameOut->mctsValues.data());
 
+    // Games stored before playout cap randomization have no "policy_recorded" feature: every position was recorded.
+    if (policyRecorded != features.end())
+    {
+        auto& policyRecordedValues = policyRecorded->second.int64_list().value();
+        gameOut->policyRecorded.insert(gameOut->policyRecorded.begin(), policyRecordedValues.begin(), policyRecordedValues.end());
+    }
+    else
+    {
+        gameOut->policyRecorded.resize(gameOut->moveCount, 1);
+    }
+
     // Play out the game and match the resulting pieces after each legal move.
-    Game game;
     int policyStart = 0;
     for (int m = 0; m < gameOut->moveCount; m++)
     {
@@ -378,18 +441,32 @@ template bool Storage::Read<uint64_t>(google::protobuf::io::ZeroCopyInputStream&
 message::Example Storage::DebugPopulateGame(const SavedGame& game) const
 {
     message::Example gameOut;
-    PopulateGame(_startingPosition, game, gameOut);
+    PopulateGame(StartingGame(game), game, gameOut);
     return gameOut;
 }
 
+// Games usually start from the standard starting position, so copy the shared scratch game in that case.
+Game Storage::StartingGame(const SavedGame& game) const
+{
+    return ((game.startFen == Game::StartingPosition) ? _startingPosition : Game(game.startFen, {}));
+}
+
 void Storage::PopulateGame(Game scratchGame, const SavedGame& game, message::Example& gameOut) const
 {
     auto& features = *gameOut.mutable_features()->mutable_feature();
 
-    // Write result directly.
+    // Write the starting position only for games forked from positions in earlier games.
+    if (game.startFen != Game::StartingPosition)
+    {
+        auto& startFen = *features["start_fen"].mutable_bytes_list()->mutable_value();
+        startFen.Clear();
+        startFen.Add()->assign(game.startFen);
+    }
+
+    // Write result directly, from the first player's perspective (white, unless forked with black to play).
     auto& result = *features["result"].mutable_float_list()->mutable_value();
     result.Clear();
-    result.Add(game.result);
+    result.Add(Game::FlipValue(scratchGame.ToPlay(), game.result));
 
     // Write MCTS values directly.
     auto& mctsValues = *features["mcts_values"].mutable_float_list()->mutable_value();
@@ -422,6 +499,16 @@ void Storage::PopulateGame(Game scratchGame, const SavedGame& game, message::Exa
     auto& policyValues = *features["policy_values"].mutable_float_list()->mutable_value();
     policyValues.Clear();
 
+    // Write policy-recorded flags directly (playout cap randomization). Positions with fast searches
+    // are still stored to provide history for later positions but are skipped when sampling for training.
+    auto& policyRecorded = *features["policy_recorded"].mutable_int64_list()->mutable_value();
+    policyRecorded.Clear();
+    policyRecorded.Reserve(game.moveCount);
+    for (const uint8_t recorded : game.policyRecorded)
+    {
+        policyRecorded.AddAlreadyReserved(recorded);
+    }
+
     for (int m = 0; m < game.moveCount; m++)
     {
         INetwork::PackedPlane* imagePiecesOut = reinterpret_cast<INetwork::PackedPlane*>(imagePiecesAuxiliary.mutable_data()) + (m * imagePiecesAuxiliaryStride);
@@ -474,8 +561,12 @@ void Storage::WriteTfRecord(google::protobuf::io::ZeroCopyOutputStream& stream,
         google::protobuf::io::CodedOutputStream::IsDefaultSerializationDeterministic(),
         &target);
 
-    // Serialize the message.
+    // Serialize the message. Reflection over the populated message is slow, so only measure it when tracking.
     message.SerializeToString(&buffer);
+    if (AllocationTracker::Enabled())
+    {
+        AllocationTracker::Allocate(AllocationTag_Storage, message.SpaceUsedLong());
+    }
 
     // Write the header: length + masked_crc32_of_length
     const uint64_t length = buffer.size();
@@ -545,7 +636,7 @@ void Storage::SaveCommentary(CommentarySaveContext& saveContext, const std::vect
         //
         // Variations "override" the last real move and so will regress the move index,
         // so sort comments by move index here.
-        Game scratchGame = _startingPosition;
+        Game scratchGame = StartingGame(game);
         std::sort(commentary.comments.begin(), commentary.comments.end(), [](const auto& a, const auto& b) {
             return (a.moveIndex < b.moveIndex);
         });
@@ -75,6 +75,10 @@ public:
     Storage();
     void InitializeLocalGamesChunks(INetwork* network);
     int AddTrainingGame(INetwork* network, SavedGame&& game);
+    int SessionGameCount() const;
+    int TotalGameCount(int trainingChunkCount) const;
+    int64_t SessionPositionCount() const;
+    int64_t SessionPolicyRecordedCount() const;
     int TrainingGamesToPlay(int trainingChunkCount, int targetGameCount, bool ignoreLocalGames) const;
 
     void SaveChunk(const std::filesystem::path& path, const std::vector<SavedGame>& games) const;
@@ -92,6 +96,7 @@ private:
     std::string GenerateFilename(int number);
     void TryChunkMultiple(INetwork* network);
     void ChunkGames(INetwork* network, std::vector<std::filesystem::path>& gamePaths);
+    Game StartingGame(const SavedGame& game) const;
     void PopulateGame(Game scratchGame, const SavedGame& game, message::Example& gameOut) const;
     void WriteTfRecord(google::protobuf::io::ZeroCopyOutputStream& stream, std::string& buffer, const google::protobuf::Message& message) const;
     uint32_t MaskCrc32cForTfRecord(uint32_t crc32c) const;
@@ -113,6 +118,8 @@ private:
     std::string _sessionNonce;
     std::atomic_int _sessionGameCount;
     std::atomic_int _sessionChunkCount;
+    std::atomic_int64_t _sessionPositionCount;
+    std::atomic_int64_t _sessionPolicyRecordedCount;
     std::filesystem::path _relativeTrainingGamePath;
     std::filesystem::path _localTrainingGamePath;
     std::filesystem::path _relativePgnsPath;
@@ -22,6 +22,8 @@
 
 #include "Syzygy.h"
 
+#include <algorithm>
+#include <cassert>
 #include <limits>
 #include <cmath>
 #include <limits>
@@ -35,15 +37,115 @@
 #include <Stockfish/uci.h>
 #include <Stockfish/syzygy/tbprobe.h>
 
+#include "MetricsRegistry.h"
 #include "SelfPlay.h"
 #include "Storage.h"
+#include "SyzygyWarmup.h"
+#include "Threading.h"
+
+SyzygyWdlCache Syzygy::WdlCache;
+
+// Time spent in probes that reach the tables (not WDL cache hits), including page faults on first access.
+static MetricHistogram& ProbeLatency()
+{
+    static MetricHistogram& probeLatency = MetricsRegistry::Instance.Histogram("chesscoach_tablebase_probe_seconds",
+        "Time per tablebase probe that reached the tables");
+    return probeLatency;
+}
+
+static Tablebases::WDLScore TimedProbeWdl(Position& position, Tablebases::ProbeState* result)
+{
+    const std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+    const Tablebases::WDLScore wdl = Tablebases::probe_wdl(position, result);
+    ProbeLatency().Record(std::chrono::high_resolution_clock::now() - start);
+    return wdl;
+}
+
+static int TimedProbeDtz(Position& position, Tablebases::ProbeState* result)
+{
+    const std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+    const int dtz = Tablebases::probe_dtz(position, result);
+    ProbeLatency().Record(std::chrono::high_resolution_clock::now() - start);
+    return dtz;
+}
+
+void SyzygyWdlCache::Allocate(int sizeMebibytes)
+{
+    // Round down to a power of two so that slots can be indexed by masking the key.
+    size_t entryCount = 0;
+    const size_t maxEntryCount = ((static_cast<size_t>(std::max(0, sizeMebibytes)) * 1024 * 1024) / sizeof(uint64_t));
+    if (maxEntryCount > 0)
+    {
+        entryCount = 1;
+        while ((entryCount * 2) <= maxEntryCount)
+        {
+            entryCount *= 2;
+        }
+    }
+
+    if (entryCount != _entryCount)
+    {
+        _entries.reset((entryCount > 0) ? new std::atomic_uint64_t[entryCount] : nullptr);
+        _entryCount = entryCount;
+        _indexMask = (entryCount > 0) ? (entryCount - 1) : 0;
+    }
+    Clear();
+}
+
+void SyzygyWdlCache::Clear()
+{
+    for (size_t i = 0; i < _entryCount; i++)
+    {
+        _entries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool SyzygyWdlCache::Probe(uint64_t key, int& wdlOut) const
+{
+    if (_entryCount == 0)
+    {
+        return false;
+    }
+
+    const uint64_t entry = _entries[key & _indexMask].load(std::memory_order_relaxed);
+    if (((entry ^ key) & ~ScoreMask) || !(entry & ScoreMask))
+    {
+        return false;
+    }
+
+    wdlOut = (static_cast<int>(entry & ScoreMask) - ScoreOffset);
+    return true;
+}
+
+void SyzygyWdlCache::Store(uint64_t key, int wdl)
+{
+    if (_entryCount == 0)
+    {
+        return;
+    }
+
+    // Always replace: recent endgames are the ones being revisited.
+    assert((wdl >= -2) && (wdl <= 2));
+    const uint64_t entry = ((key & ~ScoreMask) | static_cast<uint64_t>(wdl + ScoreOffset));
+    _entries[key & _indexMask].store(entry, std::memory_order_relaxed);
+}
+
+size_t SyzygyWdlCache::EntryCount() const
+{
+    return _entryCount;
+}
 
 void Syzygy::Reload()
 {
-    Tablebases::init(Storage::MakeLocalPath(Config::Misc.Paths_Syzygy).string());
+    const std::string paths = Storage::MakeLocalPath(Config::Misc.Paths_Syzygy).string();
+    Tablebases::init(paths);
+    SyzygyWarmup::Instance.Configure(paths);
+
+    // Cached results may not match the new tables.
+    WdlCache.Allocate(Config::Misc.Search_SyzygyWdlCacheMebibytes);
 }
 
-bool Syzygy::ProbeTablebasesAtRoot(SelfPlayGame& game)
+bool Syzygy::ProbeTablebasesAtRoot(SelfPlayGame& game, TablebaseRootRanking* ranking, WorkCoordinator* workCoordinator)
 {
     bool RootInTB = false;
     bool dtz_available = true;
@@ -51,6 +153,13 @@ bool Syzygy::ProbeTablebasesAtRoot(SelfPlayGame& game)
     const Position& position = game.GetPosition();
     game.TablebaseCardinality() = Tablebases::MaxCardinality;
 
+    // Read tables for upcoming captures into the page cache in the background, before search threads need them.
+    if (Config::Misc.Search_SyzygyWarmup)
+    {
+        SyzygyWarmup::Instance.Request(position, Tablebases::MaxCardinality, Config::Misc.Search_SyzygyWarmupMargin,
+            (static_cast<int64_t>(Config::Misc.Search_SyzygyWarmupMebibytes) * 1024 * 1024));
+    }
+
     // "ShouldProbeTablebases" may be non-deterministic for self-play games.
     // Decide once for each position (here) whether to use tablebases at all, and if not,
     // clear cardinality so that deeper positions don't probe via "ProbeWdl".
@@ -63,15 +172,19 @@ bool Syzygy::ProbeTablebasesAtRoot(SelfPlayGame& game)
         (game.TablebaseCardinality() >= position.count<ALL_PIECES>()) &&
         !position.can_castle(ANY_CASTLING))
     {
+        // Without a shared ranking (e.g. self-play, where every thread is busy with its own games), probe serially.
+        TablebaseRootRanking serialRanking;
+        TablebaseRootRanking& rootRanking = (ranking ? *ranking : serialRanking);
+
         // Rank moves using DTZ tables
         attemptedProbe = true;
-        RootInTB = ProbeDtzAtRoot(game);
+        RootInTB = rootRanking.Rank(game, true /* dtz */, workCoordinator);
 
         if (!RootInTB)
         {
             // DTZ tables are missing; try to rank moves using WDL tables
             dtz_available = false;
-            RootInTB = ProbeWdlAtRoot(game);
+            RootInTB = rootRanking.Rank(game, false /* dtz */, workCoordinator);
         }
     }
 
@@ -85,7 +198,7 @@ bool Syzygy::ProbeTablebasesAtRoot(SelfPlayGame& game)
     }
     else if (attemptedProbe)
     {
-        // Data is too intermingled. Just quit if ProbeDtzAtRoot() and ProbeWdlAtRoot() fail.
+        // Data is too intermingled. Just quit if ranking with both DTZ and WDL tables fails.
         throw ChessCoachException("Failed to probe tablebases at the search root");
     }
     
@@ -99,53 +212,21 @@ int dtz_before_zeroing(Tablebases::WDLScore wdl) {
         wdl == Tablebases::WDLLoss ? -1 : 0;
 }
 
-// Use the DTZ tables to rank root moves.
+// Use the DTZ tables to rank a root move, or the WDL tables as a fallback for the case that some or all DTZ tables
+// are missing. The position is restored before returning.
 //
-// A return value false indicates that not all probes were successful.
-bool Syzygy::ProbeDtzAtRoot(SelfPlayGame& game)
+// A return value false indicates that the probe was not successful.
+bool Syzygy::RankRootMove(Position& position, StateInfo& stateInfo, Move move, bool dtz, int rootNoProgressCount, bool hasRepeated,
+    int& rankOut, Bound& boundOut)
 {
-    Tablebases::ProbeState result;
-    StateInfo stateInfo;
-    Position& position = game.GetPosition();
-
-    // Obtain 50-move counter for the root position
-    const int rootNoProgressCount = position.rule50_count();
-
-    // Check whether a position was repeated since the last zeroing move.
-    const bool hasRepeated = position.has_repeated();
+    constexpr int WDL_to_rank[] = { -1000, -899, 0, 899, 1000 };
 
-    // Always use 50-move rule.
-    const int bound = 900;
+    Tablebases::ProbeState result;
+    position.do_move(move, stateInfo);
 
-    // Probe and rank each move
-    for (Node& child : *game.Root())
+    if (!dtz)
     {
-        const Move move = Move(child.move);
-        position.do_move(move, stateInfo);
-
-        // Calculate dtz for the current move counting from the root position
-        int dtz;
-        if (position.rule50_count() == 0)
-        {
-            // In case of a zeroing move, dtz is one of -101/-1/0/1/101
-            Tablebases::WDLScore wdl = Tablebases::WDLScore(-Tablebases::probe_wdl(position, &result));
-            dtz = dtz_before_zeroing(wdl);
-        }
-        else
-        {
-            // Otherwise, take dtz for the new position and correct by 1 ply
-            dtz = -Tablebases::probe_dtz(position, &result);
-            dtz = dtz > 0 ? dtz + 1
-                : dtz < 0 ? dtz - 1 : dtz;
-        }
-
-        // Make sure that a mating move is assigned a dtz value of 1
-        if (position.checkers()
-            && dtz == 2
-            && MoveList<LEGAL>(position).size() == 0)
-        {
-            dtz = 1;
-        }
+        Tablebases::WDLScore wdl = Tablebases::WDLScore(-TimedProbeWdl(position, &result));
 
         position.undo_move(move);
 
@@ -154,66 +235,189 @@ bool Syzygy::ProbeDtzAtRoot(SelfPlayGame& game)
             return false;
         }
 
-        // Better moves are ranked higher. Certain wins are ranked equally.
-        // Losing moves are ranked equally unless a 50-move draw is in sight.
-        int r = dtz > 0 ? (dtz + rootNoProgressCount <= 99 && !hasRepeated ? 1000 : 1000 - (dtz + rootNoProgressCount))
-            : dtz < 0 ? (-dtz * 2 + rootNoProgressCount < 100 ? -1000 : -1000 + (-dtz + rootNoProgressCount))
-            : 0;
-
-        const Bound tablebaseBound =
-            r >= bound ? BOUND_LOWER
-            : r <= -bound ? BOUND_UPPER
-            : BOUND_EXACT;
-        
         // Sacrifice cursed win/blessed loss differentiation. This can be added back using signal bits in "tablebaseRankBound"
         // if needed.
-        child.SetTablebaseRankBound(r, tablebaseBound);
+        rankOut = WDL_to_rank[wdl + 2];
+        boundOut =
+            wdl > 1 ? BOUND_LOWER
+            : wdl < -1 ? BOUND_UPPER
+            : BOUND_EXACT;
+        return true;
+    }
+
+    // Always use 50-move rule.
+    const int bound = 900;
+
+    // Calculate dtz for the current move counting from the root position
+    int dtzScore;
+    if (position.rule50_count() == 0)
+    {
+        // In case of a zeroing move, dtz is one of -101/-1/0/1/101
+        Tablebases::WDLScore wdl = Tablebases::WDLScore(-TimedProbeWdl(position, &result));
+        dtzScore = dtz_before_zeroing(wdl);
+    }
+    else
+    {
+        // Otherwise, take dtz for the new position and correct by 1 ply
+        dtzScore = -TimedProbeDtz(position, &result);
+        dtzScore = dtzScore > 0 ? dtzScore + 1
+            : dtzScore < 0 ? dtzScore - 1 : dtzScore;
+    }
+
+    // Make sure that a mating move is assigned a dtz value of 1
+    if (position.checkers()
+        && dtzScore == 2
+        && MoveList<LEGAL>(position).size() == 0)
+    {
+        dtzScore = 1;
+    }
+
+    position.undo_move(move);
+
+    if (result == Tablebases::ProbeState::FAIL)
+    {
+        return false;
     }
 
+    // Better moves are ranked higher. Certain wins are ranked equally.
+    // Losing moves are ranked equally unless a 50-move draw is in sight.
+    const int r = dtzScore > 0 ? (dtzScore + rootNoProgressCount <= 99 && !hasRepeated ? 1000 : 1000 - (dtzScore + rootNoProgressCount))
+        : dtzScore < 0 ? (-dtzScore * 2 + rootNoProgressCount < 100 ? -1000 : -1000 + (-dtzScore + rootNoProgressCount))
+        : 0;
+
+    // Sacrifice cursed win/blessed loss differentiation. This can be added back using signal bits in "tablebaseRankBound"
+    // if needed.
+    rankOut = r;
+    boundOut =
+        r >= bound ? BOUND_LOWER
+        : r <= -bound ? BOUND_UPPER
+        : BOUND_EXACT;
     return true;
 }
 
-// Use the WDL tables to rank root moves.
-// This is a fallback for the case that some or all DTZ tables are missing.
+// Rank every root move, sharing the probes with any threads calling "Help" meanwhile, then apply ranks and bounds
+// to the root's children. Without a work coordinator, or with few moves, the calling thread probes alone.
 //
-// A return value false indicates that not all probes were successful.
-bool Syzygy::ProbeWdlAtRoot(SelfPlayGame& game)
+// A return value false indicates that not all probes were successful, in which case no children are updated.
+bool TablebaseRootRanking::Rank(SelfPlayGame& game, bool dtz, WorkCoordinator* workCoordinator)
 {
-    constexpr int WDL_to_rank[] = { -1000, -899, 0, 899, 1000 };
+    // Post the work. Helpers only read these fields after seeing "_posted", and "Rank" doesn't return
+    // (allowing the root to change) until every helper has let go.
+    _position = game.GetPosition();
+    _dtz = dtz;
+    _rootNoProgressCount = _position.rule50_count();
+    _hasRepeated = _position.has_repeated();
+    _moves.clear();
+    for (const Node& child : *game.Root())
+    {
+        _moves.push_back(Move(child.move));
+    }
+    _ranks.assign(_moves.size(), 0);
+    _bounds.assign(_moves.size(), BOUND_NONE);
+    _nextIndex.store(0, std::memory_order_relaxed);
+    _completedCount.store(0, std::memory_order_relaxed);
+    _threadCount.store(0, std::memory_order_relaxed);
+    _failed.store(false, std::memory_order_relaxed);
+    _posted.store(true, std::memory_order_seq_cst);
+
+    if (workCoordinator && (_moves.size() > 1))
+    {
+        workCoordinator->WakeWorkers();
+    }
 
-    Position& position = game.GetPosition();
-    Tablebases::ProbeState result;
-    StateInfo stateInfo;
+    // Probe alongside any helpers, then sleep until their in-flight probes finish. Load the wake word
+    // before checking so that a wake between the check and the wait isn't missed.
+    ProbeClaimed();
+    const int moveCount = static_cast<int>(_moves.size());
+    while (true)
+    {
+        const uint32_t observed = _progress.Load();
+        if (_completedCount.load(std::memory_order_acquire) >= moveCount)
+        {
+            break;
+        }
+        _progress.Wait(observed);
+    }
+    _posted.store(false, std::memory_order_seq_cst);
+    while (true)
+    {
+        const uint32_t observed = _progress.Load();
+        if (_activeHelpers.load(std::memory_order_seq_cst) <= 0)
+        {
+            break;
+        }
+        _progress.Wait(observed);
+    }
 
-    // Probe and rank each move
-    for (Node& child : *game.Root())
+    if (_failed.load(std::memory_order_relaxed))
     {
-        const Move move = Move(child.move);
-        position.do_move(move, stateInfo);
+        return false;
+    }
 
-        Tablebases::WDLScore wdl = Tablebases::WDLScore(-Tablebases::probe_wdl(position, &result));
+    // Children are in the same order as "_moves".
+    int index = 0;
+    for (Node& child : *game.Root())
+    {
+        child.SetTablebaseRankBound(_ranks[index], _bounds[index]);
+        index++;
+    }
+    return true;
+}
 
-        position.undo_move(move);
+// Probe moves for a posted ranking, if any. Returns true if any moves were probed.
+bool TablebaseRootRanking::Help()
+{
+    if (!_posted.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
 
-        if (result == Tablebases::ProbeState::FAIL)
-        {
-            return false;
-        }
+    // Register before re-checking so that "Rank" either waits for this thread or this thread sees nothing posted.
+    _activeHelpers.fetch_add(1, std::memory_order_seq_cst);
+    const bool helped = (_posted.load(std::memory_order_seq_cst) && ProbeClaimed());
+    if (_activeHelpers.fetch_sub(1, std::memory_order_seq_cst) == 1)
+    {
+        _progress.Wake();
+    }
+    return helped;
+}
 
-        const Bound tablebaseBound =
-            wdl > 1 ? BOUND_LOWER
-            : wdl < -1 ? BOUND_UPPER
-            : BOUND_EXACT;
+// Number of threads, including the posting thread, that probed at least one move in the most recent ranking.
+int TablebaseRootRanking::LastThreadCount() const
+{
+    return _threadCount.load(std::memory_order_relaxed);
+}
 
-        // Sacrifice cursed win/blessed loss differentiation. This can be added back using signal bits in "tablebaseRankBound"
-        // if needed.
-        child.SetTablebaseRankBound(WDL_to_rank[wdl + 2], tablebaseBound);
+bool TablebaseRootRanking::ProbeClaimed()
+{
+    const int moveCount = static_cast<int>(_moves.size());
+    int index = _nextIndex.fetch_add(1, std::memory_order_relaxed);
+    if (index >= moveCount)
+    {
+        return false;
     }
+    _threadCount.fetch_add(1, std::memory_order_relaxed);
 
+    // Probe on a private copy of the root position. Moves are undone after each probe, so one StateInfo suffices.
+    Position position = _position;
+    StateInfo stateInfo;
+    for (; index < moveCount; index = _nextIndex.fetch_add(1, std::memory_order_relaxed))
+    {
+        // Keep claiming after a failure so that "_completedCount" still reaches the move count.
+        if (!_failed.load(std::memory_order_relaxed) &&
+            !Syzygy::RankRootMove(position, stateInfo, _moves[index], _dtz, _rootNoProgressCount, _hasRepeated, _ranks[index], _bounds[index]))
+        {
+            _failed.store(true, std::memory_order_relaxed);
+        }
+        if ((_completedCount.fetch_add(1, std::memory_order_acq_rel) + 1) == moveCount)
+        {
+            _progress.Wake();
+        }
+    }
     return true;
 }
 
-bool Syzygy::ProbeWdl(SelfPlayGame& game, bool isSearchRoot)
+bool Syzygy::ProbeWdl(SelfPlayGame& game, bool isSearchRoot, bool& cacheHitOut)
 {
     Position& position = game.GetPosition();
 
@@ -233,12 +437,12 @@ bool Syzygy::ProbeWdl(SelfPlayGame& game, bool isSearchRoot)
     }
 
     // Always value from parent's perspective.
-    Tablebases::ProbeState result;
-    Tablebases::WDLScore wdl = Tablebases::WDLScore(-Tablebases::probe_wdl(position, &result));
-    if (result == Tablebases::ProbeState::FAIL)
+    int toPlayWdl;
+    if (!ProbeWdlCached(game, toPlayWdl, cacheHitOut))
     {
         return false;
     }
+    Tablebases::WDLScore wdl = Tablebases::WDLScore(-toPlayWdl);
 
     // Always use 50-move rule.
     const int drawScore = 1;
@@ -252,4 +456,86 @@ bool Syzygy::ProbeWdl(SelfPlayGame& game, bool isSearchRoot)
     // if needed.
     game.Root()->SetTablebaseRankBound(game.Root()->TablebaseRank(), tablebaseBound);
     return true;
+}
+
+// Adjudicate a self-play game using the WDL tables, providing the game result from white's perspective.
+//
+// Only adjudicate directly after a zeroing move so that the WDL score accounts for the 50-move rule exactly,
+// treating cursed wins and blessed losses as draws. This is also when positions first come into range.
+bool Syzygy::ProbeWdlAdjudication(SelfPlayGame& game, float& resultOut)
+{
+    Position& position = game.GetPosition();
+
+    if (!(Tablebases::MaxCardinality >= position.count<ALL_PIECES>() &&
+        (position.rule50_count() == 0) &&
+        !position.can_castle(ANY_CASTLING)))
+    {
+        return false;
+    }
+
+    // Value from the side to play's perspective.
+    int toPlayWdl;
+    bool cacheHit;
+    if (!ProbeWdlCached(game, toPlayWdl, cacheHit))
+    {
+        return false;
+    }
+    const Tablebases::WDLScore wdl = Tablebases::WDLScore(toPlayWdl);
+
+    // Always use 50-move rule.
+    const int drawScore = 1;
+
+    const float value =
+        wdl > drawScore ? CHESSCOACH_VALUE_WIN
+        : wdl < -drawScore ? CHESSCOACH_VALUE_LOSS
+        : CHESSCOACH_VALUE_DRAW;
+
+    resultOut = Game::FlipValue(game.ToPlay(), value);
+    return true;
+}
+
+// Probe WDL from the side to play's perspective, via "WdlCache" to avoid decompressing the same positions repeatedly.
+// Only valid directly after a zeroing move, since the Zobrist key doesn't include the 50-move counter.
+bool Syzygy::ProbeWdlCached(SelfPlayGame& game, int& wdlOut, bool& cacheHitOut)
+{
+    Position& position = game.GetPosition();
+    assert(position.rule50_count() == 0);
+
+    const Key key = position.key();
+    cacheHitOut = WdlCache.Probe(key, wdlOut);
+    if (cacheHitOut)
+    {
+        return true;
+    }
+
+    Tablebases::ProbeState result;
+    wdlOut = TimedProbeWdl(position, &result);
+    if (result == Tablebases::ProbeState::FAIL)
+    {
+        return false;
+    }
+
+    WdlCache.Store(key, wdlOut);
+    return true;
+}
+
+// Summarize probe latency percentiles since startup, and background warm-up progress.
+std::string Syzygy::DescribeProbes()
+{
+    const MetricHistogramValue latency = ProbeLatency().Value();
+    int64_t probeCount = 0;
+    for (const int64_t count : latency.counts)
+    {
+        probeCount += count;
+    }
+    const SyzygyWarmupStats warmup = SyzygyWarmup::Instance.Stats();
+
+    std::stringstream description;
+    description << "tablebase probes " << probeCount
+        << " p50_ms " << LatencyHistogram::PercentileMilliseconds(latency.counts, 0.5f)
+        << " p99_ms " << LatencyHistogram::PercentileMilliseconds(latency.counts, 0.99f)
+        << " p999_ms " << LatencyHistogram::PercentileMilliseconds(latency.counts, 0.999f)
+        << " warmup_files " << warmup.fileCount
+        << " warmup_requested_mib " << (warmup.byteCount >> 20);
+    return description.str();
 }
\ No newline at end of file
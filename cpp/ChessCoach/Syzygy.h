@@ -23,21 +23,99 @@
 #ifndef _SYZYGY_H_
 #define _SYZYGY_H_
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Stockfish/position.h>
+
+#include "Threading.h"
+
 class SelfPlayGame;
 struct Node;
 
+// Caches WDL probe results by Zobrist key, shared across threads without locking. Each entry is a single 64-bit word
+// holding the upper key bits and the score, so entries can't tear, and a different key in the slot is just a miss.
+class SyzygyWdlCache
+{
+public:
+
+    void Allocate(int sizeMebibytes);
+    void Clear();
+
+    bool Probe(uint64_t key, int& wdlOut) const;
+    void Store(uint64_t key, int wdl);
+
+    size_t EntryCount() const;
+
+private:
+
+    static constexpr const uint64_t ScoreMask = 0x7;
+    static constexpr const int ScoreOffset = 3; // Scores -2 to 2 are stored as 1 to 5, leaving 0 as empty.
+
+    std::unique_ptr<std::atomic_uint64_t[]> _entries;
+    size_t _entryCount = 0;
+    uint64_t _indexMask = 0;
+};
+
+// Ranks root moves using tablebases, sharing probes with idle search threads (e.g. waiting in slowstart) so that
+// slow DTZ probes on cold tables don't all land on the thread that expanded the root, delaying the first batch.
+// Each thread probes claimed moves on its own copy of the root position, reusing a single StateInfo.
+class TablebaseRootRanking
+{
+public:
+
+    bool Rank(SelfPlayGame& game, bool dtz, WorkCoordinator* workCoordinator);
+    bool Help();
+    int LastThreadCount() const;
+
+private:
+
+    bool ProbeClaimed();
+
+private:
+
+    std::atomic_bool _posted{ false };
+    std::atomic_int _activeHelpers{ 0 };
+    std::atomic_int _nextIndex{ 0 };
+    std::atomic_int _completedCount{ 0 };
+    std::atomic_int _threadCount{ 0 };
+    std::atomic_bool _failed{ false };
+    WakeWord _progress; // Bumped by the last probe completing and by the last helper leaving.
+
+    // Only written by the posting thread before "_posted" is set.
+    Position _position;
+    bool _dtz = false;
+    int _rootNoProgressCount = 0;
+    bool _hasRepeated = false;
+    std::vector<Move> _moves;
+    std::vector<int> _ranks;
+    std::vector<Bound> _bounds;
+};
+
 class Syzygy
 {
+    friend class TablebaseRootRanking;
+
+public:
+
+    static SyzygyWdlCache WdlCache;
+
 public:
 
     static void Reload();
-    static bool ProbeTablebasesAtRoot(SelfPlayGame& game);
-    static bool ProbeWdl(SelfPlayGame& game, bool isSearchRoot);
+    static bool ProbeTablebasesAtRoot(SelfPlayGame& game, TablebaseRootRanking* ranking = nullptr, WorkCoordinator* workCoordinator = nullptr);
+    static bool ProbeWdl(SelfPlayGame& game, bool isSearchRoot, bool& cacheHitOut);
+    static bool ProbeWdlAdjudication(SelfPlayGame& game, float& resultOut);
+    static std::string DescribeProbes();
 
 private:
 
-    static bool ProbeDtzAtRoot(SelfPlayGame& game);
-    static bool ProbeWdlAtRoot(SelfPlayGame& game);
+    static bool RankRootMove(Position& position, StateInfo& stateInfo, Move move, bool dtz, int rootNoProgressCount, bool hasRepeated,
+        int& rankOut, Bound& boundOut);
+    static bool ProbeWdlCached(SelfPlayGame& game, int& wdlOut, bool& cacheHitOut);
 };
 
 #endif // _SYZYGY_H_
\ No newline at end of file
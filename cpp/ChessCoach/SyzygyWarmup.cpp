@@ -0,0 +1,336 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SyzygyWarmup.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+
+#include "Platform.h"
+
+#ifndef CHESSCOACH_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SyzygyWarmup SyzygyWarmup::Instance;
+
+namespace
+{
+    // Piece counts by color and type, for naming tables and stepping through captures and promotions.
+    using MaterialCounts = std::array<std::array<int, PIECE_TYPE_NB>, COLOR_NB>;
+
+    std::string MaterialName(const MaterialCounts& counts, Color first)
+    {
+        std::string name;
+        for (const Color color : { first, ~first })
+        {
+            if (!name.empty())
+            {
+                name += 'v';
+            }
+            name += 'K';
+            for (PieceType pieceType = QUEEN; pieceType >= PAWN; --pieceType)
+            {
+                name += std::string(counts[color][pieceType], " PNBRQK"[pieceType]);
+            }
+        }
+        return name;
+    }
+}
+
+SyzygyWarmup::~SyzygyWarmup()
+{
+    Stop();
+}
+
+std::vector<std::pair<std::string, int>> SyzygyWarmup::RelevantMaterials(const Position& position, int maxCardinality)
+{
+    MaterialCounts start{};
+    int startTotal = 2;
+    for (const Color color : { WHITE, BLACK })
+    {
+        for (PieceType pieceType = PAWN; pieceType <= QUEEN; ++pieceType)
+        {
+            start[color][pieceType] = popcount(position.pieces(color, pieceType));
+            startTotal += start[color][pieceType];
+        }
+    }
+
+    // Search outwards through captures and promotions so that the nearest tables come first. Allow a couple of
+    // steps beyond the captures needed to come into range so that promotions don't explode the search.
+    const int maxDistance = (std::max(0, startTotal - maxCardinality) + 2);
+    std::vector<std::pair<std::string, int>> materials;
+    std::unordered_set<std::string> visited{ MaterialName(start, WHITE) };
+    std::deque<std::tuple<MaterialCounts, int, int>> frontier{ { start, startTotal, 0 } };
+    while (!frontier.empty() && (materials.size() < MaxTablesPerRequest))
+    {
+        const auto [counts, total, distance] = frontier.front();
+        frontier.pop_front();
+
+        // Bare kings don't have a table.
+        if ((total <= maxCardinality) && (total > 2))
+        {
+            materials.emplace_back(MaterialName(counts, WHITE), distance);
+        }
+        if (distance >= maxDistance)
+        {
+            continue;
+        }
+
+        for (const Color color : { WHITE, BLACK })
+        {
+            for (PieceType pieceType = PAWN; pieceType <= QUEEN; ++pieceType)
+            {
+                if (!counts[color][pieceType])
+                {
+                    continue;
+                }
+
+                // Captures, then promotions.
+                MaterialCounts next = counts;
+                next[color][pieceType]--;
+                if (visited.insert(MaterialName(next, WHITE)).second)
+                {
+                    frontier.emplace_back(next, total - 1, distance + 1);
+                }
+                for (PieceType promotion = KNIGHT; (pieceType == PAWN) && (promotion <= QUEEN); ++promotion)
+                {
+                    MaterialCounts promoted = counts;
+                    promoted[color][PAWN]--;
+                    promoted[color][promotion]++;
+                    if (visited.insert(MaterialName(promoted, WHITE)).second)
+                    {
+                        frontier.emplace_back(promoted, total, distance + 1);
+                    }
+                }
+            }
+        }
+    }
+
+    return materials;
+}
+
+void SyzygyWarmup::Configure(const std::string& paths)
+{
+    // Match the path separators used by Stockfish's "TBFile".
+#ifdef CHESSCOACH_WINDOWS
+    constexpr char separator = ';';
+#else
+    constexpr char separator = ':';
+#endif
+    std::vector<std::string> splitPaths;
+    std::stringstream stream(paths);
+    std::string path;
+    while (std::getline(stream, path, separator))
+    {
+        if (!path.empty() && (path != "<empty>"))
+        {
+            splitPaths.push_back(path);
+        }
+    }
+
+    // Keep what's already warm if the paths haven't changed (e.g. reloading for each game).
+    std::lock_guard lock(_mutex);
+    if (splitPaths != _paths)
+    {
+        _paths = std::move(splitPaths);
+        _requestedMaterials.clear();
+        _warmedFiles.clear();
+        _queue.clear();
+    }
+}
+
+// Returns true if the material was new and in range, and files were queued.
+bool SyzygyWarmup::Request(const Position& position, int maxCardinality, int margin, int64_t budgetBytes)
+{
+    // Stay cheap for positions out of range, since this is checked on every move.
+    if ((maxCardinality < 3) || (position.count<ALL_PIECES>() > (maxCardinality + margin)))
+    {
+        return false;
+    }
+
+    std::lock_guard lock(_mutex);
+
+    if (_paths.empty() || !_requestedMaterials.insert(position.material_key()).second)
+    {
+        return false;
+    }
+
+    // Queue WDL tables first, since they're probed throughout search, then DTZ tables for the nearest
+    // materials, since they're only probed at the root. Table names may order either side first.
+    const int64_t request = _requestCount.fetch_add(1, std::memory_order_relaxed);
+    const std::vector<std::pair<std::string, int>> materials = RelevantMaterials(position, maxCardinality);
+    for (const char* extension : { ".rtbw", ".rtbz" })
+    {
+        for (const auto& [name, distance] : materials)
+        {
+            if ((extension[4] == 'z') && (distance > MaxDtzDistance))
+            {
+                continue;
+            }
+
+            const size_t separator = name.find('v');
+            for (const std::string& filename : { name + extension, name.substr(separator + 1) + 'v' + name.substr(0, separator) + extension })
+            {
+                if (_warmedFiles.insert(filename).second)
+                {
+                    _queue.push_back({ filename, request, budgetBytes });
+                }
+            }
+        }
+    }
+
+    if (!_thread.joinable())
+    {
+        _thread = std::thread(&SyzygyWarmup::Loop, this);
+    }
+    _workExists.notify_one();
+    return true;
+}
+
+void SyzygyWarmup::WaitUntilIdle()
+{
+    std::unique_lock lock(_mutex);
+    _idle.wait(lock, [&]() { return (_queue.empty() && !_busy); });
+}
+
+SyzygyWarmupStats SyzygyWarmup::Stats() const
+{
+    return { _requestCount.load(std::memory_order_relaxed), _fileCount.load(std::memory_order_relaxed), _byteCount.load(std::memory_order_relaxed) };
+}
+
+void SyzygyWarmup::Loop()
+{
+    int64_t request = -1;
+    int64_t remainingBytes = 0;
+    while (true)
+    {
+        QueuedFile file;
+        {
+            std::unique_lock lock(_mutex);
+
+            _busy = false;
+            if (_queue.empty())
+            {
+                _idle.notify_all();
+            }
+            _workExists.wait(lock, [&]() { return (_stop || !_queue.empty()); });
+            if (_stop)
+            {
+                return;
+            }
+
+            file = std::move(_queue.front());
+            _queue.pop_front();
+            _busy = true;
+        }
+
+        // Each request's files are queued together, so start its budget on its first file.
+        if (file.request != request)
+        {
+            request = file.request;
+            remainingBytes = std::min(file.budgetBytes, (Platform::AvailableMemoryBytes() / 2));
+        }
+        WarmFile(file.filename, remainingBytes);
+    }
+}
+
+void SyzygyWarmup::WarmFile(const std::string& filename, int64_t& remainingBytes)
+{
+    std::vector<std::string> paths;
+    {
+        std::lock_guard lock(_mutex);
+        paths = _paths;
+    }
+
+    // Warm the first copy found. Pages stay in the OS page cache for the later memory mapping.
+    for (const std::string& path : paths)
+    {
+        const std::string filePath = (path + "/" + filename);
+        std::error_code error;
+        const int64_t fileBytes = static_cast<int64_t>(std::filesystem::file_size(filePath, error));
+        if (error)
+        {
+            continue;
+        }
+
+        // Let a later request warm it if it's still relevant then.
+        if (fileBytes > remainingBytes)
+        {
+            std::lock_guard lock(_mutex);
+            _warmedFiles.erase(filename);
+            return;
+        }
+
+        int64_t byteCount = 0;
+#ifdef CHESSCOACH_WINDOWS
+        // Read through a buffer, discarding the data.
+        std::ifstream file(filePath, std::ios::binary);
+        std::vector<char> buffer(ReadChunkBytes);
+        while (file && !_stop)
+        {
+            file.read(buffer.data(), buffer.size());
+            const std::streamsize readBytes = file.gcount();
+            if (readBytes <= 0)
+            {
+                break;
+            }
+            byteCount += readBytes;
+        }
+#else
+        // Ask the kernel to read ahead without copying through user space, a chunk at a time to stay stoppable.
+        const int fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+        if (fileDescriptor == -1)
+        {
+            continue;
+        }
+        while ((byteCount < fileBytes) && !_stop)
+        {
+            const int64_t chunkBytes = std::min(ReadChunkBytes, (fileBytes - byteCount));
+            if (::posix_fadvise(fileDescriptor, byteCount, chunkBytes, POSIX_FADV_WILLNEED) != 0)
+            {
+                break;
+            }
+            byteCount += chunkBytes;
+        }
+        ::close(fileDescriptor);
+#endif
+
+        remainingBytes -= fileBytes;
+        _fileCount.fetch_add(1, std::memory_order_relaxed);
+        _byteCount.fetch_add(byteCount, std::memory_order_relaxed);
+        return;
+    }
+}
+
+void SyzygyWarmup::Stop()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _workExists.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
@@ -0,0 +1,99 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _SYZYGYWARMUP_H_
+#define _SYZYGYWARMUP_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <Stockfish/position.h>
+
+struct SyzygyWarmupStats
+{
+    int64_t requestCount;
+    int64_t fileCount;
+    int64_t byteCount; // Read on Windows, but only requested for prefetch on Linux (the kernel may drop or defer readahead)
+};
+
+// Reads tablebase files relevant to the current material into the OS page cache on a background thread,
+// so that the first probes after captures don't fault pages in from disk on search threads. Tables are
+// memory-mapped lazily on first probe, and these pages are then already resident. Each request warms
+// its nearest files first within a byte budget, capped at half of available memory; files skipped for
+// budget may be warmed by later requests.
+class SyzygyWarmup
+{
+public:
+
+    static SyzygyWarmup Instance;
+
+    static constexpr const int MaxTablesPerRequest = 64;
+    static constexpr const int MaxDtzDistance = 1;
+    static constexpr const int64_t ReadChunkBytes = (4 * 1024 * 1024);
+
+public:
+
+    ~SyzygyWarmup();
+
+    // Material names ("KRPvKR") reachable from the position by captures and promotions that are within
+    // "maxCardinality", nearest first, with the number of captures and promotions needed for each.
+    static std::vector<std::pair<std::string, int>> RelevantMaterials(const Position& position, int maxCardinality);
+
+    void Configure(const std::string& paths);
+    bool Request(const Position& position, int maxCardinality, int margin, int64_t budgetBytes);
+    void WaitUntilIdle();
+    SyzygyWarmupStats Stats() const;
+
+private:
+
+    void Loop();
+    void WarmFile(const std::string& filename, int64_t& remainingBytes);
+    void Stop();
+
+private:
+
+    struct QueuedFile
+    {
+        std::string filename;
+        int64_t request;
+        int64_t budgetBytes;
+    };
+
+    std::mutex _mutex;
+    std::condition_variable _workExists;
+    std::condition_variable _idle;
+    std::thread _thread;
+    std::atomic_bool _stop{ false };
+    bool _busy = false;
+
+    std::vector<std::string> _paths;
+    std::unordered_set<Key> _requestedMaterials;
+    std::unordered_set<std::string> _warmedFiles;
+    std::deque<QueuedFile> _queue;
+
+    std::atomic_int64_t _requestCount{ 0 };
+    std::atomic_int64_t _fileCount{ 0 };
+    std::atomic_int64_t _byteCount{ 0 };
+};
+
+#endif // _SYZYGYWARMUP_H_
@@ -16,8 +16,23 @@
 
 #include "Threading.h"
 
-#include <chrono>
-#include <functional>
+#include <climits>
+
+#include "MetricsRegistry.h"
+#include "Platform.h"
+#include "Trace.h"
+
+#ifdef CHESSCOACH_WINDOWS
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#else
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(std::atomic_uint32_t) == sizeof(uint32_t));
 
 Throttle::Throttle(int durationMilliseconds)
     : _durationMilliseconds(durationMilliseconds)
@@ -41,19 +56,75 @@ bool Throttle::TryFire()
     return false;
 }
 
+WakeWord::WakeWord()
+    : _word(0)
+    , _waiterCount(0)
+{
+}
+
+uint32_t WakeWord::Load() const
+{
+    return _word.load();
+}
+
+void WakeWord::Wake()
+{
+    // Sequential consistency pairs the increment here with "_waiterCount" in "Wait": either the waiter
+    // is counted and gets woken, or the kernel sees the new word and doesn't put it to sleep.
+    _word.fetch_add(1);
+    if (_waiterCount.load() == 0)
+    {
+        return;
+    }
+
+#ifdef CHESSCOACH_WINDOWS
+    ::WakeByAddressAll(&_word);
+#else
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+void WakeWord::Wait(uint32_t observed, int timeoutMilliseconds)
+{
+    _waiterCount.fetch_add(1);
+
+#ifdef CHESSCOACH_WINDOWS
+    ::WaitOnAddress(&_word, &observed, sizeof(observed), (timeoutMilliseconds >= 0) ? static_cast<DWORD>(timeoutMilliseconds) : INFINITE);
+#else
+    timespec timeout{ timeoutMilliseconds / 1000, (timeoutMilliseconds % 1000) * 1000000L };
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_word), FUTEX_WAIT_PRIVATE, observed,
+        (timeoutMilliseconds >= 0) ? &timeout : nullptr, nullptr, 0);
+#endif
+
+    _waiterCount.fetch_sub(1);
+}
+
 WorkCoordinator::WorkCoordinator(int workerCount)
-    : _workItemsRemaining(0)
+    : _workers(new WorkerSlot[workerCount])
+    , _workItemsRemaining(0)
     , _shutDown(false)
     , _workerCount(workerCount)
     , _workerReadyCount(0)
+    , _workRequested(Now())
+    , _stopRequested(Now())
+    , _stopPending(false)
+    , _lastStopLatency(0)
     , _generateUniformPredictions(false)
 {
+    for (int i = 0; i < workerCount; i++)
+    {
+        _workers[i].state.store(WorkerState_Starting, std::memory_order_relaxed);
+    }
 }
 
 void WorkCoordinator::OnWorkItemCompleted()
 {
-    // This may go below zero, which is fine for our use.
-    _workItemsRemaining.fetch_sub(1, std::memory_order_relaxed);
+    // This may go below zero, which is fine for our use. Only the final item stops work.
+    if (_workItemsRemaining.fetch_sub(1, std::memory_order_relaxed) == 1)
+    {
+        OnStopRequested();
+        WakeWorkers();
+    }
 }
 
 bool WorkCoordinator::AllWorkItemsCompleted()
@@ -63,62 +134,131 @@ bool WorkCoordinator::AllWorkItemsCompleted()
 
 void WorkCoordinator::ResetWorkItemsRemaining(int workItemsRemaining)
 {
-    std::lock_guard lock(_mutex);
-
-    _workItemsRemaining.store(workItemsRemaining, std::memory_order_relaxed);
-
-    if (CheckWorkItemsExist())
+    if (workItemsRemaining > 0)
+    {
+        _workRequested.store(Now());
+        _stopPending.store(false);
+    }
+    else if (CheckWorkItemsExist())
     {
-        _workItemsExist.notify_all();
+        OnStopRequested();
     }
+
+    _workItemsRemaining.store(workItemsRemaining);
+
+    // Wake idle workers for new work, and sleeping workers to stop.
+    WakeWorkers();
 }
 
 void WorkCoordinator::ShutDown()
 {
-    std::lock_guard lock(_mutex);
-
-    _shutDown = true;
-    _workItemsExist.notify_all();
+    _shutDown.store(true);
+    WakeWorkers();
 }
 
 // Returns true if work items found, false to shut down.
-bool WorkCoordinator::WaitForWorkItems()
+bool WorkCoordinator::WaitForWorkItems(int workerIndex)
 {
-    std::unique_lock lock(_mutex);
+    CHESSCOACH_TRACE_SCOPE("WaitForWorkItems");
+
+    static MetricHistogram& stopLatency = MetricsRegistry::Instance.Histogram("chesscoach_workers_stop_seconds",
+        "Time from work running out until all workers are idle");
+    static MetricHistogram& wakeLatency = MetricsRegistry::Instance.Histogram("chesscoach_workers_wake_seconds",
+        "Time from work being requested until each worker starts");
 
-    _workerReadyCount++;
+    WorkerSlot& worker = _workers[workerIndex];
+    worker.state.store(WorkerState_Idle, std::memory_order_relaxed);
 
-    if (CheckWorkersReady())
+    // The last worker to go idle after work runs out wakes the controlling thread.
+    if (((_workerReadyCount.fetch_add(1) + 1) >= _workerCount) && AllWorkItemsCompleted())
     {
-        _workersReady.notify_all();
+        if (_stopPending.exchange(false))
+        {
+            const std::chrono::nanoseconds latency = SinceStopRequested();
+            _lastStopLatency.store(latency.count(), std::memory_order_relaxed);
+            stopLatency.Record(latency);
+        }
+        _workersReady.Wake();
     }
 
-    while (!CheckWorkItemsExist() && !_shutDown)
+    while (!_shutDown.load())
     {
-        _workItemsExist.wait(lock);
+        const uint32_t observed = worker.wake.Load();
+        if (CheckWorkItemsExist() || _shutDown.load())
+        {
+            break;
+        }
+        worker.wake.Wait(observed);
     }
 
-    _workerReadyCount--;
+    _workerReadyCount.fetch_sub(1);
+
+    if (_shutDown.load())
+    {
+        worker.state.store(WorkerState_ShutDown, std::memory_order_relaxed);
+        return false;
+    }
 
-    return !_shutDown;
+    worker.state.store(WorkerState_Working, std::memory_order_relaxed);
+    wakeLatency.Record(SinceWorkRequested());
+    return true;
 }
 
 void WorkCoordinator::WaitForWorkers()
 {
-    std::unique_lock lock(_mutex);
+    CHESSCOACH_TRACE_SCOPE("WaitForWorkers");
 
-    while (!CheckWorkersReady())
+    while (true)
     {
-        _workersReady.wait(lock);
+        const uint32_t observed = _workersReady.Load();
+        if (CheckWorkersReady())
+        {
+            return;
+        }
+        _workersReady.Wait(observed);
     }
 }
 
 bool WorkCoordinator::WaitForWorkers(int timeoutMilliseconds)
 {
-    std::unique_lock lock(_mutex);
+    CHESSCOACH_TRACE_SCOPE("WaitForWorkers");
+
+    const std::chrono::time_point<std::chrono::high_resolution_clock> deadline =
+        (std::chrono::high_resolution_clock::now() + std::chrono::milliseconds(timeoutMilliseconds));
+    while (true)
+    {
+        const uint32_t observed = _workersReady.Load();
+        if (CheckWorkersReady())
+        {
+            return true;
+        }
+
+        const int64_t remainingMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::high_resolution_clock::now()).count();
+        if (remainingMilliseconds <= 0)
+        {
+            return false;
+        }
+        _workersReady.Wait(observed, static_cast<int>(remainingMilliseconds));
+    }
+}
+
+void WorkCoordinator::WaitForWake(int workerIndex, int timeoutMilliseconds)
+{
+    WakeWord& wake = _workers[workerIndex].wake;
+    const uint32_t observed = wake.Load();
+    if (!AllWorkItemsCompleted())
+    {
+        wake.Wait(observed, timeoutMilliseconds);
+    }
+}
 
-    return _workersReady.wait_for(lock, std::chrono::milliseconds(timeoutMilliseconds),
-        std::bind(&WorkCoordinator::CheckWorkersReady, this));
+void WorkCoordinator::WakeWorkers()
+{
+    for (int i = 0; i < _workerCount; i++)
+    {
+        _workers[i].wake.Wake();
+    }
 }
 
 bool WorkCoordinator::CheckWorkItemsExist()
@@ -130,10 +270,43 @@ bool WorkCoordinator::CheckWorkersReady()
 {
     // Workers are only ready *for new work*. Otherwise they're just lazy
     // and haven't started yet.
-    return !CheckWorkItemsExist() && (_workerReadyCount >= _workerCount);
+    return !CheckWorkItemsExist() && (_workerReadyCount.load() >= _workerCount);
+}
+
+WorkerState WorkCoordinator::State(int workerIndex) const
+{
+    return static_cast<WorkerState>(_workers[workerIndex].state.load(std::memory_order_relaxed));
+}
+
+std::chrono::nanoseconds WorkCoordinator::SinceWorkRequested() const
+{
+    return std::chrono::nanoseconds(Now() - _workRequested.load(std::memory_order_relaxed));
+}
+
+std::chrono::nanoseconds WorkCoordinator::SinceStopRequested() const
+{
+    return std::chrono::nanoseconds(Now() - _stopRequested.load(std::memory_order_relaxed));
+}
+
+// How long the most recent stop took from work running out until all workers were idle.
+std::chrono::nanoseconds WorkCoordinator::LastStopLatency() const
+{
+    return std::chrono::nanoseconds(_lastStopLatency.load(std::memory_order_relaxed));
 }
 
 bool& WorkCoordinator::GenerateUniformPredictions()
 {
     return _generateUniformPredictions;
+}
+
+int64_t WorkCoordinator::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+void WorkCoordinator::OnStopRequested()
+{
+    _stopRequested.store(Now(), std::memory_order_relaxed);
+    _stopPending.store(true);
 }
\ No newline at end of file
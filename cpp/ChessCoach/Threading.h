@@ -18,9 +18,13 @@
 #define _THREADING_H_
 
 #include <cassert>
-#include <mutex>
-#include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 class Throttle
 {
@@ -36,6 +40,156 @@ private:
     std::atomic_int64_t _last;
 };
 
+// A 32-bit word that threads sleep on until another thread bumps it, using futex on Linux and
+// WaitOnAddress on Windows. Waking costs a single atomic increment when nobody is sleeping.
+class WakeWord
+{
+public:
+
+    WakeWord();
+
+    uint32_t Load() const;
+    void Wake();
+
+    // Returns immediately if the word no longer matches "observed". Wakeups may be spurious,
+    // so callers re-check their condition. A negative timeout waits indefinitely.
+    void Wait(uint32_t observed, int timeoutMilliseconds = -1);
+
+private:
+
+    std::atomic_uint32_t _word;
+    std::atomic_int _waiterCount;
+};
+
+// Adds to a counter written only by its owning thread, so a plain load/store pair avoids a locked instruction.
+// Other threads can still read it with relaxed loads.
+inline void IncrementOwned(std::atomic_int64_t& counter, int64_t amount = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Per-thread buffers that outlive their threads, e.g. for counters or events read by other threads.
+// A thread claims a buffer on first use, reusing one released by an exited thread if possible, so that
+// repeatedly starting worker groups doesn't grow memory. "T" needs an "std::atomic_bool owned" member.
+// Buffers are never removed, so their index in "Buffers" doubles as a stable thread ID.
+template <typename T>
+class ThreadBufferRegistry
+{
+public:
+
+    ThreadBufferRegistry() = default;
+    ThreadBufferRegistry(const ThreadBufferRegistry& other) = delete;
+    ThreadBufferRegistry& operator=(const ThreadBufferRegistry& other) = delete;
+
+    // Guards "Buffers" and claiming.
+    std::mutex& Mutex() const
+    {
+        return _mutex;
+    }
+
+    // Caller holds "Mutex".
+    const std::vector<std::unique_ptr<T>>& Buffers() const
+    {
+        return _buffers;
+    }
+
+    // Caller holds "Mutex". "create" is called with the new buffer's index if none can be reused.
+    template <typename Create>
+    T* ClaimLocked(Create&& create)
+    {
+        for (const auto& existing : _buffers)
+        {
+            bool owned = false;
+            if (existing->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+            {
+                return existing.get();
+            }
+        }
+
+        T* buffer = _buffers.emplace_back(create(static_cast<int>(_buffers.size()))).get();
+        buffer->owned.store(true, std::memory_order_relaxed);
+        return buffer;
+    }
+
+    template <typename Create>
+    T* Claim(Create&& create)
+    {
+        std::lock_guard lock(_mutex);
+        return ClaimLocked(std::forward<Create>(create));
+    }
+
+    static void Release(T& buffer)
+    {
+        buffer.owned.store(false, std::memory_order_release);
+    }
+
+private:
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<T>> _buffers;
+};
+
+// Holds the calling thread's claimed buffer as a "thread_local", releasing it when the thread exits.
+template <typename T>
+class ThreadBuffer
+{
+public:
+
+    ThreadBuffer() = default;
+    ThreadBuffer(const ThreadBuffer& other) = delete;
+    ThreadBuffer& operator=(const ThreadBuffer& other) = delete;
+
+    ~ThreadBuffer()
+    {
+        if (_buffer)
+        {
+            ThreadBufferRegistry<T>::Release(*_buffer);
+        }
+    }
+
+    T* Get() const
+    {
+        return _buffer;
+    }
+
+    // Claims a buffer from "registry" on this thread's first call.
+    template <typename Create>
+    T& Get(ThreadBufferRegistry<T>& registry, Create&& create)
+    {
+        if (!_buffer)
+        {
+            _buffer = registry.Claim(std::forward<Create>(create));
+        }
+        return *_buffer;
+    }
+
+    // Caller holds the registry's mutex.
+    template <typename Create>
+    T& GetLocked(ThreadBufferRegistry<T>& registry, Create&& create)
+    {
+        if (!_buffer)
+        {
+            _buffer = registry.ClaimLocked(std::forward<Create>(create));
+        }
+        return *_buffer;
+    }
+
+private:
+
+    T* _buffer = nullptr;
+};
+
+enum WorkerState
+{
+    WorkerState_Starting,
+    WorkerState_Idle,
+    WorkerState_Working,
+    WorkerState_ShutDown,
+};
+
+// Hands work items to a fixed set of worker threads and lets the controlling thread wait for them to finish.
+// Each worker has its own state and wake word, so "go" and "stop" wake sleeping workers directly rather than
+// waiting for them to notice between batches, and the time taken to start and stop is recorded.
 class WorkCoordinator
 {
 public:
@@ -48,29 +202,54 @@ public:
     void ResetWorkItemsRemaining(int workItemsRemaining);
     void ShutDown();
 
-    bool WaitForWorkItems();
+    bool WaitForWorkItems(int workerIndex);
     void WaitForWorkers();
     bool WaitForWorkers(int timeoutMilliseconds);
 
+    // Sleep a working thread until woken via "WakeWorkers", work items run out, or the timeout passes.
+    void WaitForWake(int workerIndex, int timeoutMilliseconds);
+    void WakeWorkers();
+
     bool CheckWorkItemsExist();
     bool CheckWorkersReady();
+    WorkerState State(int workerIndex) const;
+
+    std::chrono::nanoseconds SinceWorkRequested() const;
+    std::chrono::nanoseconds SinceStopRequested() const;
+    std::chrono::nanoseconds LastStopLatency() const;
 
     bool& GenerateUniformPredictions();
 
 private:
 
-    std::mutex _mutex;
-    std::condition_variable _workItemsExist;
-    std::condition_variable _workersReady;
+    struct alignas(64) WorkerSlot
+    {
+        std::atomic_int state;
+        WakeWord wake;
+    };
+
+    static int64_t Now();
+
+    void OnStopRequested();
+
+private:
+
+    std::unique_ptr<WorkerSlot[]> _workers;
+    WakeWord _workersReady;
 
-    // Atomic is not needed for the locks/waits, but is for OnWorkItemCompleted/AllWorkItemsCompleted.
     std::atomic_int _workItemsRemaining;
-    bool _shutDown;
+    std::atomic_bool _shutDown;
 
     int _workerCount;
-    int _workerReadyCount;
+    std::atomic_int _workerReadyCount;
+
+    // Timestamps in nanoseconds for start and stop latency.
+    std::atomic_int64_t _workRequested;
+    std::atomic_int64_t _stopRequested;
+    std::atomic_bool _stopPending;
+    std::atomic_int64_t _lastStopLatency;
 
-    // Rely on fencing via _mutex.
+    // Rely on fencing via "_workItemsRemaining", set before workers are woken.
     bool _generateUniformPredictions;
 };
 
@@ -0,0 +1,159 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "Config.h"
+#include "Storage.h"
+#include "Threading.h"
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t startNanoseconds;
+    int64_t durationNanoseconds;
+};
+
+// Written only by its owning thread, so "written" only ever increases. Readers copy events and then re-check
+// "written" to drop any the owner may have overwritten meanwhile (seqlock-style). Clearing just raises "cleared",
+// the first event index to dump, so it never races with the owner's writes.
+struct TraceBuffer
+{
+    TraceBuffer(int setThreadId, int capacity)
+        : threadId(setThreadId)
+        , events(capacity)
+        , mask(capacity - 1)
+        , written(0)
+        , cleared(0)
+        , owned(false)
+    {
+    }
+
+    const int threadId;
+    std::vector<TraceEvent> events;
+    const int64_t mask;
+    std::atomic_int64_t written;
+    std::atomic_int64_t cleared;
+    std::atomic_bool owned;
+};
+
+// Buffers released by exited threads keep their events until overwritten by the next owner.
+static ThreadBufferRegistry<TraceBuffer> TraceBuffers;
+thread_local static ThreadBuffer<TraceBuffer> ThreadTraceBuffer;
+static const std::chrono::steady_clock::time_point TraceEpoch = std::chrono::steady_clock::now();
+
+std::atomic_bool Trace::EnabledFlag(false);
+
+void Trace::SetEnabled(bool enabled)
+{
+    EnabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t Trace::NowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - TraceEpoch).count();
+}
+
+void Trace::Record(const char* name, int64_t startNanoseconds, int64_t endNanoseconds)
+{
+    TraceBuffer& buffer = ThreadTraceBuffer.Get(TraceBuffers, [](int threadId)
+        {
+            // Round capacity up to a power of two for cheap wrapping.
+            int capacity = 1;
+            while (capacity < Config::Misc.Trace_BufferEvents)
+            {
+                capacity <<= 1;
+            }
+            return new TraceBuffer(threadId, capacity);
+        });
+
+    const int64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index & buffer.mask] = { name, startNanoseconds, (endNanoseconds - startNanoseconds) };
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Trace::Dump(std::ostream& stream)
+{
+    std::lock_guard lock(TraceBuffers.Mutex());
+
+    // Use "X" (complete) events with microsecond timestamps, one "thread" per buffer.
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    std::vector<TraceEvent> events;
+    for (const auto& buffer : TraceBuffers.Buffers())
+    {
+        stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"Thread " << buffer->threadId << "\"}}";
+        first = false;
+
+        // Copy out events published so far, then re-check "written". The owner may have overwritten the oldest
+        // copied events since, and may be mid-write into the slot of the event "capacity" before its next one.
+        const int64_t written = buffer->written.load(std::memory_order_acquire);
+        const int64_t capacity = static_cast<int64_t>(buffer->events.size());
+        const int64_t begin = std::max({ int64_t(0), written - capacity, buffer->cleared.load(std::memory_order_relaxed) });
+        events.clear();
+        for (int64_t i = begin; i < written; i++)
+        {
+            events.push_back(buffer->events[i & buffer->mask]);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const int64_t rewritten = buffer->written.load(std::memory_order_relaxed);
+        const int64_t intact = std::max(begin, rewritten - capacity + 1);
+
+        for (int64_t i = intact; i < written; i++)
+        {
+            const TraceEvent& event = events[i - begin];
+            stream << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << (event.startNanoseconds / 1000) << "." << std::setw(3) << std::setfill('0') << (event.startNanoseconds % 1000)
+                << ",\"dur\":" << (event.durationNanoseconds / 1000) << "." << std::setw(3) << std::setfill('0') << (event.durationNanoseconds % 1000)
+                << "}";
+        }
+    }
+    stream << "\n]}" << std::endl;
+}
+
+std::filesystem::path Trace::DumpToLogs()
+{
+    std::stringstream filename;
+    const std::time_t time = std::time(nullptr);
+#pragma warning(disable:4996) // Internal buffer is immediately consumed and detached.
+    filename << std::put_time(std::localtime(&time), "ChessCoachTrace_%Y%m%d_%H%M%S.json");
+#pragma warning(default:4996) // Internal buffer is immediately consumed and detached.
+
+    const std::filesystem::path path = (Storage::MakeLocalPath(Config::Misc.Paths_Logs) / filename.str());
+    std::ofstream file(path, std::ios::out);
+    Dump(file);
+    return path;
+}
+
+void Trace::Clear()
+{
+    std::lock_guard lock(TraceBuffers.Mutex());
+
+    // Owners keep writing from their current index, so hide everything published so far instead of resetting.
+    for (const auto& buffer : TraceBuffers.Buffers())
+    {
+        buffer->cleared.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
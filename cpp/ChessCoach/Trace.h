@@ -0,0 +1,87 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+
+// Scoped trace events are recorded per thread into ring buffers and dumped on demand as Chrome trace JSON,
+// viewable in chrome://tracing or https://ui.perfetto.dev. Recording is off unless enabled via the "trace"
+// config key or UCI option, leaving a relaxed load per scope. Define CHESSCOACH_NO_TRACE to compile scopes out.
+#ifdef CHESSCOACH_NO_TRACE
+#define CHESSCOACH_TRACE_SCOPE(name)
+#else
+#define CHESSCOACH_TRACE_CONCATENATE_INNER(a, b) a##b
+#define CHESSCOACH_TRACE_CONCATENATE(a, b) CHESSCOACH_TRACE_CONCATENATE_INNER(a, b)
+#define CHESSCOACH_TRACE_SCOPE(name) const TraceScope CHESSCOACH_TRACE_CONCATENATE(traceScope, __LINE__)(name)
+#endif
+
+class Trace
+{
+public:
+
+    static bool Enabled()
+    {
+        return EnabledFlag.load(std::memory_order_relaxed);
+    }
+
+    static void SetEnabled(bool enabled);
+    static int64_t NowNanoseconds();
+
+    // "name" must outlive the trace, e.g. a string literal.
+    static void Record(const char* name, int64_t startNanoseconds, int64_t endNanoseconds);
+
+    static void Dump(std::ostream& stream);
+    static std::filesystem::path DumpToLogs();
+    static void Clear();
+
+private:
+
+    static std::atomic_bool EnabledFlag;
+};
+
+class TraceScope
+{
+public:
+
+    explicit TraceScope(const char* name)
+        : _name(Trace::Enabled() ? name : nullptr)
+        , _startNanoseconds(_name ? Trace::NowNanoseconds() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (_name)
+        {
+            Trace::Record(_name, _startNanoseconds, Trace::NowNanoseconds());
+        }
+    }
+
+    TraceScope(const TraceScope& other) = delete;
+    TraceScope& operator=(const TraceScope& other) = delete;
+
+private:
+
+    const char* _name;
+    int64_t _startNanoseconds;
+};
+
+#endif // _TRACE_H_
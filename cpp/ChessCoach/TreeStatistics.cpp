@@ -0,0 +1,246 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include "TreeStatistics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iomanip>
+#include <thread>
+
+void TreeDepthStatistics::Add(const TreeDepthStatistics& other)
+{
+    nodeCount += other.nodeCount;
+    visitCount += other.visitCount;
+    expandedCount += other.expandedCount;
+    childCount += other.childCount;
+    visitedChildCount += other.visitedChildCount;
+    wastedExpansionCount += other.wastedExpansionCount;
+    expandingCount += other.expandingCount;
+    terminalCount += other.terminalCount;
+    repetitionCount += other.repetitionCount;
+}
+
+// Walks visited nodes depth-first, keeping "position" in step via do_move/undo_move. The "states" deque
+// keeps StateInfo addresses stable as it grows.
+static void WalkTree(Position& position, std::deque<StateInfo>& states, const Node* node, int depth, std::vector<TreeDepthStatistics>& depths)
+{
+    const int visitCount = node->visitCount.load(std::memory_order_relaxed);
+    if (visitCount <= 0)
+    {
+        return;
+    }
+
+    if (depths.size() <= depth)
+    {
+        depths.resize(depth + 1);
+    }
+    TreeDepthStatistics& statistics = depths[depth];
+    statistics.nodeCount++;
+    statistics.visitCount += visitCount;
+
+    // Acquire-load to synchronize with the release-store of the expanding thread so that children are visible.
+    const Expansion expansion = node->expansion.load(std::memory_order_acquire);
+    if (expansion == Expansion::Expanded)
+    {
+        statistics.expandedCount++;
+        statistics.childCount += node->childCount;
+
+        // The expanding visit is the first; anything beyond that is a revisit.
+        if (visitCount <= 1)
+        {
+            statistics.wastedExpansionCount++;
+        }
+
+        if (states.size() <= depth)
+        {
+            states.emplace_back();
+        }
+        for (const Node& child : *node)
+        {
+            if (child.visitCount.load(std::memory_order_relaxed) <= 0)
+            {
+                continue;
+            }
+
+            statistics.visitedChildCount++;
+            const Move move = Move(child.move);
+            position.do_move(move, states[depth]);
+            WalkTree(position, states, &child, (depth + 1), depths);
+            position.undo_move(move);
+        }
+    }
+    else if (node->terminalValue.load(std::memory_order_relaxed).IsTerminal())
+    {
+        statistics.terminalCount++;
+    }
+    else if (expansion == Expansion::Expanding)
+    {
+        statistics.expandingCount++;
+    }
+    else
+    {
+        // Match "SelfPlayGame::IsDrawByTwofoldRepetition": ply to the search root is the depth.
+        const StateInfo* stateInfo = position.state_info();
+        if ((stateInfo->repetition > 0) && (stateInfo->repetition < depth))
+        {
+            statistics.repetitionCount++;
+        }
+    }
+}
+
+TreeStatistics TreeStatistics::Collect(const Position& searchRootPosition, const Node* root, int threadCount)
+{
+    TreeStatistics treeStatistics;
+    const int rootVisitCount = root->visitCount.load(std::memory_order_relaxed);
+    if (rootVisitCount <= 0)
+    {
+        return treeStatistics;
+    }
+
+    // Count the root itself, then split its visited children across threads.
+    TreeDepthStatistics rootStatistics{};
+    rootStatistics.nodeCount = 1;
+    rootStatistics.visitCount = rootVisitCount;
+    if (root->expansion.load(std::memory_order_acquire) != Expansion::Expanded)
+    {
+        rootStatistics.terminalCount = (root->terminalValue.load(std::memory_order_relaxed).IsTerminal() ? 1 : 0);
+        treeStatistics.depths.push_back(rootStatistics);
+        return treeStatistics;
+    }
+
+    std::vector<const Node*> rootChildren;
+    for (const Node& child : *root)
+    {
+        if (child.visitCount.load(std::memory_order_relaxed) > 0)
+        {
+            rootChildren.push_back(&child);
+        }
+    }
+    rootStatistics.expandedCount = 1;
+    rootStatistics.childCount = root->childCount;
+    rootStatistics.visitedChildCount = static_cast<int64_t>(rootChildren.size());
+    rootStatistics.wastedExpansionCount = ((rootVisitCount <= 1) ? 1 : 0);
+
+    threadCount = std::clamp(threadCount, 1, std::max(1, static_cast<int>(rootChildren.size())));
+    std::vector<std::vector<TreeDepthStatistics>> threadDepths(threadCount);
+    std::atomic_int nextChild(0);
+    const auto walk = [&](int threadIndex)
+    {
+        Position position = searchRootPosition;
+        std::deque<StateInfo> states(1);
+        for (int i = nextChild.fetch_add(1, std::memory_order_relaxed); i < rootChildren.size(); i = nextChild.fetch_add(1, std::memory_order_relaxed))
+        {
+            const Move move = Move(rootChildren[i]->move);
+            position.do_move(move, states[0]);
+            WalkTree(position, states, rootChildren[i], 1 /* depth */, threadDepths[threadIndex]);
+            position.undo_move(move);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++)
+    {
+        threads.emplace_back(walk, i);
+    }
+    walk(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Merge per-thread depths.
+    treeStatistics.depths.push_back(rootStatistics);
+    for (const std::vector<TreeDepthStatistics>& depths : threadDepths)
+    {
+        if (treeStatistics.depths.size() < depths.size())
+        {
+            treeStatistics.depths.resize(depths.size());
+        }
+        for (int i = 1; i < depths.size(); i++)
+        {
+            treeStatistics.depths[i].Add(depths[i]);
+        }
+    }
+    return treeStatistics;
+}
+
+int64_t TreeStatistics::NodeCount() const
+{
+    int64_t nodeCount = 0;
+    for (const TreeDepthStatistics& statistics : depths)
+    {
+        nodeCount += statistics.nodeCount;
+    }
+    return nodeCount;
+}
+
+int TreeStatistics::MaxDepth() const
+{
+    return (static_cast<int>(depths.size()) - 1);
+}
+
+void TreeStatistics::Print(std::ostream& stream, const char* prefix) const
+{
+    const auto ratio = [](int64_t numerator, int64_t denominator) { return ((denominator > 0) ? (static_cast<float>(numerator) / denominator) : 0.f); };
+
+    TreeDepthStatistics total{};
+    for (const TreeDepthStatistics& statistics : depths)
+    {
+        total.Add(statistics);
+    }
+
+    stream << std::fixed << std::setprecision(2);
+    stream << prefix << "tree nodes " << total.nodeCount << " visits " << total.visitCount << " maxdepth " << MaxDepth()
+        << " branching " << ratio(total.childCount, total.expandedCount)
+        << " visitedbranching " << ratio(total.visitedChildCount, total.expandedCount)
+        << " wasted " << total.wastedExpansionCount
+        << " expanding " << total.expandingCount
+        << " terminals " << total.terminalCount
+        << " repetitions " << total.repetitionCount
+        << " failed " << ratio(searchFailedNodeCount, searchNodeCount + searchFailedNodeCount) << std::endl;
+    for (int depth = 0; depth < depths.size(); depth++)
+    {
+        const TreeDepthStatistics& statistics = depths[depth];
+        stream << prefix << "depth " << depth << " nodes " << statistics.nodeCount << " visits " << statistics.visitCount
+            << " expanded " << statistics.expandedCount
+            << " branching " << ratio(statistics.childCount, statistics.expandedCount)
+            << " visitedbranching " << ratio(statistics.visitedChildCount, statistics.expandedCount)
+            << " wasted " << statistics.wastedExpansionCount
+            << " expanding " << statistics.expandingCount
+            << " terminals " << statistics.terminalCount
+            << " repetitions " << statistics.repetitionCount << std::endl;
+    }
+    stream << std::defaultfloat;
+}
+
+void TreeStatistics::WriteCsvHeader(std::ostream& stream)
+{
+    stream << "search,depth,nodes,visits,expanded,children,visited_children,wasted_expansions,expanding,terminals,repetitions" << std::endl;
+}
+
+void TreeStatistics::WriteCsv(std::ostream& stream, int64_t searchId) const
+{
+    for (int depth = 0; depth < depths.size(); depth++)
+    {
+        const TreeDepthStatistics& statistics = depths[depth];
+        stream << searchId << "," << depth << "," << statistics.nodeCount << "," << statistics.visitCount
+            << "," << statistics.expandedCount << "," << statistics.childCount << "," << statistics.visitedChildCount
+            << "," << statistics.wastedExpansionCount << "," << statistics.expandingCount
+            << "," << statistics.terminalCount << "," << statistics.repetitionCount << std::endl;
+    }
+}
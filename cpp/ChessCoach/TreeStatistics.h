@@ -0,0 +1,71 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _TREESTATISTICS_H_
+#define _TREESTATISTICS_H_
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <Stockfish/position.h>
+
+#include "SelfPlay.h"
+
+// Counts for visited nodes at a single depth below the search root (the root is depth 0).
+struct TreeDepthStatistics
+{
+    int64_t nodeCount;
+    int64_t visitCount;
+    int64_t expandedCount;
+    int64_t childCount; // Across expanded nodes, for branching factor
+    int64_t visitedChildCount; // Across expanded nodes, for effective branching factor
+    int64_t wastedExpansionCount; // Expanded but never revisited
+    int64_t expandingCount; // Still owned by a thread waiting for a prediction
+    int64_t terminalCount;
+    int64_t repetitionCount; // 2-repetition draws, not cached as terminal
+
+    void Add(const TreeDepthStatistics& other);
+};
+
+// The shape of a search tree, used to tune search parallelism, elimination and slowstart.
+// Collection replays moves from the search root to detect 2-repetitions, splitting root children
+// across threads. Searches may continue during collection, giving an approximate snapshot.
+class TreeStatistics
+{
+public:
+
+    static TreeStatistics Collect(const Position& searchRootPosition, const Node* root, int threadCount);
+    static void WriteCsvHeader(std::ostream& stream);
+
+public:
+
+    int64_t NodeCount() const;
+    int MaxDepth() const;
+
+    void Print(std::ostream& stream, const char* prefix) const;
+    void WriteCsv(std::ostream& stream, int64_t searchId) const;
+
+public:
+
+    std::vector<TreeDepthStatistics> depths;
+
+    // Search selections (successful and failed) since the search started, when collected from a search.
+    int64_t searchNodeCount = 0;
+    int64_t searchFailedNodeCount = 0;
+};
+
+#endif // _TREESTATISTICS_H_
@@ -0,0 +1,448 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <tclap/CmdLine.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/HardwareCounters.h>
+#include <ChessCoach/Metrics.h>
+#include <ChessCoach/Platform.h>
+#include <ChessCoach/PredictionCache.h>
+#include <ChessCoach/Storage.h>
+#include <ChessCoach/Syzygy.h>
+#include <ChessCoach/Trace.h>
+#include <ChessCoach/WorkerGroup.h>
+
+// Deterministic stand-in for the Python/TensorFlow network so that the self-play pipeline can be measured
+// without a trained model or accelerator. Predictions are a pure function of the input image, and each
+// batch sleeps for a configurable latency. Files are saved under a local root directory.
+class SyntheticNetwork : public INetwork
+{
+public:
+
+    SyntheticNetwork(const std::filesystem::path& root, int latencyMs, int latencyUsPerPosition);
+
+    virtual PredictionStatus PredictBatch(NetworkType networkType, int batchSize, InputPlanes* images, float* values, OutputPlanes* policies);
+    virtual std::vector<std::string> PredictCommentaryBatch(int batchSize, CommentaryInputPlanes* images);
+    virtual void Train(NetworkType networkType, int step, int checkpoint);
+    virtual void TrainCommentary(int step, int checkpoint);
+    virtual void LogScalars(NetworkType networkType, int step, const std::vector<std::string> names, float* values);
+    virtual void SaveNetwork(NetworkType networkType, int checkpoint);
+    virtual void SaveSwaNetwork(NetworkType networkType, int checkpoint);
+    virtual void UpdateNetworkWeights(const std::string& networkWeights);
+    virtual void GetNetworkInfo(NetworkType networkType, int* stepCountOut, int* swaStepCountOut, int* trainingChunkCountOut, std::string* relativePathOut);
+    virtual void SaveFile(const std::string& relativePath, const std::string& data);
+    virtual std::string LoadFile(const std::string& relativePath);
+    virtual bool FileExists(const std::string& relativePath);
+    virtual void LaunchGui(const std::string& mode);
+    virtual void UpdateGui(const std::string& fen, const std::string& line, int nodeCount, const std::string& evaluation, const std::string& principalVariation,
+        const std::vector<std::string>& sans, const std::vector<std::string>& froms, const std::vector<std::string>& tos, std::vector<float>& targets,
+        std::vector<float>& priors, std::vector<float>& values, std::vector<float>& puct, std::vector<int>& visits, std::vector<int>& weights);
+    virtual void DebugDecompress(int positionCount, int policySize, float* result, int64_t* imagePiecesAuxiliary,
+        int64_t* policyRowLengths, int64_t* policyIndices, float* policyValues, int decompressPositionsModulus,
+        InputPlanes* imagesOut, float* valuesOut, OutputPlanes* policiesOut);
+    virtual void OptimizeParameters();
+    virtual void RunBot();
+    virtual void PlayBotMove(const std::string& gameId, const std::string& move);
+
+private:
+
+    std::filesystem::path _root;
+    std::chrono::microseconds _latencyPerBatch;
+    std::chrono::microseconds _latencyPerPosition;
+};
+
+class ChessCoachBenchSelfPlay : public ChessCoach
+{
+public:
+
+    ChessCoachBenchSelfPlay(int workerCount, int workerParallelism, int gameCount, int gamesPerChunk,
+        int latencyMs, int latencyUsPerPosition, float minGamesPerHour, bool keepFiles, bool hardwareCounters);
+
+    void Initialize();
+    void Finalize();
+
+    bool BenchSelfPlay();
+
+private:
+
+    int _workerCount;
+    int _workerParallelism;
+    int _gameCount;
+    int _gamesPerChunk;
+    int _latencyMs;
+    int _latencyUsPerPosition;
+    float _minGamesPerHour;
+    bool _keepFiles;
+    bool _hardwareCounters;
+};
+
+int main(int argc, char* argv[])
+{
+    int workerCount;
+    int workerParallelism;
+    int gameCount;
+    int gamesPerChunk;
+    int latencyMs;
+    int latencyUsPerPosition;
+    float minGamesPerHour;
+    bool keepFiles;
+    bool hardwareCounters;
+
+    try
+    {
+        TCLAP::CmdLine cmd("ChessCoachBenchSelfPlay: Measures self-play throughput end-to-end using a synthetic network", ' ', "0.9");
+
+        TCLAP::ValueArg<int> workersArg("w", "workers", "Number of self-play workers (default from config)", false /* req */, 0, "whole number");
+        TCLAP::ValueArg<int> parallelismArg("p", "parallelism", "Games per worker, i.e. prediction batch size (default from config)", false /* req */, 0, "whole number");
+        TCLAP::ValueArg<int> gamesArg("g", "games", "Number of games to play", false /* req */, 100, "whole number");
+        TCLAP::ValueArg<int> gamesPerChunkArg("c", "chunk", "Games per chunk, small enough to exercise chunking", false /* req */, 25, "whole number");
+        TCLAP::ValueArg<int> latencyArg("l", "latency", "Synthetic prediction latency per batch (ms)", false /* req */, 5, "whole number");
+        TCLAP::ValueArg<int> latencyPerPositionArg("x", "latencyperposition", "Additional synthetic prediction latency per position (us)", false /* req */, 0, "whole number");
+        TCLAP::ValueArg<float> minGamesPerHourArg("m", "mingamesperhour", "Fail with a non-zero exit code below this throughput", false /* req */, 0.f, "decimal");
+        TCLAP::SwitchArg keepArg("k", "keep", "Keep the temporary games and chunks directory", false /* default */);
+        TCLAP::SwitchArg countersArg("e", "counters", "Sample hardware performance counters per search phase (Linux)", false /* default */);
+
+        // Usage/help seems to reverse this order.
+        cmd.add(countersArg);
+        cmd.add(keepArg);
+        cmd.add(minGamesPerHourArg);
+        cmd.add(latencyPerPositionArg);
+        cmd.add(latencyArg);
+        cmd.add(gamesPerChunkArg);
+        cmd.add(gamesArg);
+        cmd.add(parallelismArg);
+        cmd.add(workersArg);
+
+        cmd.parse(argc, argv);
+
+        workerCount = workersArg.getValue();
+        workerParallelism = parallelismArg.getValue();
+        gameCount = gamesArg.getValue();
+        gamesPerChunk = gamesPerChunkArg.getValue();
+        latencyMs = latencyArg.getValue();
+        latencyUsPerPosition = latencyPerPositionArg.getValue();
+        minGamesPerHour = minGamesPerHourArg.getValue();
+        keepFiles = keepArg.getValue();
+        hardwareCounters = countersArg.getValue();
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << " for argument " << e.argId() << std::endl;
+        return 1;
+    }
+
+    ChessCoachBenchSelfPlay benchSelfPlay(workerCount, workerParallelism, gameCount, gamesPerChunk,
+        latencyMs, latencyUsPerPosition, minGamesPerHour, keepFiles, hardwareCounters);
+
+    benchSelfPlay.PrintExceptions();
+    benchSelfPlay.Initialize();
+
+    const bool passed = benchSelfPlay.BenchSelfPlay();
+
+    benchSelfPlay.Finalize();
+
+    return (passed ? 0 : 2);
+}
+
+SyntheticNetwork::SyntheticNetwork(const std::filesystem::path& root, int latencyMs, int latencyUsPerPosition)
+    : _root(root)
+    , _latencyPerBatch(std::chrono::milliseconds(latencyMs))
+    , _latencyPerPosition(std::chrono::microseconds(latencyUsPerPosition))
+{
+}
+
+PredictionStatus SyntheticNetwork::PredictBatch(NetworkType /* networkType */, int batchSize, InputPlanes* images, float* values, OutputPlanes* policies)
+{
+    CHESSCOACH_TRACE_SCOPE("PredictBatch");
+
+    const std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < batchSize; i++)
+    {
+        // Hash the packed image (splitmix64 finalizer per plane).
+        uint64_t hash = 0;
+        for (const PackedPlane plane : images[i])
+        {
+            hash ^= plane;
+            hash = ((hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL);
+            hash = ((hash ^ (hash >> 27)) * 0x94D049BB133111EBULL);
+            hash ^= (hash >> 31);
+        }
+
+        // Use a mild value in [0.25, 0.75) so that games are decided by play rather than the stand-in network.
+        values[i] = (CHESSCOACH_VALUE_DRAW + ((static_cast<float>(hash >> 40) / static_cast<float>(1 << 24)) - 0.5f) * 0.5f);
+
+        // Fill policy logits in [-1, 1) from a xorshift stream seeded by the hash.
+        PlanesPointerFlat policy = reinterpret_cast<PlanesPointerFlat>(&policies[i]);
+        uint64_t state = (hash | 1);
+        for (int j = 0; j < OutputPlanesFloatCount; j++)
+        {
+            state ^= (state << 13);
+            state ^= (state >> 7);
+            state ^= (state << 17);
+            policy[j] = ((static_cast<float>(state >> 40) / static_cast<float>(1 << 23)) - 1.f);
+        }
+    }
+
+    // Sleep out the remaining latency so that stand-in CPU work isn't double-counted.
+    std::this_thread::sleep_until(start + _latencyPerBatch + (batchSize * _latencyPerPosition));
+    return PredictionStatus_None;
+}
+
+std::vector<std::string> SyntheticNetwork::PredictCommentaryBatch(int /* batchSize */, CommentaryInputPlanes* /* images */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::Train(NetworkType /* networkType */, int /* step */, int /* checkpoint */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::TrainCommentary(int /* step */, int /* checkpoint */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::LogScalars(NetworkType /* networkType */, int /* step */, const std::vector<std::string> /* names */, float* /* values */)
+{
+}
+
+void SyntheticNetwork::SaveNetwork(NetworkType /* networkType */, int /* checkpoint */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::SaveSwaNetwork(NetworkType /* networkType */, int /* checkpoint */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::UpdateNetworkWeights(const std::string& /* networkWeights */)
+{
+}
+
+void SyntheticNetwork::GetNetworkInfo(NetworkType /* networkType */, int* stepCountOut, int* swaStepCountOut, int* trainingChunkCountOut, std::string* relativePathOut)
+{
+    if (stepCountOut) *stepCountOut = 0;
+    if (swaStepCountOut) *swaStepCountOut = 0;
+    if (trainingChunkCountOut) *trainingChunkCountOut = 0;
+    if (relativePathOut) *relativePathOut = "synthetic";
+}
+
+void SyntheticNetwork::SaveFile(const std::string& relativePath, const std::string& data)
+{
+    const std::filesystem::path path = (_root / relativePath);
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    file.write(data.data(), data.size());
+    if (!file)
+    {
+        throw ChessCoachException("Failed to write: " + path.string());
+    }
+}
+
+std::string SyntheticNetwork::LoadFile(const std::string& relativePath)
+{
+    std::ifstream file(_root / relativePath, std::ios::in | std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+bool SyntheticNetwork::FileExists(const std::string& relativePath)
+{
+    return std::filesystem::exists(_root / relativePath);
+}
+
+void SyntheticNetwork::LaunchGui(const std::string& /* mode */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::UpdateGui(const std::string& /* fen */, const std::string& /* line */, int /* nodeCount */, const std::string& /* evaluation */,
+    const std::string& /* principalVariation */, const std::vector<std::string>& /* sans */, const std::vector<std::string>& /* froms */,
+    const std::vector<std::string>& /* tos */, std::vector<float>& /* targets */, std::vector<float>& /* priors */, std::vector<float>& /* values */,
+    std::vector<float>& /* puct */, std::vector<int>& /* visits */, std::vector<int>& /* weights */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::DebugDecompress(int /* positionCount */, int /* policySize */, float* /* result */, int64_t* /* imagePiecesAuxiliary */,
+    int64_t* /* policyRowLengths */, int64_t* /* policyIndices */, float* /* policyValues */, int /* decompressPositionsModulus */,
+    InputPlanes* /* imagesOut */, float* /* valuesOut */, OutputPlanes* /* policiesOut */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::OptimizeParameters()
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::RunBot()
+{
+    throw ChessCoachException("Not implemented");
+}
+
+void SyntheticNetwork::PlayBotMove(const std::string& /* gameId */, const std::string& /* move */)
+{
+    throw ChessCoachException("Not implemented");
+}
+
+ChessCoachBenchSelfPlay::ChessCoachBenchSelfPlay(int workerCount, int workerParallelism, int gameCount, int gamesPerChunk,
+    int latencyMs, int latencyUsPerPosition, float minGamesPerHour, bool keepFiles, bool hardwareCounters)
+    : _workerCount(workerCount)
+    , _workerParallelism(workerParallelism)
+    , _gameCount(gameCount)
+    , _gamesPerChunk(gamesPerChunk)
+    , _latencyMs(latencyMs)
+    , _latencyUsPerPosition(latencyUsPerPosition)
+    , _minGamesPerHour(minGamesPerHour)
+    , _keepFiles(keepFiles)
+    , _hardwareCounters(hardwareCounters)
+{
+}
+
+void ChessCoachBenchSelfPlay::Initialize()
+{
+    // The synthetic network doesn't need Python.
+    InitializeStockfish();
+    InitializeChessCoach();
+    InitializePredictionCache();
+
+    if (_hardwareCounters)
+    {
+        HardwareCounters::SetEnabled(true);
+    }
+}
+
+void ChessCoachBenchSelfPlay::Finalize()
+{
+    FinalizeStockfish();
+}
+
+bool ChessCoachBenchSelfPlay::BenchSelfPlay()
+{
+    const int workerCount = ((_workerCount > 0) ? _workerCount : Config::Network.SelfPlay.NumWorkers);
+    const int workerParallelism = ((_workerParallelism > 0) ? _workerParallelism : Config::Network.SelfPlay.PredictionBatchSize);
+
+    // Redirect games, chunks and PGNs into a fresh temporary directory (absolute paths bypass the user data path).
+    const std::filesystem::path root = (std::filesystem::temp_directory_path() /
+        ("ChessCoachBenchSelfPlay_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count())));
+    const std::filesystem::path gamesPath = (root / "games");
+    Config::Network.Training.GamesPathTraining = gamesPath.string();
+    Config::Misc.Paths_Pgns = (root / "pgns").string();
+    Config::Misc.Storage_GamesPerChunk = _gamesPerChunk;
+
+    SyntheticNetwork network(root, _latencyMs, _latencyUsPerPosition);
+    Storage storage;
+    storage.InitializeLocalGamesChunks(&network);
+
+    // Initialize tablebases for self-play adjudication, as in training.
+    if (Config::Network.SelfPlay.AdjudicateTablebases)
+    {
+        Syzygy::Reload();
+    }
+
+    std::cout << "Benchmarking " << _gameCount << " games with " << workerCount << " workers x " << workerParallelism
+        << " games, " << _latencyMs << " ms/batch + " << _latencyUsPerPosition << " us/position synthetic latency, "
+        << _gamesPerChunk << " games/chunk, in " << root.string() << std::endl;
+
+    // Start self-play worker threads and wait until they're initialized.
+    WorkerGroup workerGroup;
+    workerGroup.Initialize(&network, &storage, Config::Network.SelfPlay.PredictionNetworkType, workerCount,
+        workerParallelism, &SelfPlayWorker::LoopSelfPlay);
+    workerGroup.workCoordinator->WaitForWorkers();
+    const HardwareCounterSnapshot countersStart = HardwareCounters::Take();
+
+    // Play the games, measuring wall and process CPU time. Note that "std::clock" is wall time on Windows.
+    const std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+    const std::clock_t cpuStart = std::clock();
+    workerGroup.workCoordinator->GenerateUniformPredictions() = false;
+    workerGroup.workCoordinator->ResetWorkItemsRemaining(_gameCount);
+    workerGroup.workCoordinator->WaitForWorkers();
+    const float cpuSeconds = (static_cast<float>(std::clock() - cpuStart) / CLOCKS_PER_SEC);
+    const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // Aggregate worker metrics before shutting down.
+    SelfPlayMetricsSnapshot total{};
+    for (const auto& worker : workerGroup.selfPlayWorkers)
+    {
+        SelfPlayMetricsSnapshot snapshot;
+        snapshot.Take(worker->Metrics());
+        total.gameCount += snapshot.gameCount;
+        total.plyCount += snapshot.plyCount;
+        total.simulationCount += snapshot.simulationCount;
+        total.cpuNanoseconds += snapshot.cpuNanoseconds;
+        total.predictNanoseconds += snapshot.predictNanoseconds;
+        total.storageNanoseconds += snapshot.storageNanoseconds;
+    }
+    workerGroup.ShutDown();
+
+    int chunkCount = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(gamesPath))
+    {
+        if (entry.path().extension().string() == ".chunk")
+        {
+            chunkCount++;
+        }
+    }
+
+    // Report throughput. Chunking overhead is time spent saving games (including chunking) as a proportion of worker time.
+    const auto safeDivide = [](double numerator, double denominator) { return ((denominator > 0) ? (numerator / denominator) : 0.0); };
+    const float gamesPerHour = static_cast<float>(safeDivide(total.gameCount * 3600.0, seconds));
+    const int64_t workerNanoseconds = (total.cpuNanoseconds + total.predictNanoseconds);
+    std::cout << "Played " << total.gameCount << " games, " << total.plyCount << " positions, "
+        << total.simulationCount << " simulations, " << chunkCount << " chunks in " << seconds << " seconds" << std::endl;
+    std::cout << "Games/hour: " << gamesPerHour << std::endl;
+    std::cout << "Positions/second: " << safeDivide(total.plyCount, seconds) << std::endl;
+    std::cout << "CPU time per simulation (us): " << safeDivide(cpuSeconds * 1000000.0, total.simulationCount) << std::endl;
+    std::cout << "Worker time in CPU work: " << (100.0 * safeDivide(total.cpuNanoseconds, workerNanoseconds)) << "%" << std::endl;
+    std::cout << "Chunking overhead: " << (100.0 * safeDivide(total.storageNanoseconds, workerNanoseconds)) << "% of worker time, "
+        << safeDivide(total.storageNanoseconds / 1000000.0, total.gameCount) << " ms/game" << std::endl;
+    PredictionCache::Instance.PrintDebugInfo();
+
+    // Print hardware counters per search phase and worker thread if sampling.
+    if (HardwareCounters::Enabled())
+    {
+        for (const std::string& line : HardwareCounters::Describe(HardwareCounters::Take(), countersStart))
+        {
+            std::cout << line << std::endl;
+        }
+    }
+
+    if (!_keepFiles)
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    if (gamesPerHour < _minGamesPerHour)
+    {
+        std::cout << "FAILED: " << gamesPerHour << " games/hour is below the minimum of " << _minGamesPerHour << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#ifndef _BENCHMARKFIXTURES_H_
+#define _BENCHMARKFIXTURES_H_
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Stockfish/movegen.h>
+
+#include <ChessCoach/Game.h>
+#include <ChessCoach/Pgn.h>
+#include <ChessCoach/SavedGame.h>
+
+// Fixed games so that benchmark results are comparable across commits.
+inline const char* FixturePgn()
+{
+    return
+        "[Event \"Paris\"]\n"
+        "[Site \"Paris FRA\"]\n"
+        "[Date \"1858.??.??\"]\n"
+        "[White \"Paul Morphy\"]\n"
+        "[Black \"Duke Karl / Count Isouard\"]\n"
+        "[Result \"1-0\"]\n"
+        "\n"
+        "1. e4 e5 2. Nf3 d6 3. d4 Bg4 4. dxe5 Bxf3 5. Qxf3 dxe5 6. Bc4 Nf6 7. Qb3 Qe7\n"
+        "8. Nc3 c6 9. Bg5 b5 10. Nxb5 cxb5 11. Bxb5+ Nbd7 12. O-O-O Rd8 13. Rxd7 Rxd7\n"
+        "14. Rd1 Qe6 15. Bxd7+ Nxd7 16. Qb8+ Nxb8 17. Rd8# 1-0\n"
+        "\n"
+        "[Event \"London\"]\n"
+        "[Site \"London ENG\"]\n"
+        "[Date \"1851.06.21\"]\n"
+        "[White \"Adolf Anderssen\"]\n"
+        "[Black \"Lionel Kieseritzky\"]\n"
+        "[Result \"1-0\"]\n"
+        "\n"
+        "1. e4 e5 2. f4 exf4 3. Bc4 Qh4+ 4. Kf1 b5 5. Bxb5 Nf6 6. Nf3 Qh6 7. d3 Nh5\n"
+        "8. Nh4 Qg5 9. Nf5 c6 10. g4 Nf6 11. Rg1 cxb5 12. h4 Qg6 13. h5 Qg5 14. Qf3 Ng8\n"
+        "15. Bxf4 Qf6 16. Nc3 Bc5 17. Nd5 Qxb2 18. Bd6 Bxg1 19. e5 Qxa1+ 20. Ke2 Na6\n"
+        "21. Nxg7+ Kd8 22. Qf6+ Nxf6 23. Be7# 1-0\n"
+        "\n";
+}
+
+inline std::vector<SavedGame> FixtureGames()
+{
+    std::vector<SavedGame> games;
+    std::stringstream content(FixturePgn());
+    Pgn::ParsePgn(content, false /* allowNoResult */, [&](SavedGame&& game, SavedCommentary&&)
+        {
+            games.emplace_back(std::move(game));
+        });
+    return games;
+}
+
+// Every non-terminal position in the fixture games, as moves from the starting position.
+inline std::vector<std::vector<Move>> FixturePositions()
+{
+    std::vector<std::vector<Move>> positions;
+    for (const SavedGame& game : FixtureGames())
+    {
+        std::vector<Move> moves;
+        for (int ply = 0; ply < game.moveCount; ply++)
+        {
+            positions.push_back(moves);
+            moves.push_back(Move(game.moves[ply]));
+        }
+    }
+    return positions;
+}
+
+// Positions from seeded random games, almost all distinct, as moves from the starting position.
+inline std::vector<std::vector<Move>> RandomWalkPositions(int count, unsigned int seed)
+{
+    const int maxPly = 100;
+    std::mt19937 random(seed);
+    std::vector<std::vector<Move>> positions;
+    Game game;
+    while (positions.size() < count)
+    {
+        const MoveList<LEGAL> legalMoves(game.GetPosition());
+        if ((legalMoves.size() == 0) || (game.Moves().size() >= maxPly) || game.IsDrawByNoProgressOrThreefoldRepetition())
+        {
+            game = Game();
+            continue;
+        }
+
+        std::uniform_int_distribution<int> distribution(0, static_cast<int>(legalMoves.size()) - 1);
+        game.ApplyMove(legalMoves.begin()[distribution(random)].move);
+        if (MoveList<LEGAL>(game.GetPosition()).size() > 0)
+        {
+            positions.push_back(game.Moves());
+        }
+    }
+    return positions;
+}
+
+#endif // _BENCHMARKFIXTURES_H_
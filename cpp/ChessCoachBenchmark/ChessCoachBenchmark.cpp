@@ -0,0 +1,40 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/PredictionCache.h>
+
+int main(int argc, char** argv)
+{
+    // Benchmarks use config defaults, so initialize once up-front rather than per fixture.
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    // Use a fixed prediction cache size so that results are comparable across machines and configs.
+    PredictionCache::Instance.Allocate(1024 /* sizeMebibytes */);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    chessCoach.Finalize();
+    return 0;
+}
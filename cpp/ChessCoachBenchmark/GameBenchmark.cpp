@@ -0,0 +1,68 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include <ChessCoach/Game.h>
+
+#include "BenchmarkFixtures.h"
+
+static std::vector<Game> FixtureGamePositions()
+{
+    std::vector<Game> games;
+    for (const std::vector<Move>& moves : FixturePositions())
+    {
+        games.emplace_back(Game::StartingPosition, moves);
+    }
+    return games;
+}
+
+// Generate the full network input image (including history planes) for each fixture position.
+static void BM_GenerateImage(benchmark::State& state)
+{
+    std::vector<Game> games = FixtureGamePositions();
+    std::unique_ptr<INetwork::InputPlanes> image(new INetwork::InputPlanes());
+    int index = 0;
+
+    for (auto _ : state)
+    {
+        games[index].GenerateImage(*image);
+        benchmark::DoNotOptimize(image->data());
+        index = ((index + 1) % games.size());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateImage);
+
+// Generate the prediction cache key for each fixture position, for self-play (including history) and for search (position only).
+static void BM_GenerateImageKey(benchmark::State& state)
+{
+    std::vector<Game> games = FixtureGamePositions();
+    const bool tryHard = state.range(0);
+    int index = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(games[index].GenerateImageKey(tryHard));
+        index = ((index + 1) % games.size());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateImageKey)->Arg(0)->Arg(1);
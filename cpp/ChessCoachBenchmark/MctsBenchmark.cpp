@@ -0,0 +1,366 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <ChessCoach/SelfPlay.h>
+#include <ChessCoach/Network.h>
+#include <ChessCoach/PredictionCache.h>
+
+#include "BenchmarkFixtures.h"
+
+// Synthetic search tree with a realistic shape: grown by PUCT selection from the root with a fixed
+// branching factor and seeded priors/values, so that visits concentrate down a few lines like real searches.
+// No chess positions are involved, so these benchmarks measure only tree traversal and statistics updates.
+class SyntheticTree
+{
+public:
+
+    static constexpr const int BranchingFactor = 30;
+    static constexpr const int PathCount = 4096;
+
+public:
+
+    SyntheticTree(int64_t nodeCount)
+        : _root()
+        , _nodeCount(1)
+        , _requestedNodeCount(nodeCount)
+        , _random(1)
+    {
+        SearchState searchState{};
+        std::vector<WeightedNode> searchPath;
+        while (_nodeCount < nodeCount)
+        {
+            Select(searchState, searchPath);
+            Expand(searchPath.back().node);
+            for (const WeightedNode& weightedNode : searchPath)
+            {
+                weightedNode.node->visitCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Record leaf paths spread across the tree so that backpropagation benchmarks touch the same nodes as real searches.
+        for (int i = 0; i < PathCount; i++)
+        {
+            Select(searchState, searchPath);
+            _paths.push_back(searchPath);
+            _values.push_back(_valueDistribution(_random));
+            for (const WeightedNode& weightedNode : searchPath)
+            {
+                weightedNode.node->visitCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    ~SyntheticTree()
+    {
+        Prune(&_root);
+    }
+
+    SyntheticTree(const SyntheticTree& other) = delete;
+    SyntheticTree& operator=(const SyntheticTree& other) = delete;
+
+    Node* Root()
+    {
+        return &_root;
+    }
+
+    int64_t NodeCount() const
+    {
+        return _nodeCount;
+    }
+
+    std::vector<WeightedNode>& Path(int index)
+    {
+        return _paths[index % PathCount];
+    }
+
+    float Value(int index) const
+    {
+        return _values[index % PathCount];
+    }
+
+    // Shared across benchmarks because growing large trees dominates run time.
+    static SyntheticTree& Get(int64_t nodeCount)
+    {
+        static std::unique_ptr<SyntheticTree> tree;
+        if (!tree || (tree->_requestedNodeCount != nodeCount))
+        {
+            tree.reset();
+            tree.reset(new SyntheticTree(nodeCount));
+        }
+        return *tree;
+    }
+
+private:
+
+    void Select(const SearchState& searchState, std::vector<WeightedNode>& searchPath)
+    {
+        searchPath.clear();
+        searchPath.push_back({ &_root, 1 });
+        Node* node = &_root;
+        while (node->IsExpanded())
+        {
+            const WeightedNode selected = PuctContext(&searchState, node).SelectChild();
+            searchPath.push_back(selected);
+            node = selected.node;
+        }
+    }
+
+    void Expand(Node* node)
+    {
+        node->children = new Node[BranchingFactor]{};
+        node->childCount = BranchingFactor;
+        for (int i = 0; i < BranchingFactor; i++)
+        {
+            Node& child = node->children[i];
+            child.move = static_cast<uint16_t>(i);
+            child.quantizedPrior = INetwork::QuantizeProbabilityNoZero(_priorDistribution(_random));
+            child.valueAverage.store(_valueDistribution(_random), std::memory_order_relaxed);
+            child.valueWeight.store(1, std::memory_order_relaxed);
+        }
+        node->expansion.store(Expansion::Expanded, std::memory_order_relaxed);
+        _nodeCount += BranchingFactor;
+    }
+
+    void Prune(Node* node)
+    {
+        for (Node& child : *node)
+        {
+            Prune(&child);
+        }
+        delete[] node->children;
+        node->children = nullptr;
+        node->childCount = 0;
+    }
+
+private:
+
+    Node _root;
+    int64_t _nodeCount;
+    int64_t _requestedNodeCount;
+    std::mt19937 _random;
+    std::uniform_real_distribution<float> _priorDistribution{ 0.f, (2.f / BranchingFactor) };
+    std::uniform_real_distribution<float> _valueDistribution{ 0.f, 1.f };
+    std::vector<std::vector<WeightedNode>> _paths;
+    std::vector<float> _values;
+};
+
+// Select a path from the root to a leaf, maintaining visit and virtual-loss counts as search does, and report per-node cost.
+static void BM_SelectChild(benchmark::State& state)
+{
+    SyntheticTree& tree = SyntheticTree::Get(state.range(0));
+    SearchState searchState{};
+    std::vector<Node*> searchPath;
+    int64_t nodesSelected = 0;
+
+    for (auto _ : state)
+    {
+        searchPath.clear();
+        Node* node = tree.Root();
+        while (node->IsExpanded())
+        {
+            node = PuctContext(&searchState, node).SelectChild().node;
+            node->visitingCount.fetch_add(1, std::memory_order_relaxed);
+            searchPath.push_back(node);
+        }
+        for (Node* visited : searchPath)
+        {
+            visited->visitingCount.fetch_sub(1, std::memory_order_relaxed);
+            visited->visitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        nodesSelected += searchPath.size();
+    }
+
+    state.SetItemsProcessed(nodesSelected);
+    state.counters["tree_nodes"] = static_cast<double>(tree.NodeCount());
+    state.counters["tree_mib"] = (static_cast<double>(tree.NodeCount() * sizeof(Node)) / (1024 * 1024));
+    state.counters["depth"] = benchmark::Counter(static_cast<double>(nodesSelected), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SelectChild)->Arg(1 << 14)->Arg(1 << 20)->Arg(1 << 23)->Unit(benchmark::kNanosecond);
+
+// Backpropagate values along pre-selected paths spread across the tree, and report per-node cost.
+static void BM_Backpropagate(benchmark::State& state)
+{
+    SyntheticTree& tree = SyntheticTree::Get(state.range(0));
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    int64_t nodesBackpropagated = 0;
+    int pathIndex = 0;
+
+    for (auto _ : state)
+    {
+        std::vector<WeightedNode>& searchPath = tree.Path(pathIndex);
+        for (const WeightedNode& weightedNode : searchPath)
+        {
+            weightedNode.node->visitingCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        selfPlayWorker.Backpropagate(searchPath, tree.Value(pathIndex), CHESSCOACH_VALUE_DRAW);
+        nodesBackpropagated += searchPath.size();
+        pathIndex++;
+    }
+
+    state.SetItemsProcessed(nodesBackpropagated);
+    state.counters["tree_nodes"] = static_cast<double>(tree.NodeCount());
+}
+BENCHMARK(BM_Backpropagate)->Arg(1 << 14)->Arg(1 << 20)->Arg(1 << 23)->Unit(benchmark::kNanosecond);
+
+// Buffers for "ExpandAndEvaluate" standing in for a worker's slot, with a fixed draw value and uniform policy.
+class ExpandFixture
+{
+public:
+
+    static constexpr const int BatchSize = 1024;
+
+public:
+
+    ExpandFixture(std::vector<std::vector<Move>> positions)
+        : _positions(std::move(positions))
+        , _image(new INetwork::InputPlanes())
+        , _value(CHESSCOACH_VALUE_DRAW)
+        , _policy(new INetwork::OutputPlanes())
+        , _tablebaseCardinality(0)
+        , _next(0)
+    {
+        INetwork::PlanesPointerFlat policyFlat = reinterpret_cast<INetwork::PlanesPointerFlat>(_policy.get());
+        std::fill(policyFlat, policyFlat + INetwork::OutputPlanesFloatCount, 0.f);
+    }
+
+    ~ExpandFixture()
+    {
+        Clear();
+    }
+
+    // Set up the next batch of unexpanded search games, cycling through positions.
+    std::vector<SelfPlayGame>& NextBatch()
+    {
+        Clear();
+        _games.resize(BatchSize);
+        for (SelfPlayGame& game : _games)
+        {
+            game = SelfPlayGame(Game::StartingPosition, _positions[_next], true /* tryHard */,
+                _image.get(), &_value, _policy.get(), &_tablebaseCardinality);
+            _next = ((_next + 1) % _positions.size());
+        }
+        return _games;
+    }
+
+    // Expand and evaluate, standing in for the network if the prediction cache misses. Returns whether it missed.
+    bool ExpandAndEvaluate(SelfPlayGame& game, SearchState& searchState)
+    {
+        SelfPlayState state = SelfPlayState::Working;
+        PredictionCacheChunk* cacheStore = nullptr;
+        game.ExpandAndEvaluate(state, cacheStore, &searchState, nullptr /* metrics */, false /* isSearchRoot */, false /* generateUniformPredictions */);
+        if (state != SelfPlayState::WaitingForPrediction)
+        {
+            return false;
+        }
+        game.ExpandAndEvaluate(state, cacheStore, &searchState, nullptr /* metrics */, false /* isSearchRoot */, false /* generateUniformPredictions */);
+        return true;
+    }
+
+private:
+
+    void Clear()
+    {
+        for (SelfPlayGame& game : _games)
+        {
+            game.PruneAll();
+        }
+        _games.clear();
+    }
+
+private:
+
+    std::vector<std::vector<Move>> _positions;
+    std::unique_ptr<INetwork::InputPlanes> _image;
+    float _value;
+    std::unique_ptr<INetwork::OutputPlanes> _policy;
+    int _tablebaseCardinality;
+    std::vector<SelfPlayGame> _games;
+    size_t _next;
+};
+
+// Expand fixture positions already in the prediction cache: move generation, cache probe and child allocation.
+static void BM_ExpandAndEvaluateCacheHit(benchmark::State& state)
+{
+    ExpandFixture fixture(FixturePositions());
+    SearchState searchState{};
+    PredictionCache::Instance.Clear();
+    for (SelfPlayGame& game : fixture.NextBatch())
+    {
+        fixture.ExpandAndEvaluate(game, searchState);
+    }
+
+    std::vector<SelfPlayGame>* games = &fixture.NextBatch();
+    int index = 0;
+    int64_t missCount = 0;
+    for (auto _ : state)
+    {
+        if (index == games->size())
+        {
+            state.PauseTiming();
+            games = &fixture.NextBatch();
+            index = 0;
+            state.ResumeTiming();
+        }
+        missCount += fixture.ExpandAndEvaluate((*games)[index++], searchState);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["miss_rate"] = benchmark::Counter(static_cast<double>(missCount), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ExpandAndEvaluateCacheHit);
+
+// Expand distinct random positions: move generation, cache probe, image generation, softmax over
+// the stand-in policy, cache store and child allocation.
+static void BM_ExpandAndEvaluateCacheMiss(benchmark::State& state)
+{
+    // Clear the prediction cache whenever positions start repeating. Random walks still share
+    // early positions, so expect some hits: see the "miss_rate" counter.
+    const int positionCount = (1 << 16);
+    const int batchesPerClear = (positionCount / ExpandFixture::BatchSize);
+    ExpandFixture fixture(RandomWalkPositions(positionCount, 1));
+    SearchState searchState{};
+    PredictionCache::Instance.Clear();
+
+    std::vector<SelfPlayGame>* games = &fixture.NextBatch();
+    int index = 0;
+    int batchCount = 1;
+    int64_t missCount = 0;
+    for (auto _ : state)
+    {
+        if (index == games->size())
+        {
+            state.PauseTiming();
+            if ((batchCount++ % batchesPerClear) == 0)
+            {
+                PredictionCache::Instance.Clear();
+            }
+            games = &fixture.NextBatch();
+            index = 0;
+            state.ResumeTiming();
+        }
+        missCount += fixture.ExpandAndEvaluate((*games)[index++], searchState);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["miss_rate"] = benchmark::Counter(static_cast<double>(missCount), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ExpandAndEvaluateCacheMiss);
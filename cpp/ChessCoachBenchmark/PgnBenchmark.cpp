@@ -0,0 +1,39 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+
+#include <ChessCoach/Pgn.h>
+
+#include "BenchmarkFixtures.h"
+
+// Parse the fixture PGN into saved games, including SAN parsing and move legality checks; report per-game cost.
+static void BM_ParsePgn(benchmark::State& state)
+{
+    int64_t gameCount = 0;
+    for (auto _ : state)
+    {
+        std::stringstream content(FixturePgn());
+        Pgn::ParsePgn(content, false /* allowNoResult */, [&](SavedGame&& game, SavedCommentary&&)
+            {
+                benchmark::DoNotOptimize(game.moveCount);
+                gameCount++;
+            });
+    }
+    state.SetItemsProcessed(gameCount);
+}
+BENCHMARK(BM_ParsePgn);
@@ -0,0 +1,122 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <vector>
+
+#include <ChessCoach/Game.h>
+#include <ChessCoach/PoolAllocator.h>
+#include <ChessCoach/SharedPoolAllocator.h>
+
+// The block size of the thread-local StateInfo pool that "SharedPoolAllocator" replaced, for comparison.
+static const size_t StateBlockSizeBytes = (64 * 1024 * 1024);
+
+// Allocate then free a single StateInfo, as when applying and undoing one move.
+static void BM_PoolAllocatorSingle(benchmark::State& state)
+{
+    PoolAllocator<StateInfo, StateBlockSizeBytes> allocator;
+    for (auto _ : state)
+    {
+        void* allocation = allocator.Allocate();
+        benchmark::DoNotOptimize(allocation);
+        allocator.Free(allocation);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PoolAllocatorSingle);
+
+// Allocate a search path's worth of StateInfos, then free them, as when building and discarding a scratch game.
+static void BM_PoolAllocatorPath(benchmark::State& state)
+{
+    PoolAllocator<StateInfo, StateBlockSizeBytes> allocator;
+    std::vector<void*> allocations(state.range(0));
+    for (auto _ : state)
+    {
+        for (void*& allocation : allocations)
+        {
+            allocation = allocator.Allocate();
+        }
+        benchmark::DoNotOptimize(allocations.data());
+        for (void* allocation : allocations)
+        {
+            allocator.Free(allocation);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * allocations.size());
+}
+BENCHMARK(BM_PoolAllocatorPath)->Arg(64);
+
+static void BM_SharedPoolAllocatorSingle(benchmark::State& state)
+{
+    SharedPoolAllocator allocator("benchmark", sizeof(StateInfo), alignof(StateInfo));
+    for (auto _ : state)
+    {
+        void* allocation = allocator.Allocate();
+        benchmark::DoNotOptimize(allocation);
+        allocator.Free(allocation);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedPoolAllocatorSingle);
+
+static void BM_SharedPoolAllocatorPath(benchmark::State& state)
+{
+    SharedPoolAllocator allocator("benchmark", sizeof(StateInfo), alignof(StateInfo));
+    std::vector<void*> allocations(state.range(0));
+    for (auto _ : state)
+    {
+        for (void*& allocation : allocations)
+        {
+            allocation = allocator.Allocate();
+        }
+        benchmark::DoNotOptimize(allocations.data());
+        for (void* allocation : allocations)
+        {
+            allocator.Free(allocation);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * allocations.size());
+}
+BENCHMARK(BM_SharedPoolAllocatorPath)->Arg(64);
+
+// Allocate a path's worth on this thread and free them on another, as when a game is finalized elsewhere.
+static void BM_SharedPoolAllocatorCrossThread(benchmark::State& state)
+{
+    SharedPoolAllocator allocator("benchmark", sizeof(StateInfo), alignof(StateInfo));
+    std::vector<void*> allocations(state.range(0));
+    for (auto _ : state)
+    {
+        for (void*& allocation : allocations)
+        {
+            allocation = allocator.Allocate();
+        }
+        std::thread([&]()
+            {
+                for (void* allocation : allocations)
+                {
+                    allocator.Free(allocation);
+                }
+            }).join();
+    }
+
+    state.SetItemsProcessed(state.iterations() * allocations.size());
+}
+BENCHMARK(BM_SharedPoolAllocatorCrossThread)->Arg(4096);
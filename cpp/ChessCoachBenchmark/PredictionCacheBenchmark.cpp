@@ -0,0 +1,86 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include <ChessCoach/PredictionCache.h>
+#include <ChessCoach/Network.h>
+
+static std::vector<uint16_t> FixturePriors(int moveCount)
+{
+    return std::vector<uint16_t>(moveCount, INetwork::QuantizeProbabilityNoZero(1.f / moveCount));
+}
+
+// Probe keys never seen before, then store a prediction, as on a cache miss during search.
+static void BM_PredictionCacheMissPut(benchmark::State& state)
+{
+    const int moveCount = 30;
+    const std::vector<uint16_t> priors = FixturePriors(moveCount);
+    std::vector<uint16_t> priorsOut(moveCount);
+    std::mt19937_64 random(1);
+    PredictionCacheChunk* chunk;
+    float value;
+
+    PredictionCache::Instance.Clear();
+    for (auto _ : state)
+    {
+        const Key key = random();
+        if (!PredictionCache::Instance.TryGetPrediction(key, moveCount, &chunk, &value, priorsOut.data()))
+        {
+            chunk->Put(key, 0.5f, moveCount, priors.data());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PredictionCacheMissPut);
+
+// Probe keys already stored, spread across the cache, as on a cache hit during search.
+static void BM_PredictionCacheHit(benchmark::State& state)
+{
+    const int moveCount = 30;
+    const int keyCount = static_cast<int>(state.range(0));
+    const std::vector<uint16_t> priors = FixturePriors(moveCount);
+    std::vector<uint16_t> priorsOut(moveCount);
+    std::mt19937_64 random(2);
+    std::vector<Key> keys(keyCount);
+    PredictionCacheChunk* chunk;
+    float value;
+
+    PredictionCache::Instance.Clear();
+    for (Key& key : keys)
+    {
+        key = random();
+        if (!PredictionCache::Instance.TryGetPrediction(key, moveCount, &chunk, &value, priorsOut.data()))
+        {
+            chunk->Put(key, 0.5f, moveCount, priors.data());
+        }
+    }
+
+    int64_t hitCount = 0;
+    int index = 0;
+    for (auto _ : state)
+    {
+        hitCount += PredictionCache::Instance.TryGetPrediction(keys[index], moveCount, &chunk, &value, priorsOut.data());
+        index = ((index + 1) % keyCount);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hit_rate"] = benchmark::Counter(static_cast<double>(hitCount), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_PredictionCacheHit)->Arg(1 << 10)->Arg(1 << 20);
@@ -0,0 +1,72 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <ChessCoach/Storage.h>
+
+#include "BenchmarkFixtures.h"
+
+static std::filesystem::path BenchmarkChunkPath()
+{
+    return (std::filesystem::temp_directory_path() / "ChessCoachBenchmark.chunk");
+}
+
+// Write the fixture games as a compressed TFRecord chunk, as when chunking self-play games; report per-game cost.
+static void BM_SaveChunk(benchmark::State& state)
+{
+    const Storage storage;
+    const std::vector<SavedGame> games = FixtureGames();
+    const std::filesystem::path path = BenchmarkChunkPath();
+
+    for (auto _ : state)
+    {
+        storage.SaveChunk(path, games);
+    }
+
+    state.SetItemsProcessed(state.iterations() * games.size());
+    state.counters["chunk_bytes"] = static_cast<double>(std::filesystem::file_size(path));
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_SaveChunk);
+
+// Decompress and parse the last game from an in-memory chunk, as the GUI does for random access.
+static void BM_LoadGameFromChunk(benchmark::State& state)
+{
+    Storage storage;
+    const std::vector<SavedGame> games = FixtureGames();
+    const std::filesystem::path path = BenchmarkChunkPath();
+    storage.SaveChunk(path, games);
+
+    std::stringstream buffer;
+    buffer << std::ifstream(path, std::ios::binary).rdbuf();
+    const std::string chunkContents = buffer.str();
+    std::filesystem::remove(path);
+
+    SavedGame game;
+    const int gameIndex = (static_cast<int>(games.size()) - 1);
+    for (auto _ : state)
+    {
+        storage.LoadGameFromChunk(chunkContents, gameIndex, &game);
+        benchmark::DoNotOptimize(game.moveCount);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoadGameFromChunk);
@@ -0,0 +1,51 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include <ChessCoach/Syzygy.h>
+
+// Probe the shared WDL cache for a working set of endgame positions, as when many branches and threads
+// revisit the same positions after zeroing moves. The argument is the working set size.
+static void BM_SyzygyWdlCacheProbe(benchmark::State& state)
+{
+    SyzygyWdlCache cache;
+    cache.Allocate(16);
+
+    std::mt19937_64 random(1234);
+    std::vector<uint64_t> keys(state.range(0));
+    for (uint64_t& key : keys)
+    {
+        key = random();
+        cache.Store(key, static_cast<int>(key % 5) - 2);
+    }
+
+    int64_t hits = 0;
+    size_t index = 0;
+    for (auto _ : state)
+    {
+        int wdl;
+        hits += cache.Probe(keys[index], wdl);
+        benchmark::DoNotOptimize(wdl);
+        index = ((index + 1) % keys.size());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hit_rate"] = (static_cast<double>(hits) / state.iterations());
+}
+BENCHMARK(BM_SyzygyWdlCacheProbe)->Arg(1024)->Arg(1 << 20);
@@ -0,0 +1,65 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <vector>
+
+#include <ChessCoach/Threading.h>
+
+// Start then stop a round of work across sleeping workers, as with UCI "go" and "stop": waking every
+// worker, then waiting for them all to go idle again. Workers sleep while working, as slowstart threads do.
+static void BM_WorkCoordinatorStartStop(benchmark::State& state)
+{
+    const int workerCount = static_cast<int>(state.range(0));
+    WorkCoordinator workCoordinator(workerCount);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back([&workCoordinator, i]()
+            {
+                while (workCoordinator.WaitForWorkItems(i))
+                {
+                    while (!workCoordinator.AllWorkItemsCompleted())
+                    {
+                        workCoordinator.WaitForWake(i, 1000);
+                    }
+                }
+            });
+    }
+    workCoordinator.WaitForWorkers();
+
+    for (auto _ : state)
+    {
+        workCoordinator.ResetWorkItemsRemaining(1);
+        for (int i = 0; i < workerCount; i++)
+        {
+            while (workCoordinator.State(i) != WorkerState_Working)
+            {
+                std::this_thread::yield();
+            }
+        }
+        workCoordinator.ResetWorkItemsRemaining(0);
+        workCoordinator.WaitForWorkers();
+    }
+
+    workCoordinator.ShutDown();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+BENCHMARK(BM_WorkCoordinatorStartStop)->Arg(1)->Arg(8)->UseRealTime();
@@ -0,0 +1,197 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tclap/CmdLine.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/Config.h>
+#include <ChessCoach/Platform.h>
+#include <ChessCoach/PredictionCacheSimulator.h>
+
+// Replays prediction cache probes captured via "cachetrace start" or the "trace_probes" config key
+// against alternative cache geometries and replacement policies, printing CSV results.
+class ChessCoachCacheSimulator : public ChessCoach
+{
+public:
+
+    ChessCoachCacheSimulator(const std::string& tracePath, const std::string& sizes, const std::string& ways,
+        const std::string& policies, const std::string& maxSlots);
+
+    void Initialize();
+    void Finalize();
+
+    void SimulateGeometries();
+
+private:
+
+    static std::vector<int> ParseInts(const std::string& list);
+
+private:
+
+    std::string _tracePath;
+    std::string _sizes;
+    std::string _ways;
+    std::string _policies;
+    std::string _maxSlots;
+};
+
+int main(int argc, char* argv[])
+{
+    std::string tracePath;
+    std::string sizes;
+    std::string ways;
+    std::string policies;
+    std::string maxSlots;
+
+    try
+    {
+        TCLAP::CmdLine cmd("ChessCoachCacheSimulator: Replays captured prediction cache probes against alternative geometries", ' ', "0.9");
+
+        TCLAP::ValueArg<std::string> traceArg("t", "trace", "Probe trace file from \"cachetrace\" or \"trace_probes\"", true /* req */, "", "path");
+        TCLAP::ValueArg<std::string> sizesArg("s", "sizes", "Comma-separated cache sizes in MiB (default from config)", false /* req */, "", "list");
+        TCLAP::ValueArg<std::string> waysArg("w", "ways", "Comma-separated slots per set", false /* req */, "8", "list");
+        TCLAP::ValueArg<std::string> policiesArg("p", "policies", "Comma-separated replacement policies: lru, clock, lfu", false /* req */, "lru,clock,lfu", "list");
+        TCLAP::ValueArg<std::string> maxSlotsArg("x", "maxslots", "Comma-separated max 128-byte slots per entry (1 matches the live cache)", false /* req */, "1,4", "list");
+
+        // Usage/help seems to reverse this order.
+        cmd.add(maxSlotsArg);
+        cmd.add(policiesArg);
+        cmd.add(waysArg);
+        cmd.add(sizesArg);
+        cmd.add(traceArg);
+
+        cmd.parse(argc, argv);
+
+        tracePath = traceArg.getValue();
+        sizes = sizesArg.getValue();
+        ways = waysArg.getValue();
+        policies = policiesArg.getValue();
+        maxSlots = maxSlotsArg.getValue();
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << " for argument " << e.argId() << std::endl;
+        return 1;
+    }
+
+    ChessCoachCacheSimulator cacheSimulator(tracePath, sizes, ways, policies, maxSlots);
+
+    cacheSimulator.PrintExceptions();
+    cacheSimulator.Initialize();
+
+    cacheSimulator.SimulateGeometries();
+
+    cacheSimulator.Finalize();
+
+    return 0;
+}
+
+ChessCoachCacheSimulator::ChessCoachCacheSimulator(const std::string& tracePath, const std::string& sizes, const std::string& ways,
+    const std::string& policies, const std::string& maxSlots)
+    : _tracePath(tracePath)
+    , _sizes(sizes)
+    , _ways(ways)
+    , _policies(policies)
+    , _maxSlots(maxSlots)
+{
+}
+
+void ChessCoachCacheSimulator::Initialize()
+{
+    // Only config is needed: no Python, network or prediction cache allocation.
+    InitializeStockfish();
+    InitializeChessCoach();
+}
+
+void ChessCoachCacheSimulator::Finalize()
+{
+    FinalizeStockfish();
+}
+
+std::vector<int> ChessCoachCacheSimulator::ParseInts(const std::string& list)
+{
+    std::vector<int> values;
+    std::stringstream tokens(list);
+    std::string token;
+    while (std::getline(tokens, token, ','))
+    {
+        values.push_back(std::stoi(token));
+    }
+    return values;
+}
+
+void ChessCoachCacheSimulator::SimulateGeometries()
+{
+    const std::vector<PredictionCacheProbe> probes = PredictionCacheTrace::Load(_tracePath);
+
+    int64_t liveHitCount = 0;
+    int64_t oversizeCount = 0;
+    for (const PredictionCacheProbe& probe : probes)
+    {
+        liveHitCount += probe.hit;
+        oversizeCount += (probe.moveCount > PredictionCacheSimulator::FirstSlotMoveCount);
+    }
+    const auto share = [&](int64_t count) { return (probes.empty() ? 0.0 : (static_cast<double>(count) / probes.size())); };
+    std::cout << std::fixed << std::setprecision(4) << "Probes: " << probes.size() << ", live hit rate: " << share(liveHitCount)
+        << ", oversize share: " << share(oversizeCount) << std::endl;
+
+    const std::vector<int> sizes = (_sizes.empty() ? std::vector<int>{ Config::Misc.PredictionCache_SizeMebibytes } : ParseInts(_sizes));
+    const std::vector<int> ways = ParseInts(_ways);
+    const std::vector<int> maxSlots = ParseInts(_maxSlots);
+    std::vector<CacheReplacement> policies;
+    std::stringstream policyTokens(_policies);
+    std::string policyToken;
+    while (std::getline(policyTokens, policyToken, ','))
+    {
+        bool found = false;
+        for (int i = 0; i < CacheReplacement_Count; i++)
+        {
+            if (policyToken == CacheReplacementKeys[i])
+            {
+                policies.push_back(static_cast<CacheReplacement>(i));
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            throw ChessCoachException("Unknown replacement policy: " + policyToken);
+        }
+    }
+
+    std::cout << "size_mib,ways,policy,max_slots,probes,hit_rate,oversize_probes,oversize_hits,evictions" << std::endl;
+    for (const int size : sizes)
+    {
+        for (const int way : ways)
+        {
+            for (const CacheReplacement policy : policies)
+            {
+                for (const int slots : maxSlots)
+                {
+                    const CacheSimulationResult result = PredictionCacheSimulator::Simulate({ size, way, slots, policy }, probes);
+                    std::cout << size << "," << way << "," << CacheReplacementKeys[policy] << "," << slots << ","
+                        << result.probeCount << "," << result.HitRate() << "," << result.oversizeProbeCount << ","
+                        << result.oversizeHitCount << "," << result.evictionCount << std::endl;
+                }
+            }
+        }
+    }
+}
@@ -19,6 +19,7 @@
 #include <tclap/CmdLine.h>
 
 #include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/PerformanceBaseline.h>
 #include <ChessCoach/WorkerGroup.h>
 
 class ChessCoachStrengthTest : public ChessCoach
@@ -26,11 +27,17 @@ class ChessCoachStrengthTest : public ChessCoach
 public:
 
     ChessCoachStrengthTest(const std::filesystem::path& epdPath,
-        int moveTimeMs, int nodes, int failureNodes, int positionLimit, float slopeArg, float interceptArg);
+        int moveTimeMs, int nodes, int failureNodes, int positionLimit, float slopeArg, float interceptArg,
+        const std::filesystem::path& baselinePath, const std::filesystem::path& writeBaselinePath, float tolerance, float zScore);
 
     void Initialize();
 
-    void StrengthTest();
+    // Returns false if search speed regressed against the baseline.
+    bool StrengthTest();
+
+private:
+
+    bool CompareBaseline(const std::vector<StrengthTestPerformance>& performances);
 
 private:
 
@@ -41,6 +48,10 @@ private:
     int _positionLimit;
     float _slope;
     float _intercept;
+    std::filesystem::path _baselinePath;
+    std::filesystem::path _writeBaselinePath;
+    float _tolerance;
+    float _zScore;
 };
 
 int main(int argc, char* argv[])
@@ -52,6 +63,10 @@ int main(int argc, char* argv[])
     int positionLimit;
     float slope;
     float intercept;
+    std::string baselinePath;
+    std::string writeBaselinePath;
+    float tolerance;
+    float zScore;
 
     try
     {
@@ -64,8 +79,16 @@ int main(int argc, char* argv[])
         TCLAP::ValueArg<int> positionLimitArg("l", "limit", "Number of positions in the EPD to run", false /* req */, 0, "whole number");
         TCLAP::ValueArg<float> slopeArg("s", "slope", "Slope for linear rating calculation based on score", false /* req */, 0.f, "decimal");
         TCLAP::ValueArg<float> interceptArg("i", "intercept", "Intercept for linear rating calculation based on score", false /* req */, 0.f, "decimal");
+        TCLAP::ValueArg<std::string> baselineArg("b", "baseline", "Path to a performance baseline to compare search speed against", false /* req */, "", "string");
+        TCLAP::ValueArg<std::string> writeBaselineArg("w", "write-baseline", "Path to write search speed to as a new performance baseline", false /* req */, "", "string");
+        TCLAP::ValueArg<float> toleranceArg("r", "tolerance", "Slowdown fraction tolerated before failing against the baseline", false /* req */, 0.05f, "decimal");
+        TCLAP::ValueArg<float> zScoreArg("z", "zscore", "Standard errors required for a slowdown to be significant", false /* req */, 1.96f, "decimal");
 
         // Usage/help seems to reverse this order.
+        cmd.add(zScoreArg);
+        cmd.add(toleranceArg);
+        cmd.add(writeBaselineArg);
+        cmd.add(baselineArg);
         cmd.add(interceptArg);
         cmd.add(slopeArg);
         cmd.add(positionLimitArg);
@@ -83,6 +106,10 @@ int main(int argc, char* argv[])
         positionLimit = positionLimitArg.getValue();
         slope = slopeArg.getValue();
         intercept = interceptArg.getValue();
+        baselinePath = baselineArg.getValue();
+        writeBaselinePath = writeBaselineArg.getValue();
+        tolerance = toleranceArg.getValue();
+        zScore = zScoreArg.getValue();
     }
     catch (TCLAP::ArgException& e)
     {
@@ -90,20 +117,22 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    ChessCoachStrengthTest strengthTest(epdPath, moveTimeMs, nodes, failureNodes, positionLimit, slope, intercept);
+    ChessCoachStrengthTest strengthTest(epdPath, moveTimeMs, nodes, failureNodes, positionLimit, slope, intercept,
+        baselinePath, writeBaselinePath, tolerance, zScore);
 
     strengthTest.PrintExceptions();
     strengthTest.Initialize();
 
-    strengthTest.StrengthTest();
+    const bool passed = strengthTest.StrengthTest();
 
     strengthTest.Finalize();
 
-    return 0;
+    return (passed ? 0 : 2);
 }
 
 ChessCoachStrengthTest::ChessCoachStrengthTest(const std::filesystem::path& epdPath,
-    int moveTimeMs, int nodes, int failureNodes, int positionLimit, float slope, float intercept)
+    int moveTimeMs, int nodes, int failureNodes, int positionLimit, float slope, float intercept,
+    const std::filesystem::path& baselinePath, const std::filesystem::path& writeBaselinePath, float tolerance, float zScore)
     : _epdPath(epdPath)
     , _moveTimeMs(moveTimeMs)
     , _nodes(nodes)
@@ -111,6 +140,10 @@ ChessCoachStrengthTest::ChessCoachStrengthTest(const std::filesystem::path& epdP
     , _positionLimit(positionLimit)
     , _slope(slope)
     , _intercept(intercept)
+    , _baselinePath(baselinePath)
+    , _writeBaselinePath(writeBaselinePath)
+    , _tolerance(tolerance)
+    , _zScore(zScore)
 {
 }
 
@@ -131,7 +164,7 @@ static void PrintProgress(const std::string& fen, const std::string& target, con
     std::cout << fen << ", " << target << ", " << chosen << ", " << score << ", " << total << ", " << nodeScore << std::endl;
 }
 
-void ChessCoachStrengthTest::StrengthTest()
+bool ChessCoachStrengthTest::StrengthTest()
 {
     std::cout << "Preparing network..." << std::endl;
 
@@ -144,8 +177,9 @@ void ChessCoachStrengthTest::StrengthTest()
 
     const auto start = std::chrono::high_resolution_clock::now();
 
+    std::vector<StrengthTestPerformance> performances;
     const auto [score, total, positions, totalNodesRequired] = workerGroup.controllerWorker->StrengthTestEpd(workerGroup.workCoordinator.get(), _epdPath,
-        _moveTimeMs, _nodes, _failureNodes, _positionLimit, PrintProgress);
+        _moveTimeMs, _nodes, _failureNodes, _positionLimit, PrintProgress, &performances);
 
     const float secondsTaken = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
 
@@ -161,4 +195,39 @@ void ChessCoachStrengthTest::StrengthTest()
     }
 
     workerGroup.ShutDown();
+
+    if (!_writeBaselinePath.empty())
+    {
+        PerformanceBaseline::Save(_writeBaselinePath, performances);
+        std::cout << "Wrote performance baseline to " << _writeBaselinePath.string() << std::endl;
+    }
+
+    return (_baselinePath.empty() || CompareBaseline(performances));
+}
+
+bool ChessCoachStrengthTest::CompareBaseline(const std::vector<StrengthTestPerformance>& performances)
+{
+    const std::vector<StrengthTestPerformance> baseline = PerformanceBaseline::Load(_baselinePath);
+    const PerformanceComparison comparison = PerformanceBaseline::Compare(baseline, performances, _tolerance, _zScore);
+
+    // Ratios are current / baseline with confidence intervals, as geometric means across paired positions.
+    const auto printRatio = [](const char* name, const PerformanceRatio& ratio)
+    {
+        std::cout << name << ": " << ratio.geometricMeanRatio << "x [" << ratio.lowerRatio << ", " << ratio.upperRatio << "] over "
+            << ratio.pairedCount << " positions" << std::endl;
+    };
+    std::cout << "\nCompared against performance baseline " << _baselinePath.string() << std::endl;
+    printRatio("Nodes/second", comparison.nodesPerSecond);
+    printRatio("Nodes to solution", comparison.nodesToSolution);
+    printRatio("Time to solution", comparison.secondsToSolution);
+    std::cout << "Solved: " << comparison.currentSolvedCount << " (baseline " << comparison.baselineSolvedCount << ", "
+        << comparison.newlyUnsolvedCount << " no longer solved)" << std::endl;
+
+    if (comparison.regressed)
+    {
+        std::cout << "Performance regressed: slowdown beyond " << (_tolerance * 100.f) << "% tolerance" << std::endl;
+        return false;
+    }
+    std::cout << "Performance within tolerance" << std::endl;
+    return true;
 }
\ No newline at end of file
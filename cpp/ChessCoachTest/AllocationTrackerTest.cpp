@@ -0,0 +1,86 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/AllocationTracker.h>
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/Game.h>
+
+TEST(AllocationTracker, CountsPerTagAndThread)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    const bool enabledBackup = AllocationTracker::Enabled();
+
+    // Nothing is recorded while disabled.
+    AllocationTracker::SetEnabled(false);
+    const AllocationSnapshot start = AllocationTracker::Take();
+    AllocationTracker::Allocate(AllocationTag_Node, 100);
+    EXPECT_EQ(AllocationTracker::Take().tags[AllocationTag_Node].allocationCount, start.tags[AllocationTag_Node].allocationCount);
+
+    // Allocate twice and free once on a fresh thread.
+    AllocationTracker::SetEnabled(true);
+    std::thread thread([]()
+        {
+            AllocationTracker::Allocate(AllocationTag_Node, 100);
+            AllocationTracker::Allocate(AllocationTag_Node, 100);
+            AllocationTracker::Free(AllocationTag_Node, 100);
+            AllocationTracker::Allocate(AllocationTag_Storage, 50, 5);
+        });
+    thread.join();
+
+    // Copying a game copies its moves.
+    const Game game(Game::StartingPosition, { make_move(SQ_E2, SQ_E4), make_move(SQ_E7, SQ_E5) });
+    const AllocationSnapshot beforeCopy = AllocationTracker::Take();
+    {
+        const Game copy(game);
+    }
+    const AllocationSnapshot afterCopy = AllocationTracker::Take();
+    AllocationTracker::SetEnabled(enabledBackup);
+
+    const AllocationCounts node = beforeCopy.tags[AllocationTag_Node].Since(start.tags[AllocationTag_Node]);
+    EXPECT_EQ(node.allocationCount, 2);
+    EXPECT_EQ(node.allocatedBytes, 200);
+    EXPECT_EQ(node.freeCount, 1);
+    EXPECT_EQ(node.freedBytes, 100);
+    EXPECT_EQ(beforeCopy.liveBytes[AllocationTag_Node] - start.liveBytes[AllocationTag_Node], 100);
+    EXPECT_GE(beforeCopy.peakLiveBytes[AllocationTag_Node], start.liveBytes[AllocationTag_Node] + 200);
+
+    const AllocationCounts storage = beforeCopy.tags[AllocationTag_Storage].Since(start.tags[AllocationTag_Storage]);
+    EXPECT_EQ(storage.allocationCount, 5);
+    EXPECT_EQ(storage.allocatedBytes, 50);
+
+    const AllocationCounts moves = afterCopy.tags[AllocationTag_GameMoves].Since(beforeCopy.tags[AllocationTag_GameMoves]);
+    EXPECT_EQ(moves.allocationCount, 1);
+    EXPECT_EQ(moves.freeCount, 1);
+    EXPECT_EQ(moves.allocatedBytes, moves.freedBytes);
+
+    // The thread shows up in the description, along with the tags used.
+    const std::vector<std::string> lines = AllocationTracker::Describe(beforeCopy, start);
+    bool foundNode = false;
+    bool foundThread = false;
+    for (const std::string& line : lines)
+    {
+        foundNode |= (line.rfind("allocations node count 2", 0) == 0);
+        foundThread |= (line.rfind("allocations thread ", 0) == 0);
+    }
+    EXPECT_TRUE(foundNode);
+    EXPECT_TRUE(foundThread);
+}
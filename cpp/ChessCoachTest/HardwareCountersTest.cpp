@@ -0,0 +1,75 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/HardwareCounters.h>
+
+TEST(HardwareCounters, ScopesRecordOrFallBack)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    const bool enabledBackup = HardwareCounters::Enabled();
+    const HardwareCounterSnapshot start = HardwareCounters::Take();
+
+    // Nothing is recorded while disabled.
+    HardwareCounters::SetEnabled(false);
+    {
+        const HardwareCounterScope counters(CounterPhase_Selection);
+    }
+    EXPECT_EQ(HardwareCounters::Take().phases[CounterPhase_Selection].scopeCount, start.phases[CounterPhase_Selection].scopeCount);
+
+    // Count some busy work on a fresh thread.
+    HardwareCounters::SetEnabled(true);
+    std::thread thread([]()
+        {
+            volatile int64_t sum = 0;
+            for (int i = 0; i < 3; i++)
+            {
+                const HardwareCounterScope counters(CounterPhase_Backpropagation);
+                for (int j = 0; j < 100000; j++)
+                {
+                    sum = (sum + j);
+                }
+            }
+        });
+    thread.join();
+    HardwareCounters::SetEnabled(enabledBackup);
+
+    // Counters may be unavailable in this environment (e.g. "perf_event_paranoid" or a virtual machine),
+    // in which case scopes record nothing and the description says why.
+    const HardwareCounterSnapshot end = HardwareCounters::Take();
+    const CounterPhaseCounts counts = end.phases[CounterPhase_Backpropagation].Since(start.phases[CounterPhase_Backpropagation]);
+    const std::vector<std::string> lines = HardwareCounters::Describe(end, start);
+    ASSERT_FALSE(lines.empty());
+    if (counts.scopeCount == 0)
+    {
+        EXPECT_EQ(lines[0].rfind("counters unavailable: ", 0), 0);
+    }
+    else
+    {
+        EXPECT_EQ(counts.scopeCount, 3);
+        EXPECT_EQ(lines[0].rfind("counters backpropagation scopes 3", 0), 0);
+        if (end.supported[HardwareCounter_Instructions])
+        {
+            EXPECT_GT(counts.values[HardwareCounter_Instructions], 100000);
+        }
+    }
+}
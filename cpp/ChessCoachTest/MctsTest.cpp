@@ -17,9 +17,11 @@
 #include <gtest/gtest.h>
 
 #include <functional>
+#include <cmath>
 
 #include <ChessCoach/SelfPlay.h>
 #include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/TreeStatistics.h>
 
 SelfPlayGame& PlayGame(SelfPlayWorker& selfPlayWorker, std::function<void (SelfPlayGame&)> tickCallback)
 {
@@ -150,23 +152,17 @@ TEST(Mcts, StateLeaks)
     SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
     selfPlayWorker.Initialize();
 
-    // Allocations are only tracked with DEBUG.
-#ifdef _DEBUG
     auto [currentBefore, peakBefore] = Game::StateAllocator.DebugAllocations();
-#endif
 
     PlayGame(selfPlayWorker, [](auto&) {});
 
     // Clear the scratch game.
     selfPlayWorker.DebugResetGame(0);
 
-    // Allocations are only tracked with DEBUG.
-#ifdef _DEBUG
     auto [currentAfter, peakAfter] = Game::StateAllocator.DebugAllocations();
     EXPECT_EQ(currentAfter, currentBefore);
     EXPECT_GT(peakAfter, 0);
     EXPECT_GE(peakAfter, peakBefore);
-#endif
 }
 
 TEST(Mcts, PrincipalVariation)
@@ -362,7 +358,7 @@ TEST(Mcts, TwofoldRepetition)
 
         SelfPlayState state = SelfPlayState::Working;
         PredictionCacheChunk* cacheStore = nullptr;
-        const float value = searchRoot.ExpandAndEvaluate(state, cacheStore, &searchState, true /* isSearchRoot */, false /* generateUniformPredictions */);
+        const float value = searchRoot.ExpandAndEvaluate(state, cacheStore, &searchState, nullptr /* metrics */, true /* isSearchRoot */, false /* generateUniformPredictions */);
         EXPECT_EQ(value, CHESSCOACH_VALUE_DRAW);
     }
 
@@ -384,7 +380,7 @@ TEST(Mcts, TwofoldRepetition)
 
         SelfPlayState state = SelfPlayState::Working;
         PredictionCacheChunk* cacheStore = nullptr;
-        const float value = searchRoot.ExpandAndEvaluate(state, cacheStore, &searchState, true /* isSearchRoot */, false /* generateUniformPredictions */);
+        const float value = searchRoot.ExpandAndEvaluate(state, cacheStore, &searchState, nullptr /* metrics */, true /* isSearchRoot */, false /* generateUniformPredictions */);
         EXPECT_NE(value, CHESSCOACH_VALUE_DRAW);
         EXPECT_TRUE(std::isnan(value)); // A non-terminal position requires a network evaluation.
     }
@@ -392,6 +388,74 @@ TEST(Mcts, TwofoldRepetition)
     game->PruneAll();
 }
 
+TEST(Mcts, TreeStatistics)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+    SelfPlayGame* game;
+    selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now());
+    selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+
+    // Set up a line ending in a 2-repetition, with an unvisited sibling at the root.
+    std::vector<Move> moves{ make_move(SQ_E2, SQ_E4), make_move(SQ_D7, SQ_D6),
+        make_move(SQ_D1, SQ_G4), make_move(SQ_G8, SQ_F6),
+        make_move(SQ_G4, SQ_D1), make_move(SQ_F6, SQ_G8),
+        make_move(SQ_D1, SQ_G4) };
+    std::vector<Node*> nodes{ game->Root() };
+    for (int i = 0; i < moves.size(); i++)
+    {
+        Node* node = nodes.back();
+        node->childCount = ((i == 0) ? 2 : 1);
+        node->children = new Node[node->childCount]{};
+        node->children[0].move = static_cast<uint16_t>(moves[i]);
+        node->expansion = Expansion::Expanded;
+        nodes.push_back(&node->children[0]);
+    }
+    game->Root()->children[1].move = static_cast<uint16_t>(make_move(SQ_D2, SQ_D4));
+
+    // Visits decrease down the line; the depth-6 node was expanded but never revisited.
+    for (int depth = 0; depth < nodes.size(); depth++)
+    {
+        nodes[depth]->visitCount = std::max(1, 7 - depth);
+    }
+
+    const TreeStatistics treeStatistics = TreeStatistics::Collect(game->GetPosition(), game->Root(), 2 /* threadCount */);
+    EXPECT_EQ(treeStatistics.NodeCount(), 8);
+    EXPECT_EQ(treeStatistics.MaxDepth(), 7);
+    EXPECT_EQ(treeStatistics.depths[0].childCount, 2);
+    EXPECT_EQ(treeStatistics.depths[0].visitedChildCount, 1);
+    EXPECT_EQ(treeStatistics.depths[0].visitCount, 7);
+    EXPECT_EQ(treeStatistics.depths[5].wastedExpansionCount, 0);
+    EXPECT_EQ(treeStatistics.depths[6].wastedExpansionCount, 1);
+    EXPECT_EQ(treeStatistics.depths[6].expandedCount, 1);
+    EXPECT_EQ(treeStatistics.depths[7].expandedCount, 0);
+    EXPECT_EQ(treeStatistics.depths[7].repetitionCount, 1);
+
+    // The repetition doesn't count once its earlier occurrence is before the search root.
+    {
+        SelfPlayGame searchRoot = *game;
+        for (int i = 0; i < 6; i++)
+        {
+            searchRoot.ApplyMoveWithRoot(moves[i], nodes[i + 1]);
+        }
+        const TreeStatistics subtreeStatistics = TreeStatistics::Collect(searchRoot.GetPosition(), searchRoot.Root(), 2 /* threadCount */);
+        EXPECT_EQ(subtreeStatistics.NodeCount(), 2);
+        EXPECT_EQ(subtreeStatistics.depths[1].repetitionCount, 0);
+    }
+
+    // CSV has one row per depth after the header.
+    std::stringstream csv;
+    TreeStatistics::WriteCsvHeader(csv);
+    treeStatistics.WriteCsv(csv, 1 /* searchId */);
+    EXPECT_EQ(std::count(std::istreambuf_iterator<char>(csv), std::istreambuf_iterator<char>(), '\n'), 9);
+
+    game->PruneAll();
+}
+
 TEST(Mcts, SamplingSelfPlay)
 {
     ChessCoach chessCoach;
@@ -497,6 +561,10 @@ TEST(Mcts, PrepareExpandedRoot)
     ChessCoach chessCoach;
     chessCoach.Initialize();
 
+    // Fast searches (playout cap randomization) skip exploration noise, so always search fully here.
+    const float fullSimulationProportionBackup = Config::Network.SelfPlay.FullSimulationProportion;
+    Config::Network.SelfPlay.FullSimulationProportion = 1.f;
+
     SearchState searchState{};
     SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
     selfPlayWorker.Initialize();
@@ -564,4 +632,370 @@ TEST(Mcts, PrepareExpandedRoot)
     EXPECT_TRUE(coverageA);
     EXPECT_TRUE(coverageB);
     EXPECT_TRUE(coverageC);
+
+    // Restore full simulation proportion.
+    Config::Network.SelfPlay.FullSimulationProportion = fullSimulationProportionBackup;
+}
+
+TEST(Mcts, PlayoutCapRandomization)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    // Mix full and fast searches, and keep the game short.
+    const float fullSimulationProportionBackup = Config::Network.SelfPlay.FullSimulationProportion;
+    const int maxMovesBackup = Config::Network.SelfPlay.MaxMoves;
+    Config::Network.SelfPlay.FullSimulationProportion = 0.5f;
+    Config::Network.SelfPlay.MaxMoves = 40;
+    ASSERT_NE(Config::Network.SelfPlay.NumSimulations, Config::Network.SelfPlay.NumSimulationsFast);
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+
+    // Track the simulation limit that each ply's search actually used, while it's waiting on predictions.
+    std::vector<int> simulationLimits(Config::Network.SelfPlay.MaxMoves, 0);
+    SelfPlayGame& game = PlayGame(selfPlayWorker, [&](SelfPlayGame& tickGame)
+        {
+            simulationLimits[tickGame.Ply()] = selfPlayWorker.DebugSimulationLimit(0);
+        });
+
+    // Each recorded policy must come from a full search, and each fast search must only provide a value target.
+    const SavedGame saved = game.Save();
+    bool coverageFull = false;
+    bool coverageFast = false;
+    for (int i = 0; i < saved.moveCount; i++)
+    {
+        if (simulationLimits[i] == Config::Network.SelfPlay.NumSimulations)
+        {
+            EXPECT_EQ(saved.policyRecorded[i], 1);
+            coverageFull = true;
+        }
+        else if (simulationLimits[i] == Config::Network.SelfPlay.NumSimulationsFast)
+        {
+            EXPECT_EQ(saved.policyRecorded[i], 0);
+            coverageFast = true;
+        }
+    }
+    EXPECT_TRUE(coverageFull);
+    EXPECT_TRUE(coverageFast);
+
+    // Restore full simulation proportion and max moves.
+    Config::Network.SelfPlay.FullSimulationProportion = fullSimulationProportionBackup;
+    Config::Network.SelfPlay.MaxMoves = maxMovesBackup;
+}
+
+TEST(Mcts, AdaptiveBudget)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+    SelfPlayGame* game;
+    selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now());
+    selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+
+    MockExpand(game->Root(), 3);
+    auto setVisits = [&](int first, int second, int third)
+    {
+        game->Root()->children[0].visitCount = first;
+        game->Root()->children[1].visitCount = second;
+        game->Root()->children[2].visitCount = third;
+    };
+
+    // The first check has nothing to compare against. An unchanged distribution doesn't diverge,
+    // and a changed distribution matches the add-one smoothed KL divergence.
+    std::vector<float> visitSnapshot;
+    setVisits(60, 30, 10);
+    EXPECT_TRUE(std::isinf(selfPlayWorker.CalculateVisitDivergence(game->Root(), visitSnapshot)));
+    EXPECT_NEAR(selfPlayWorker.CalculateVisitDivergence(game->Root(), visitSnapshot), 0.f, 1e-6f);
+    setVisits(10, 30, 60);
+    const float expectedDivergence = ((11.f / 103.f) * std::log(11.f / 61.f)) + ((61.f / 103.f) * std::log(61.f / 11.f));
+    EXPECT_NEAR(selfPlayWorker.CalculateVisitDivergence(game->Root(), visitSnapshot), expectedDivergence, 1e-5f);
+
+    const float thresholdBackup = Config::Network.SelfPlay.AdaptiveDivergenceThreshold;
+    const int minimumBackup = Config::Network.SelfPlay.AdaptiveMinimumSimulations;
+    const int intervalBackup = Config::Network.SelfPlay.AdaptiveCheckInterval;
+    const int maximumBackup = Config::Network.SelfPlay.AdaptiveMaximumSimulations;
+    const bool reassignBackup = Config::Network.SelfPlay.AdaptiveReassignSaved;
+    Config::Network.SelfPlay.AdaptiveDivergenceThreshold = 0.01f;
+    Config::Network.SelfPlay.AdaptiveMinimumSimulations = 200;
+    Config::Network.SelfPlay.AdaptiveCheckInterval = 100;
+    Config::Network.SelfPlay.AdaptiveMaximumSimulations = 1000;
+    Config::Network.SelfPlay.AdaptiveReassignSaved = true;
+
+    // Keep searching below the minimum, even when converged, then stop early and bank the rest of the limit.
+    AdaptiveBudgetState& adaptiveBudget = game->AdaptiveBudget();
+    adaptiveBudget = {};
+    int simulationLimit = 800;
+    setVisits(60, 30, 10);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 100, simulationLimit);
+    EXPECT_EQ(simulationLimit, 800);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 100, simulationLimit);
+    EXPECT_EQ(simulationLimit, 800);
+    EXPECT_EQ(adaptiveBudget.simulationBank, 0);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 300, simulationLimit);
+    EXPECT_EQ(simulationLimit, 300);
+    EXPECT_EQ(adaptiveBudget.simulationBank, 500);
+
+    // On a later move, don't extend before reaching the limit, then reassign banked simulations
+    // one check interval at a time, up to the maximum.
+    adaptiveBudget.visitSnapshot.clear();
+    simulationLimit = 800;
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 700, simulationLimit);
+    EXPECT_EQ(simulationLimit, 800);
+    setVisits(10, 30, 60);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 800, simulationLimit);
+    EXPECT_EQ(simulationLimit, 900);
+    EXPECT_EQ(adaptiveBudget.simulationBank, 400);
+    setVisits(60, 30, 10);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 900, simulationLimit);
+    EXPECT_EQ(simulationLimit, 1000);
+    EXPECT_EQ(adaptiveBudget.simulationBank, 300);
+    setVisits(10, 30, 60);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 1000, simulationLimit);
+    EXPECT_EQ(simulationLimit, 1000);
+    EXPECT_EQ(adaptiveBudget.simulationBank, 300);
+
+    // Nothing to reassign with an empty bank.
+    adaptiveBudget.simulationBank = 0;
+    simulationLimit = 800;
+    setVisits(60, 30, 10);
+    selfPlayWorker.UpdateAdaptiveBudget(*game, 800, simulationLimit);
+    EXPECT_EQ(simulationLimit, 800);
+    EXPECT_EQ(adaptiveBudget.simulationBank, 0);
+
+    // Restore adaptive simulation config.
+    Config::Network.SelfPlay.AdaptiveDivergenceThreshold = thresholdBackup;
+    Config::Network.SelfPlay.AdaptiveMinimumSimulations = minimumBackup;
+    Config::Network.SelfPlay.AdaptiveCheckInterval = intervalBackup;
+    Config::Network.SelfPlay.AdaptiveMaximumSimulations = maximumBackup;
+    Config::Network.SelfPlay.AdaptiveReassignSaved = reassignBackup;
+
+    game->PruneAll();
+}
+
+TEST(Mcts, Adjudication)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+    SelfPlayGame* game;
+
+    const float thresholdBackup = Config::Network.SelfPlay.ResignValueThreshold;
+    const int consecutivePliesBackup = Config::Network.SelfPlay.ResignConsecutivePlies;
+    const bool tablebasesBackup = Config::Network.SelfPlay.AdjudicateTablebases;
+    const float verificationBackup = Config::Network.SelfPlay.AdjudicationVerificationProportion;
+    Config::Network.SelfPlay.ResignValueThreshold = 0.05f;
+    Config::Network.SelfPlay.ResignConsecutivePlies = 3;
+    Config::Network.SelfPlay.AdjudicateTablebases = false;
+    Config::Network.SelfPlay.AdjudicationVerificationProportion = 0.f;
+
+    // Each side resigns after enough consecutive lost plies (values are from white's perspective).
+    const std::pair<float, float> resignations[] = { { CHESSCOACH_VALUE_LOSS, CHESSCOACH_VALUE_LOSS }, { CHESSCOACH_VALUE_WIN, CHESSCOACH_VALUE_WIN } };
+    for (const auto& [whiteValue, result] : resignations)
+    {
+        selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now());
+        selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+        EXPECT_FALSE(selfPlayWorker.Adjudicate(0, whiteValue));
+        EXPECT_FALSE(selfPlayWorker.Adjudicate(0, whiteValue));
+        EXPECT_TRUE(selfPlayWorker.Adjudicate(0, whiteValue));
+        EXPECT_EQ(selfPlayWorker.DebugAdjudication(0).type, AdjudicationType_Resignation);
+        EXPECT_EQ(game->Result(), result);
+    }
+
+    // Recovering resets the count.
+    selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now());
+    selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+    EXPECT_FALSE(selfPlayWorker.Adjudicate(0, 0.01f));
+    EXPECT_FALSE(selfPlayWorker.Adjudicate(0, 0.01f));
+    EXPECT_FALSE(selfPlayWorker.Adjudicate(0, 0.3f));
+    EXPECT_FALSE(selfPlayWorker.Adjudicate(0, 0.01f));
+    EXPECT_FALSE(selfPlayWorker.Adjudicate(0, 0.01f));
+    EXPECT_EQ(selfPlayWorker.DebugAdjudication(0).type, AdjudicationType_None);
+    EXPECT_TRUE(selfPlayWorker.Adjudicate(0, 0.01f));
+    EXPECT_EQ(game->Result(), CHESSCOACH_VALUE_LOSS);
+
+    // Tablebases don't adjudicate positions with too many pieces.
+    Config::Network.SelfPlay.ResignConsecutivePlies = 0;
+    Config::Network.SelfPlay.AdjudicateTablebases = true;
+    selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now());
+    selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+    EXPECT_FALSE(selfPlayWorker.Adjudicate(0, CHESSCOACH_VALUE_LOSS));
+    EXPECT_EQ(selfPlayWorker.DebugAdjudication(0).type, AdjudicationType_None);
+    game->PruneAll();
+
+    // Verification games play on, remembering the first adjudication.
+    Config::Network.SelfPlay.ResignConsecutivePlies = 3;
+    Config::Network.SelfPlay.AdjudicateTablebases = false;
+    Config::Network.SelfPlay.AdjudicationVerificationProportion = 1.f;
+    selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now());
+    selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_FALSE(selfPlayWorker.Adjudicate(0, CHESSCOACH_VALUE_WIN));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_FALSE(selfPlayWorker.Adjudicate(0, CHESSCOACH_VALUE_LOSS));
+    }
+    const AdjudicationState& adjudication = selfPlayWorker.DebugAdjudication(0);
+    EXPECT_TRUE(adjudication.verification);
+    EXPECT_EQ(adjudication.type, AdjudicationType_Resignation);
+    EXPECT_EQ(adjudication.ply, game->Ply());
+    EXPECT_EQ(adjudication.result, CHESSCOACH_VALUE_WIN);
+    game->PruneAll();
+
+    // Verified games count false positives and plies remaining.
+    AdjudicationStatistics statistics{};
+    EXPECT_EQ(statistics.FalsePositiveRate(), 0.f);
+    EXPECT_FALSE(statistics.RecordVerified(adjudication, (adjudication.ply + 10), CHESSCOACH_VALUE_WIN));
+    EXPECT_TRUE(statistics.RecordVerified(adjudication, (adjudication.ply + 30), CHESSCOACH_VALUE_DRAW));
+    EXPECT_EQ(statistics.verifiedCount, 2);
+    EXPECT_EQ(statistics.verifiedFalsePositiveCount, 1);
+    EXPECT_EQ(statistics.verifiedPliesRemaining, 40);
+    EXPECT_EQ(statistics.FalsePositiveRate(), 0.5f);
+    EXPECT_EQ(statistics.AveragePliesRemaining(), 20.f);
+
+    // Restore adjudication config.
+    Config::Network.SelfPlay.ResignValueThreshold = thresholdBackup;
+    Config::Network.SelfPlay.ResignConsecutivePlies = consecutivePliesBackup;
+    Config::Network.SelfPlay.AdjudicateTablebases = tablebasesBackup;
+    Config::Network.SelfPlay.AdjudicationVerificationProportion = verificationBackup;
+}
+
+TEST(Mcts, Forking)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+
+    const float proportionBackup = Config::Network.SelfPlay.ForkProportion;
+    const float thresholdBackup = Config::Network.SelfPlay.ForkValueSwingThreshold;
+    Config::Network.SelfPlay.ForkProportion = 1.f;
+    Config::Network.SelfPlay.ForkValueSwingThreshold = 0.2f;
+
+    // Swings from the moving player's perspective: 0.0, 0.1, 0.3, 0.4.
+    const std::vector<Move> moves = { make_move(SQ_E2, SQ_E4), make_move(SQ_E7, SQ_E5), make_move(SQ_G1, SQ_F3), make_move(SQ_B8, SQ_C6), make_move(SQ_F1, SQ_B5) };
+    const std::vector<float> mctsValues = { 0.5f, 0.5f, 0.6f, 0.1f, 0.5f };
+    const std::vector<std::map<Move, float>> childVisits(moves.size());
+    auto forkAfter = [&](int moveCount)
+    {
+        Game game;
+        for (int m = 0; m < moveCount; m++)
+        {
+            game.ApplyMove(moves[m]);
+        }
+        return game.GetPosition().fen();
+    };
+
+    // Nothing to fork from yet.
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), Game::StartingPosition);
+
+    // Fork before the largest swing, then use each position once.
+    selfPlayWorker.AddForkPosition(SavedGame(CHESSCOACH_VALUE_DRAW, moves, mctsValues, childVisits, { 1, 1, 1, 1, 1 }, Game::StartingPosition));
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), forkAfter(3));
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), Game::StartingPosition);
+
+    // Only trust swings between full searches.
+    selfPlayWorker.AddForkPosition(SavedGame(CHESSCOACH_VALUE_DRAW, moves, mctsValues, childVisits, { 1, 1, 1, 1, 0 }, Game::StartingPosition));
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), forkAfter(2));
+
+    // Ignore swings below the threshold.
+    Config::Network.SelfPlay.ForkValueSwingThreshold = 0.5f;
+    selfPlayWorker.AddForkPosition(SavedGame(CHESSCOACH_VALUE_DRAW, moves, mctsValues, childVisits, { 1, 1, 1, 1, 1 }, Game::StartingPosition));
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), Game::StartingPosition);
+    Config::Network.SelfPlay.ForkValueSwingThreshold = 0.2f;
+
+    // Positions are played out from the saved game's own starting position.
+    const std::string forkedFen = forkAfter(1);
+    const std::vector<Move> forkedMoves(moves.begin() + 1, moves.end());
+    const std::vector<float> forkedValues(mctsValues.begin() + 1, mctsValues.end());
+    const std::vector<std::map<Move, float>> forkedChildVisits(forkedMoves.size());
+    selfPlayWorker.AddForkPosition(SavedGame(CHESSCOACH_VALUE_DRAW, forkedMoves, forkedValues, forkedChildVisits, { 1, 1, 1, 1 }, forkedFen));
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), forkAfter(3));
+
+    // The oldest positions are dropped beyond capacity.
+    selfPlayWorker.AddForkPosition(SavedGame(CHESSCOACH_VALUE_DRAW, moves, mctsValues, childVisits, { 1, 1, 1, 1, 0 }, Game::StartingPosition));
+    for (int i = 0; i < SelfPlayWorker::ForkPositionCapacity; i++)
+    {
+        selfPlayWorker.AddForkPosition(SavedGame(CHESSCOACH_VALUE_DRAW, moves, mctsValues, childVisits, { 1, 1, 1, 1, 1 }, Game::StartingPosition));
+    }
+    for (int i = 0; i < SelfPlayWorker::ForkPositionCapacity; i++)
+    {
+        EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), forkAfter(3));
+    }
+    EXPECT_EQ(selfPlayWorker.ChooseStartingPosition(), Game::StartingPosition);
+
+    // Restore fork config.
+    Config::Network.SelfPlay.ForkProportion = proportionBackup;
+    Config::Network.SelfPlay.ForkValueSwingThreshold = thresholdBackup;
+}
+
+TEST(Mcts, TreeMemoryBudget)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+
+    // Search enough for one move to need more than the budget.
+    const int treeMemoryBackup = Config::Misc.Search_TreeMemoryMebibytes;
+    const int numSimulationsBackup = Config::Network.SelfPlay.NumSimulations;
+    const int maxMovesBackup = Config::Network.SelfPlay.MaxMoves;
+    Config::Misc.Search_TreeMemoryMebibytes = 1;
+    Config::Network.SelfPlay.NumSimulations = 3000;
+    Config::Network.SelfPlay.MaxMoves = 2;
+    const int64_t budgetBytes = (static_cast<int64_t>(Config::Misc.Search_TreeMemoryMebibytes) << 20);
+
+    // Only count nodes from this test, since mock-expanded trees in other tests aren't counted when allocated.
+    const int64_t nodeCountBefore = SelfPlayGame::TreeNodeCount();
+    const int64_t bytesBefore = SelfPlayGame::TreeBytes();
+
+    // Budgets only apply to searches (try-hard games).
+    SelfPlayGame* game;
+    SelfPlayState* state;
+    float* values;
+    INetwork::OutputPlanes* policies;
+    selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now(), Game::StartingPosition, {}, true /* tryHard */);
+    selfPlayWorker.DebugGame(0, &game, &state, &values, &policies);
+
+    int64_t peakBytes = 0;
+    while (true)
+    {
+        selfPlayWorker.Play(0);
+        peakBytes = std::max(peakBytes, SelfPlayGame::TreeBytes());
+        if (*state == SelfPlayState::Finished)
+        {
+            break;
+        }
+
+        *values = CHESSCOACH_VALUE_DRAW;
+        INetwork::PlanesPointerFlat policiesPtr = reinterpret_cast<INetwork::PlanesPointerFlat>(policies);
+        std::fill(policiesPtr, policiesPtr + INetwork::OutputPlanesFloatCount, 0.f);
+    }
+
+    // Expansion stops at the budget, give or take a single expansion, but searches still finish and make moves.
+    EXPECT_TRUE(searchState.treeMemoryExhausted);
+    EXPECT_LE(peakBytes, (budgetBytes + static_cast<int64_t>(MAX_MOVES * sizeof(Node)) + 64));
+    EXPECT_EQ(game->Ply(), Config::Network.SelfPlay.MaxMoves);
+
+    // Completing the game prunes everything that was counted.
+    EXPECT_EQ(SelfPlayGame::TreeNodeCount(), nodeCountBefore);
+    EXPECT_EQ(SelfPlayGame::TreeBytes(), bytesBefore);
+
+    // Restore tree memory, simulations and max moves.
+    Config::Misc.Search_TreeMemoryMebibytes = treeMemoryBackup;
+    Config::Network.SelfPlay.NumSimulations = numSimulationsBackup;
+    Config::Network.SelfPlay.MaxMoves = maxMovesBackup;
 }
\ No newline at end of file
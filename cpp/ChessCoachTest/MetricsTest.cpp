@@ -0,0 +1,131 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/Metrics.h>
+#include <ChessCoach/MetricsRegistry.h>
+
+TEST(Metrics, LatencyPercentiles)
+{
+    LatencyHistogram histogram;
+    LatencyHistogram::Counts counts{};
+
+    // No samples yet.
+    histogram.AddTo(counts);
+    EXPECT_EQ(LatencyHistogram::PercentileMilliseconds(counts, 0.5f), 0.f);
+
+    // 90 fast predictions (3 ms, bucket [2.048, 4.096) ms) and 10 slow ones (100 ms, bucket [65.536, 131.072) ms).
+    for (int i = 0; i < 90; i++)
+    {
+        histogram.Record(std::chrono::milliseconds(3));
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        histogram.Record(std::chrono::milliseconds(100));
+    }
+    counts = {};
+    histogram.AddTo(counts);
+
+    // Percentiles report the bucket's upper bound.
+    EXPECT_EQ(LatencyHistogram::PercentileMilliseconds(counts, 0.5f), 4.096f);
+    EXPECT_EQ(LatencyHistogram::PercentileMilliseconds(counts, 0.9f), 4.096f);
+    EXPECT_EQ(LatencyHistogram::PercentileMilliseconds(counts, 0.99f), 131.072f);
+}
+
+TEST(Metrics, PythonCalls)
+{
+    PythonMetrics metrics;
+
+    // Nothing is described before any calls.
+    const PythonMetricsSnapshot empty = metrics.Take();
+    EXPECT_TRUE(PythonMetrics::Describe(empty).empty());
+
+    metrics.Record(PythonCall_PredictBatch, std::chrono::milliseconds(1), std::chrono::milliseconds(10), std::chrono::milliseconds(2));
+    metrics.Record(PythonCall_PredictBatch, std::chrono::milliseconds(3), std::chrono::milliseconds(10), std::chrono::milliseconds(2));
+    const PythonMetricsSnapshot first = metrics.Take();
+    metrics.Record(PythonCall_FileIo, std::chrono::milliseconds(5), std::chrono::milliseconds(20), std::chrono::milliseconds(1));
+    const PythonMetricsSnapshot second = metrics.Take();
+
+    EXPECT_EQ(first[PythonCall_PredictBatch].callCount, 2);
+    EXPECT_EQ(first[PythonCall_PredictBatch].gilWaitNanoseconds, 4000000);
+    EXPECT_EQ(first[PythonCall_PredictBatch].pythonNanoseconds, 20000000);
+    EXPECT_EQ(first[PythonCall_PredictBatch].marshalNanoseconds, 4000000);
+    EXPECT_EQ(LatencyHistogram::PercentileMilliseconds(first[PythonCall_PredictBatch].gilWaitLatency, 0.99f), 4.096f);
+
+    // Deltas only include calls made since the earlier snapshot.
+    const PythonMetricsSnapshot delta = PythonMetrics::Since(second, first);
+    EXPECT_EQ(delta[PythonCall_PredictBatch].callCount, 0);
+    EXPECT_EQ(delta[PythonCall_FileIo].callCount, 1);
+    EXPECT_EQ(delta[PythonCall_FileIo].gilWaitNanoseconds, 5000000);
+
+    const std::vector<std::string> lines = PythonMetrics::Describe(delta);
+    ASSERT_EQ(lines.size(), 1);
+    EXPECT_EQ(lines[0].rfind("python file_io calls 1 gil_wait 5.000 ms", 0), 0);
+}
+
+TEST(Metrics, PrometheusExport)
+{
+    MetricsRegistry& registry = MetricsRegistry::Instance;
+
+    MetricCounter& counter = registry.Counter("chesscoach_test_events_total", "Test events");
+    EXPECT_EQ(&counter, &registry.Counter("chesscoach_test_events_total", "Test events"));
+    counter.Add(3);
+    registry.Gauge("chesscoach_test_ratio", "Test ratio").Set(0.25);
+    MetricHistogram& histogram = registry.Histogram("chesscoach_test_seconds", "Test latency");
+    histogram.Record(std::chrono::milliseconds(3));
+    histogram.Record(std::chrono::milliseconds(100));
+    const int callback = registry.AddCallback("chesscoach_test_callback", "Test callback", MetricType_Gauge, []() { return 7.0; });
+
+    std::string text = registry.Render();
+    EXPECT_NE(text.find("# TYPE chesscoach_test_events_total counter\nchesscoach_test_events_total 3\n"), std::string::npos);
+    EXPECT_NE(text.find("# HELP chesscoach_test_ratio Test ratio\n# TYPE chesscoach_test_ratio gauge\nchesscoach_test_ratio 0.25\n"), std::string::npos);
+    EXPECT_NE(text.find("chesscoach_test_callback 7\n"), std::string::npos);
+
+    // Buckets are cumulative, bounded by powers of two microseconds.
+    EXPECT_NE(text.find("chesscoach_test_seconds_bucket{le=\"0.002048\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("chesscoach_test_seconds_bucket{le=\"0.004096\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("chesscoach_test_seconds_bucket{le=\"0.131072\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("chesscoach_test_seconds_bucket{le=\"+Inf\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("chesscoach_test_seconds_sum 0.103\n"), std::string::npos);
+    EXPECT_NE(text.find("chesscoach_test_seconds_count 2\n"), std::string::npos);
+
+    registry.Remove(callback);
+    text = registry.Render();
+    EXPECT_EQ(text.find("chesscoach_test_callback"), std::string::npos);
+
+    // Export to a file, which is written as soon as the exporter starts.
+    const std::filesystem::path path = (std::filesystem::temp_directory_path() / "ChessCoachMetricsTest.prom");
+    std::filesystem::remove(path);
+    MetricsExporter::Instance.Start(path, "", 60);
+    for (int i = 0; (i < 100) && !std::filesystem::exists(path); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    MetricsExporter::Instance.Stop();
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    EXPECT_NE(contents.str().find("chesscoach_test_events_total 3\n"), std::string::npos);
+    EXPECT_NE(contents.str().find("# TYPE chesscoach_prediction_cache_hit_ratio gauge\n"), std::string::npos);
+    file.close();
+    std::filesystem::remove(path);
+}
@@ -17,6 +17,9 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 #pragma warning(disable:4100) // Ignore unused args in generated code
 #pragma warning(disable:4127) // Ignore const-per-architecture warning
@@ -320,6 +323,98 @@ TEST(Network, CompressDecompressSparse)
     // Don't repeat sanity-checks.
 }
 
+TEST(Network, CompressDecompressForked)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    // Fork from a position with black to play, so that the first player isn't white.
+    const std::string startFen = "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1";
+    SelfPlayWorker dummyWorker(nullptr /* storage */, nullptr /* searchState */, 0 /* gameCount */);
+    SelfPlayGame game(startFen, {}, false /* tryHard */, nullptr, nullptr, nullptr, nullptr);
+
+    const std::vector<Move> moves =
+    {
+        make_move(SQ_E7, SQ_E5), make_move(SQ_G1, SQ_F3), make_move(SQ_D7, SQ_D6), make_move(SQ_D2, SQ_D4),
+        make_move(SQ_C8, SQ_G4), make_move(SQ_D4, SQ_E5), make_move(SQ_G4, SQ_F3), make_move(SQ_D1, SQ_F3),
+        make_move(SQ_D6, SQ_E5), make_move(SQ_F1, SQ_C4), make_move(SQ_G8, SQ_F6),
+    };
+    for (int i = 0; i < moves.size(); i++)
+    {
+        ApplyMoveExpandWithPattern(dummyWorker, game, moves[i], i);
+    }
+    game.Root()->terminalValue = TerminalValue::MateIn<1>(); // Fudge a non-draw so that flips are interesting.
+    game.Complete();
+    const SavedGame savedGame = game.Save();
+    EXPECT_EQ(savedGame.startFen, startFen);
+    EXPECT_EQ(savedGame.result, CHESSCOACH_VALUE_LOSS); // Black delivered mate.
+
+    // The starting position is stored, and the result is stored from black's perspective.
+    const Storage storage;
+    message::Example compressed = storage.DebugPopulateGame(savedGame);
+    auto& features = *compressed.mutable_features()->mutable_feature();
+    ASSERT_EQ(features.count("start_fen"), 1);
+    EXPECT_EQ(features["start_fen"].bytes_list().value(0), startFen);
+    auto& result = *features["result"].mutable_float_list()->mutable_value();
+    EXPECT_EQ(result[0], INetwork::MapProbability01To11(Game::FlipValue(BLACK, savedGame.result)));
+
+    // Decompress in Python.
+    auto& imagePiecesAuxiliary = *features["image_pieces_auxiliary"].mutable_int64_list()->mutable_value();
+    auto& policyRowLengths = *features["policy_row_lengths"].mutable_int64_list()->mutable_value();
+    auto& policyIndices = *features["policy_indices"].mutable_int64_list()->mutable_value();
+    auto& policyValues = *features["policy_values"].mutable_float_list()->mutable_value();
+
+    std::vector<INetwork::InputPlanes> images(savedGame.moveCount);
+    std::vector<float> values(savedGame.moveCount);
+    std::vector<INetwork::OutputPlanes> policies(savedGame.moveCount);
+
+    const int decompressPositionsModulus = 1; // Every position
+    std::unique_ptr<INetwork> network(chessCoach.CreateNetwork());
+    network->DebugDecompress(savedGame.moveCount, policyIndices.size(), result.mutable_data(), imagePiecesAuxiliary.mutable_data(),
+        policyRowLengths.mutable_data(), policyIndices.mutable_data(), policyValues.mutable_data(), decompressPositionsModulus,
+        images.data(), values.data(), policies.data());
+
+    // Value targets alternate perspective starting from black.
+    Game scratchGame(startFen, {});
+    for (int i = 0; i < moves.size(); i++)
+    {
+        INetwork::InputPlanes image;
+        float value;
+        INetwork::OutputPlanes policy{}; // "GeneratePolicy" requires zeroed planes.
+
+        scratchGame.GenerateImage(image);
+
+        value = Game::FlipValue(scratchGame.ToPlay(), savedGame.result);
+
+        scratchGame.GeneratePolicy(savedGame.childVisits[i], policy);
+
+        // Compare compressed to uncompressed.
+        EXPECT_EQ(image, images[i]);
+        EXPECT_EQ(value, values[i]);
+        EXPECT_EQ(policy, policies[i]);
+
+        scratchGame.ApplyMove(moves[i]);
+    }
+
+    // Save and load a chunk, as the GUI does.
+    const std::filesystem::path chunkPath = (std::filesystem::temp_directory_path() / "ChessCoachCompressDecompressForked.chunk");
+    storage.SaveChunk(chunkPath, { savedGame });
+    std::stringstream chunkContents;
+    chunkContents << std::ifstream(chunkPath, std::ios::binary).rdbuf();
+    std::filesystem::remove(chunkPath);
+
+    Storage loadingStorage;
+    SavedGame loaded;
+    loadingStorage.LoadGameFromChunk(chunkContents.str(), 0 /* gameIndex */, &loaded);
+    EXPECT_EQ(loaded.startFen, startFen);
+    EXPECT_EQ(loaded.result, savedGame.result);
+    ASSERT_EQ(loaded.moveCount, savedGame.moveCount);
+    for (int i = 0; i < (savedGame.moveCount - 1); i++) // The final move is guessed, since the terminal position isn't stored.
+    {
+        EXPECT_EQ(loaded.moves[i], savedGame.moves[i]);
+    }
+}
+
 TEST(Network, QueenKnightPlanes)
 {
     ChessCoach chessCoach;
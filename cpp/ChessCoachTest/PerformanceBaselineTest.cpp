@@ -0,0 +1,133 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/PerformanceBaseline.h>
+
+static std::vector<StrengthTestPerformance> GeneratePerformances(float nodesPerSecondScale, float secondsToSolutionScale)
+{
+    // Vary speed by position so that the comparison sees realistic spread.
+    std::vector<StrengthTestPerformance> performances;
+    for (int i = 0; i < 20; i++)
+    {
+        const float jitter = (1.f + (((i % 5) - 2) * 0.01f));
+        StrengthTestPerformance performance;
+        performance.fen = ("8/8/8/8/8/8/8/K6k w - - 0 " + std::to_string(i + 1));
+        performance.solved = ((i % 4) != 0);
+        performance.seconds = 0.2f;
+        performance.nodes = static_cast<int>((1000 + (i * 100)) * nodesPerSecondScale * jitter);
+        performance.nodesToSolution = (performance.solved ? static_cast<int>((500 + (i * 50)) * secondsToSolutionScale * jitter) : 0);
+        performance.secondsToSolution = (performance.solved ? (0.1f * secondsToSolutionScale * jitter) : 0.f);
+        performances.push_back(performance);
+    }
+    return performances;
+}
+
+TEST(PerformanceBaseline, Compare)
+{
+    const std::vector<StrengthTestPerformance> baseline = GeneratePerformances(1.f, 1.f);
+
+    // Identical runs pass.
+    const PerformanceComparison same = PerformanceBaseline::Compare(baseline, baseline, 0.05f, 1.96f);
+    EXPECT_FALSE(same.regressed);
+    EXPECT_EQ(same.nodesPerSecond.pairedCount, 20);
+    EXPECT_EQ(same.nodesToSolution.pairedCount, 15);
+    EXPECT_EQ(same.secondsToSolution.pairedCount, 15);
+    EXPECT_FLOAT_EQ(same.nodesPerSecond.geometricMeanRatio, 1.f);
+    EXPECT_EQ(same.baselineSolvedCount, 15);
+    EXPECT_EQ(same.newlyUnsolvedCount, 0);
+
+    // Slowdowns within tolerance pass.
+    const PerformanceComparison slightlySlower = PerformanceBaseline::Compare(baseline, GeneratePerformances(0.98f, 1.02f), 0.05f, 1.96f);
+    EXPECT_FALSE(slightlySlower.regressed);
+
+    // Significant slowdowns in nodes per second or time to solution fail.
+    const PerformanceComparison slowerNodes = PerformanceBaseline::Compare(baseline, GeneratePerformances(0.8f, 1.f), 0.05f, 1.96f);
+    EXPECT_TRUE(slowerNodes.regressed);
+    EXPECT_NEAR(slowerNodes.nodesPerSecond.geometricMeanRatio, 0.8f, 0.01f);
+    EXPECT_LT(slowerNodes.nodesPerSecond.upperRatio, 1.f);
+
+    const PerformanceComparison slowerSolutions = PerformanceBaseline::Compare(baseline, GeneratePerformances(1.f, 1.5f), 0.05f, 1.96f);
+    EXPECT_TRUE(slowerSolutions.regressed);
+    EXPECT_GT(slowerSolutions.nodesToSolution.lowerRatio, 1.f);
+    EXPECT_GT(slowerSolutions.secondsToSolution.lowerRatio, 1.f);
+
+    // Needing more nodes to solve fails on its own.
+    std::vector<StrengthTestPerformance> moreNodes = baseline;
+    for (StrengthTestPerformance& performance : moreNodes)
+    {
+        performance.nodesToSolution = (performance.nodesToSolution * 3 / 2);
+    }
+    const PerformanceComparison moreNodesToSolution = PerformanceBaseline::Compare(baseline, moreNodes, 0.05f, 1.96f);
+    EXPECT_TRUE(moreNodesToSolution.regressed);
+    EXPECT_GT(moreNodesToSolution.nodesToSolution.lowerRatio, 1.f);
+    EXPECT_FLOAT_EQ(moreNodesToSolution.secondsToSolution.geometricMeanRatio, 1.f);
+
+    // Positions that are no longer solved count at the full search, so losing enough solutions fails.
+    std::vector<StrengthTestPerformance> unsolved = baseline;
+    int unsolvedCount = 0;
+    for (StrengthTestPerformance& performance : unsolved)
+    {
+        if (performance.solved && (unsolvedCount < 5))
+        {
+            performance.solved = false;
+            performance.nodesToSolution = 0;
+            performance.secondsToSolution = 0.f;
+            unsolvedCount++;
+        }
+    }
+    const PerformanceComparison lessSolved = PerformanceBaseline::Compare(baseline, unsolved, 0.05f, 1.96f);
+    EXPECT_TRUE(lessSolved.regressed);
+    EXPECT_EQ(lessSolved.newlyUnsolvedCount, 5);
+    EXPECT_EQ(lessSolved.currentSolvedCount, 10);
+    EXPECT_EQ(lessSolved.secondsToSolution.pairedCount, 15);
+    EXPECT_GT(lessSolved.secondsToSolution.lowerRatio, 1.f);
+
+    // Newly solving positions counts as faster.
+    EXPECT_FALSE(PerformanceBaseline::Compare(unsolved, baseline, 0.05f, 1.96f).regressed);
+
+    // Speedups pass.
+    const PerformanceComparison faster = PerformanceBaseline::Compare(baseline, GeneratePerformances(1.5f, 0.5f), 0.05f, 1.96f);
+    EXPECT_FALSE(faster.regressed);
+
+    // A single paired position can't be significant.
+    const std::vector<StrengthTestPerformance> slower = GeneratePerformances(0.5f, 1.f);
+    const std::vector<StrengthTestPerformance> single(baseline.begin(), baseline.begin() + 2);
+    const std::vector<StrengthTestPerformance> singleSlower(slower.begin() + 1, slower.begin() + 2);
+    EXPECT_FALSE(PerformanceBaseline::Compare(single, singleSlower, 0.05f, 1.96f).regressed);
+}
+
+TEST(PerformanceBaseline, SaveLoad)
+{
+    const std::vector<StrengthTestPerformance> performances = GeneratePerformances(1.f, 1.f);
+    const std::filesystem::path path = (std::filesystem::temp_directory_path() / "ChessCoachTest_PerformanceBaseline.csv");
+
+    PerformanceBaseline::Save(path, performances);
+    const std::vector<StrengthTestPerformance> loaded = PerformanceBaseline::Load(path);
+    std::filesystem::remove(path);
+
+    ASSERT_EQ(loaded.size(), performances.size());
+    for (int i = 0; i < loaded.size(); i++)
+    {
+        EXPECT_EQ(loaded[i].fen, performances[i].fen);
+        EXPECT_EQ(loaded[i].solved, performances[i].solved);
+        EXPECT_EQ(loaded[i].nodes, performances[i].nodes);
+        EXPECT_FLOAT_EQ(loaded[i].seconds, performances[i].seconds);
+        EXPECT_EQ(loaded[i].nodesToSolution, performances[i].nodesToSolution);
+        EXPECT_NEAR(loaded[i].secondsToSolution, performances[i].secondsToSolution, 1e-4f);
+    }
+}
@@ -101,4 +101,22 @@ TEST(Pgn, ParseSan)
     {
         TestParseSan(testCase.fen, testCase.san, testCase.move);
     }
+}
+
+TEST(Pgn, GeneratePgnStartFen)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    // Games forked from positions in earlier games need a FEN header and correct move numbering.
+    const std::string fen = "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2";
+    const std::vector<Move> moves = { make_move(SQ_B8, SQ_C6), make_move(SQ_F1, SQ_B5) };
+    const SavedGame game(CHESSCOACH_VALUE_DRAW, moves, { CHESSCOACH_VALUE_DRAW, CHESSCOACH_VALUE_DRAW },
+        std::vector<std::map<Move, float>>(moves.size()), std::vector<uint8_t>(moves.size(), 1), fen);
+
+    std::stringstream pgn;
+    Pgn::GeneratePgn(pgn, game);
+
+    EXPECT_NE(pgn.str().find("[FEN \"" + fen + "\"]"), std::string::npos);
+    EXPECT_NE(pgn.str().find("2... Nc6 3. Bb5 1/2-1/2"), std::string::npos);
 }
\ No newline at end of file
@@ -17,9 +17,12 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <thread>
+#include <vector>
 
 #include <ChessCoach/SelfPlay.h>
 #include <ChessCoach/PoolAllocator.h>
+#include <ChessCoach/SharedPoolAllocator.h>
 
 TEST(PoolAllocator, Basic)
 {
@@ -66,4 +69,87 @@ TEST(PoolAllocator, Alignment)
         uintptr_t item = reinterpret_cast<uintptr_t>(poolAllocator.Allocate());
         EXPECT_EQ(item % alignment, 0);
     }
-}
\ No newline at end of file
+}
+
+TEST(SharedPoolAllocator, CrossThreadFrees)
+{
+    SharedPoolAllocator allocator("test", sizeof(StateInfo), alignof(StateInfo));
+    const int itemsPerSlab = static_cast<int>(SharedPoolAllocator::SlabBytes / sizeof(StateInfo));
+
+    // Allocate a few slabs' worth here, then free them on another thread.
+    std::vector<void*> items(itemsPerSlab * 3);
+    for (void*& item : items)
+    {
+        item = allocator.Allocate();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(item) % alignof(StateInfo), 0);
+    }
+    const int slabCount = allocator.DebugSlabCount();
+    EXPECT_GE(slabCount, 3);
+    std::thread([&]()
+        {
+            for (void* item : items)
+            {
+                allocator.Free(item);
+            }
+        }).join();
+    EXPECT_EQ(allocator.DebugAllocations().first, 0);
+
+    // Reallocating collects the returned items rather than growing.
+    for (void*& item : items)
+    {
+        item = allocator.Allocate();
+    }
+    EXPECT_LE(allocator.DebugSlabCount(), slabCount);
+    for (void* item : items)
+    {
+        allocator.Free(item);
+    }
+    EXPECT_EQ(allocator.DebugAllocations().first, 0);
+}
+
+TEST(SharedPoolAllocator, ReleasesIdleSlabs)
+{
+    SharedPoolAllocator allocator("test", sizeof(StateInfo), alignof(StateInfo));
+    const int itemsPerSlab = static_cast<int>(SharedPoolAllocator::SlabBytes / sizeof(StateInfo));
+
+    // Freeing everything on the owning thread keeps only a few spare slabs.
+    std::vector<void*> items(itemsPerSlab * 8);
+    for (void*& item : items)
+    {
+        item = allocator.Allocate();
+    }
+    EXPECT_GE(allocator.DebugSlabCount(), 8);
+    for (void* item : items)
+    {
+        allocator.Free(item);
+    }
+    EXPECT_LE(allocator.DebugSlabCount(), SharedPoolAllocator::SpareSlabsPerThread);
+    EXPECT_GT(allocator.Take().releasedSlabCount, 0);
+
+    // Exiting threads return idle slabs to the OS, and a later thread adopts a cache still holding live items.
+    void* survivor = nullptr;
+    std::thread([&]()
+        {
+            std::vector<void*> scratch(itemsPerSlab * 2);
+            for (void*& item : scratch)
+            {
+                item = allocator.Allocate();
+            }
+            for (void* item : scratch)
+            {
+                allocator.Free(item);
+            }
+            survivor = allocator.Allocate();
+        }).join();
+    const SharedPoolSnapshot snapshot = allocator.Take();
+    ASSERT_EQ(snapshot.threads.size(), 2);
+    EXPECT_EQ(snapshot.threads[1].slabCount, 1);
+    std::thread([&]()
+        {
+            allocator.Free(allocator.Allocate());
+            allocator.Free(survivor);
+        }).join();
+    EXPECT_EQ(allocator.Take().threads.size(), 2);
+    EXPECT_EQ(allocator.Take().threads[1].slabCount, 0);
+    EXPECT_EQ(allocator.DebugAllocations().first, 0);
+}
@@ -0,0 +1,120 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <filesystem>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/PredictionCacheSimulator.h>
+
+static PredictionCacheProbe MakeProbe(Key key, int moveCount)
+{
+    PredictionCacheProbe probe = {};
+    probe.key = key;
+    probe.moveCount = static_cast<uint16_t>(moveCount);
+    return probe;
+}
+
+TEST(PredictionCacheSimulator, TraceRoundTrip)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    const std::filesystem::path path = (std::filesystem::temp_directory_path() / "ChessCoachPredictionCacheProbesTest.bin");
+    PredictionCacheTrace::Start(path);
+    EXPECT_TRUE(PredictionCacheTrace::Enabled());
+    PredictionCacheTrace::Record(1234, 20, true);
+    std::thread([]() { PredictionCacheTrace::Record(5678, 70, false); }).join();
+    EXPECT_EQ(PredictionCacheTrace::Stop(), 2);
+    EXPECT_FALSE(PredictionCacheTrace::Enabled());
+
+    std::vector<PredictionCacheProbe> probes = PredictionCacheTrace::Load(path);
+    std::filesystem::remove(path);
+    ASSERT_EQ(probes.size(), 2);
+    if (probes[0].key != 1234)
+    {
+        std::swap(probes[0], probes[1]);
+    }
+    EXPECT_EQ(probes[0].key, 1234);
+    EXPECT_EQ(probes[0].moveCount, 20);
+    EXPECT_EQ(probes[0].hit, 1);
+    EXPECT_EQ(probes[1].key, 5678);
+    EXPECT_EQ(probes[1].moveCount, 70);
+    EXPECT_EQ(probes[1].hit, 0);
+}
+
+TEST(PredictionCacheSimulator, Geometries)
+{
+    EXPECT_EQ(PredictionCacheSimulator::SlotsForMoveCount(1), 1);
+    EXPECT_EQ(PredictionCacheSimulator::SlotsForMoveCount(56), 1);
+    EXPECT_EQ(PredictionCacheSimulator::SlotsForMoveCount(57), 2);
+    EXPECT_EQ(PredictionCacheSimulator::SlotsForMoveCount(120), 2);
+    EXPECT_EQ(PredictionCacheSimulator::SlotsForMoveCount(121), 3);
+
+    // Repeated keys hit under every policy.
+    std::vector<PredictionCacheProbe> probes;
+    for (int repeat = 0; repeat < 2; repeat++)
+    {
+        for (Key key = 1; key <= 100; key++)
+        {
+            probes.push_back(MakeProbe(key * 0x123456789ULL, 30));
+        }
+    }
+    for (int i = 0; i < CacheReplacement_Count; i++)
+    {
+        const CacheSimulationResult result = PredictionCacheSimulator::Simulate({ 1, 8, 1, static_cast<CacheReplacement>(i) }, probes);
+        EXPECT_EQ(result.probeCount, 200);
+        EXPECT_EQ(result.hitCount, 100);
+        EXPECT_EQ(result.evictionCount, 0);
+        EXPECT_DOUBLE_EQ(result.HitRate(), 0.5);
+    }
+
+    // Oversize positions are uncacheable with single-slot entries, like the live cache, but fit in larger ones.
+    const std::vector<PredictionCacheProbe> oversize = { MakeProbe(42, 100), MakeProbe(42, 100) };
+    const CacheSimulationResult single = PredictionCacheSimulator::Simulate({ 1, 8, 1, CacheReplacement_Lru }, oversize);
+    EXPECT_EQ(single.oversizeProbeCount, 2);
+    EXPECT_EQ(single.hitCount, 0);
+    const CacheSimulationResult multiple = PredictionCacheSimulator::Simulate({ 1, 8, 4, CacheReplacement_Lru }, oversize);
+    EXPECT_EQ(multiple.hitCount, 1);
+    EXPECT_EQ(multiple.oversizeHitCount, 1);
+
+    // A scan of unique keys flushes a hot working set from LRU, whereas LFU keeps it.
+    std::vector<PredictionCacheProbe> scan;
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        for (Key key = 1; key <= 100; key++)
+        {
+            scan.push_back(MakeProbe(key * 0x9E3779B97F4A7C15ULL, 30));
+        }
+    }
+    for (Key key = 1; key <= 20000; key++)
+    {
+        scan.push_back(MakeProbe((key + 1000) * 0x9E3779B97F4A7C15ULL, 30));
+    }
+    for (Key key = 1; key <= 100; key++)
+    {
+        scan.push_back(MakeProbe(key * 0x9E3779B97F4A7C15ULL, 30));
+    }
+    const CacheSimulationResult lru = PredictionCacheSimulator::Simulate({ 1, 8, 1, CacheReplacement_Lru }, scan);
+    const CacheSimulationResult lfu = PredictionCacheSimulator::Simulate({ 1, 8, 1, CacheReplacement_Lfu }, scan);
+    const CacheSimulationResult clock = PredictionCacheSimulator::Simulate({ 1, 8, 1, CacheReplacement_Clock }, scan);
+    EXPECT_GT(lru.evictionCount, 0);
+    EXPECT_GT(clock.evictionCount, 0);
+    EXPECT_LE(lru.hitCount - 200, 10);
+    EXPECT_GE(lfu.hitCount - 200, 90);
+}
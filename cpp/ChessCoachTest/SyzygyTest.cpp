@@ -0,0 +1,208 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/Game.h>
+#include <ChessCoach/SelfPlay.h>
+#include <ChessCoach/Syzygy.h>
+#include <ChessCoach/SyzygyWarmup.h>
+
+TEST(Syzygy, WdlCache)
+{
+    SyzygyWdlCache cache;
+    int wdl = 0;
+
+    // Disabled when empty.
+    cache.Allocate(0);
+    EXPECT_EQ(cache.EntryCount(), 0);
+    cache.Store(0x1234567890ABCDEFULL, 2);
+    EXPECT_FALSE(cache.Probe(0x1234567890ABCDEFULL, wdl));
+
+    // Sizes round down to a power of two.
+    cache.Allocate(3);
+    EXPECT_EQ(cache.EntryCount(), (2 * 1024 * 1024 / sizeof(uint64_t)));
+
+    // Every score round-trips, including the key with no upper bits set.
+    const uint64_t keys[] = { 0x1234567890ABCDEFULL, 0xFEDCBA0987654321ULL, 0x0ULL, 0x7ULL, 0xFFFFFFFFFFFFFFFFULL };
+    for (const uint64_t key : keys)
+    {
+        EXPECT_FALSE(cache.Probe(key, wdl));
+        for (int score = -2; score <= 2; score++)
+        {
+            cache.Store(key, score);
+            ASSERT_TRUE(cache.Probe(key, wdl));
+            EXPECT_EQ(wdl, score);
+        }
+        cache.Clear();
+    }
+
+    // A different key in the same slot is a miss, and replaces the entry.
+    const uint64_t key = 0x1234567890ABCDEFULL;
+    const uint64_t collision = (key ^ (1ULL << 62));
+    cache.Store(key, 1);
+    EXPECT_FALSE(cache.Probe(collision, wdl));
+    cache.Store(collision, -1);
+    EXPECT_FALSE(cache.Probe(key, wdl));
+    ASSERT_TRUE(cache.Probe(collision, wdl));
+    EXPECT_EQ(wdl, -1);
+}
+
+TEST(Syzygy, WarmupMaterials)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    // KRPvKR: the current material comes first, then captures and promotions.
+    const Game game("8/8/4k3/4r3/8/4P3/4K3/7R w - - 0 1", {});
+    const std::vector<std::pair<std::string, int>> materials = SyzygyWarmup::RelevantMaterials(game.GetPosition(), 5);
+    ASSERT_FALSE(materials.empty());
+    EXPECT_EQ(materials[0], std::make_pair(std::string("KRPvKR"), 0));
+    for (const char* expected : { "KRvKR", "KPvKR", "KRPvK", "KQRvKR", "KRNvKR" })
+    {
+        EXPECT_NE(std::find(materials.begin(), materials.end(), std::make_pair(std::string(expected), 1)), materials.end()) << expected;
+    }
+    EXPECT_EQ(std::find_if(materials.begin(), materials.end(), [](const auto& material) { return (material.first == "KvK"); }), materials.end());
+
+    // With only 4-piece tables, a capture is needed first.
+    const std::vector<std::pair<std::string, int>> smaller = SyzygyWarmup::RelevantMaterials(game.GetPosition(), 4);
+    ASSERT_FALSE(smaller.empty());
+    EXPECT_EQ(smaller[0].second, 1);
+    for (const auto& [name, distance] : smaller)
+    {
+        EXPECT_LE(name.size(), 5) << name;
+    }
+}
+
+TEST(Syzygy, Warmup)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    // Tables may name either side first, and DTZ tables are only read for the nearest materials.
+    const std::filesystem::path directory = (std::filesystem::temp_directory_path() / "ChessCoachSyzygyWarmupTest");
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const std::pair<const char*, int> files[] = { { "KRPvKR.rtbw", 1000 }, { "KRvKRP.rtbz", 2000 }, { "KRvKR.rtbw", 3000 }, { "KRvKR.rtbz", 4000 } };
+    for (const auto& [filename, size] : files)
+    {
+        std::ofstream(directory / filename, std::ios::binary) << std::string(size, 'x');
+    }
+
+    const int64_t budgetBytes = (1024 * 1024);
+    SyzygyWarmup warmup;
+    warmup.Configure(directory.string());
+    const Game game("8/8/4k3/4r3/8/4P3/4K3/7R w - - 0 1", {});
+    const Game tooMany("8/8/4k3/4r3/1n6/4P3/4K3/6QR w - - 0 1", {});
+    EXPECT_FALSE(warmup.Request(tooMany.GetPosition(), 5, 0, budgetBytes));
+    EXPECT_TRUE(warmup.Request(game.GetPosition(), 5, 0, budgetBytes));
+    EXPECT_FALSE(warmup.Request(game.GetPosition(), 5, 0, budgetBytes));
+    warmup.WaitUntilIdle();
+
+    const SyzygyWarmupStats stats = warmup.Stats();
+    EXPECT_EQ(stats.requestCount, 1);
+    EXPECT_EQ(stats.fileCount, 4);
+    EXPECT_EQ(stats.byteCount, 10000);
+
+    // Nearest files come first, and files over the remaining budget are skipped.
+    SyzygyWarmup budgeted;
+    budgeted.Configure(directory.string());
+    EXPECT_TRUE(budgeted.Request(game.GetPosition(), 5, 0, 5000));
+    budgeted.WaitUntilIdle();
+
+    const SyzygyWarmupStats budgetedStats = budgeted.Stats();
+    EXPECT_EQ(budgetedStats.fileCount, 2);
+    EXPECT_EQ(budgetedStats.byteCount, 4000);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(Syzygy, RootRanking)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    SearchState searchState{};
+    SelfPlayWorker selfPlayWorker(nullptr /* storage */, &searchState, 1 /* gameCount */);
+    selfPlayWorker.Initialize();
+    SelfPlayGame* game;
+
+    // Expand the root with every legal move.
+    auto setUp = [&](const std::string& fen)
+    {
+        selfPlayWorker.SetUpGame(0, std::chrono::high_resolution_clock::now(), fen, {}, true /* tryHard */);
+        selfPlayWorker.DebugGame(0, &game, nullptr, nullptr, nullptr);
+        const MoveList<LEGAL> legalMoves(game->GetPosition());
+        game->Root()->childCount = static_cast<uint8_t>(legalMoves.size());
+        game->Root()->children = new Node[legalMoves.size()]{};
+        int index = 0;
+        for (const Move move : legalMoves)
+        {
+            game->Root()->children[index++].move = static_cast<uint16_t>(move);
+        }
+    };
+
+    // Nothing to help with until a ranking is posted.
+    TablebaseRootRanking ranking;
+    EXPECT_FALSE(ranking.Help());
+
+    // Bare kings are drawn without needing any tables. Keep a helper busy to exercise sharing.
+    std::atomic_bool stop = false;
+    std::thread helper([&]()
+        {
+            while (!stop)
+            {
+                ranking.Help();
+            }
+        });
+    setUp("8/8/8/4k3/8/8/8/4K3 w - - 0 1");
+    for (int i = 0; i < 100; i++)
+    {
+        for (const bool dtz : { true, false })
+        {
+            for (Node& child : *game->Root())
+            {
+                child.SetTablebaseRankBound(1000, BOUND_LOWER);
+            }
+            ASSERT_TRUE(ranking.Rank(*game, dtz, nullptr /* workCoordinator */));
+            EXPECT_GE(ranking.LastThreadCount(), 1);
+            for (const Node& child : *game->Root())
+            {
+                EXPECT_EQ(child.TablebaseRank(), 0);
+                EXPECT_EQ(child.GetBound(), BOUND_EXACT);
+            }
+        }
+    }
+    stop = true;
+    helper.join();
+    game->PruneAll();
+
+    // Missing tables fail the ranking without touching children.
+    setUp("8/8/8/4k3/8/8/8/3QK3 w - - 0 1");
+    EXPECT_FALSE(ranking.Rank(*game, true /* dtz */, nullptr /* workCoordinator */));
+    EXPECT_FALSE(ranking.Rank(*game, false /* dtz */, nullptr /* workCoordinator */));
+    for (const Node& child : *game->Root())
+    {
+        EXPECT_EQ(child.GetBound(), BOUND_NONE);
+    }
+    game->PruneAll();
+}
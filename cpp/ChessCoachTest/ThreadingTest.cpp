@@ -0,0 +1,181 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/Threading.h>
+
+TEST(Threading, WakeWord)
+{
+    WakeWord wake;
+
+    // A stale observation returns immediately, and a current one times out.
+    const uint32_t observed = wake.Load();
+    wake.Wake();
+    EXPECT_NE(wake.Load(), observed);
+    wake.Wait(observed);
+    const auto start = std::chrono::high_resolution_clock::now();
+    wake.Wait(wake.Load(), 20);
+    EXPECT_GE(std::chrono::high_resolution_clock::now() - start, std::chrono::milliseconds(10));
+
+    // Sleepers are woken.
+    const uint32_t before = wake.Load();
+    std::thread sleeper([&]() { while (wake.Load() == before) { wake.Wait(before); } });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    wake.Wake();
+    sleeper.join();
+}
+
+TEST(Threading, WorkCoordinatorStartStop)
+{
+    const int workerCount = 4;
+    WorkCoordinator workCoordinator(workerCount);
+
+    // Workers sleep for a long time while working, so stopping promptly relies on wakeups.
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back([&workCoordinator, i]()
+            {
+                while (workCoordinator.WaitForWorkItems(i))
+                {
+                    while (!workCoordinator.AllWorkItemsCompleted())
+                    {
+                        workCoordinator.WaitForWake(i, 10000);
+                    }
+                }
+            });
+    }
+    workCoordinator.WaitForWorkers();
+    for (int i = 0; i < workerCount; i++)
+    {
+        EXPECT_EQ(workCoordinator.State(i), WorkerState_Idle);
+    }
+
+    for (int round = 0; round < 3; round++)
+    {
+        workCoordinator.ResetWorkItemsRemaining(1);
+        for (int i = 0; i < workerCount; i++)
+        {
+            while (workCoordinator.State(i) != WorkerState_Working)
+            {
+                std::this_thread::yield();
+            }
+        }
+        EXPECT_FALSE(workCoordinator.WaitForWorkers(1));
+
+        const auto stop = std::chrono::high_resolution_clock::now();
+        workCoordinator.ResetWorkItemsRemaining(0);
+        workCoordinator.WaitForWorkers();
+        EXPECT_LT(std::chrono::high_resolution_clock::now() - stop, std::chrono::seconds(5));
+        EXPECT_GT(workCoordinator.LastStopLatency().count(), 0);
+        EXPECT_LT(workCoordinator.LastStopLatency(), std::chrono::seconds(5));
+    }
+
+    workCoordinator.ShutDown();
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers[i].join();
+        EXPECT_EQ(workCoordinator.State(i), WorkerState_ShutDown);
+    }
+}
+
+TEST(Threading, WorkCoordinatorWorkItems)
+{
+    const int workerCount = 4;
+    WorkCoordinator workCoordinator(workerCount);
+
+    // Workers haven't started, so aren't ready.
+    EXPECT_FALSE(workCoordinator.WaitForWorkers(1));
+    EXPECT_EQ(workCoordinator.State(0), WorkerState_Starting);
+
+    std::vector<std::thread> workers;
+    std::atomic_int completed = 0;
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back([&workCoordinator, &completed, i]()
+            {
+                while (workCoordinator.WaitForWorkItems(i))
+                {
+                    while (!workCoordinator.AllWorkItemsCompleted())
+                    {
+                        workCoordinator.OnWorkItemCompleted();
+                        completed++;
+                    }
+                }
+            });
+    }
+    workCoordinator.WaitForWorkers();
+
+    // Running out of work items readies the workers without a stop from the controlling thread.
+    workCoordinator.ResetWorkItemsRemaining(1000);
+    workCoordinator.WaitForWorkers();
+    EXPECT_GE(completed.load(), 1000);
+
+    workCoordinator.ShutDown();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+struct TestThreadBuffer
+{
+    explicit TestThreadBuffer(int setThreadId)
+        : threadId(setThreadId)
+        , owned(false)
+    {
+    }
+
+    int threadId;
+    std::atomic_bool owned;
+};
+
+static ThreadBufferRegistry<TestThreadBuffer> TestThreadBuffers;
+thread_local static ThreadBuffer<TestThreadBuffer> TestLocalBuffer;
+
+TEST(Threading, ThreadBufferRegistry)
+{
+    const auto create = [](int threadId) { return new TestThreadBuffer(threadId); };
+
+    // Each thread claims its own buffer once.
+    TestThreadBuffer& buffer = TestLocalBuffer.Get(TestThreadBuffers, create);
+    EXPECT_EQ(&TestLocalBuffer.Get(TestThreadBuffers, create), &buffer);
+    EXPECT_TRUE(buffer.owned);
+
+    TestThreadBuffer* other = nullptr;
+    std::thread first([&]() { other = &TestLocalBuffer.Get(TestThreadBuffers, create); });
+    first.join();
+    ASSERT_NE(other, nullptr);
+    EXPECT_NE(other, &buffer);
+
+    // Buffers are released when their threads exit, and reused by later threads.
+    EXPECT_FALSE(other->owned);
+    TestThreadBuffer* reused = nullptr;
+    std::thread second([&]() { reused = &TestLocalBuffer.Get(TestThreadBuffers, create); });
+    second.join();
+    EXPECT_EQ(reused, other);
+
+    std::lock_guard lock(TestThreadBuffers.Mutex());
+    EXPECT_EQ(TestThreadBuffers.Buffers().size(), 2);
+    EXPECT_EQ(buffer.threadId, 0);
+    EXPECT_EQ(other->threadId, 1);
+}
@@ -0,0 +1,132 @@
+// ChessCoach, a neural network-based chess engine capable of natural-language commentary
+// Copyright 2021 Chris Butner
+//
+// ChessCoach is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChessCoach is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChessCoach. If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/Trace.h>
+
+static int CountOccurrences(const std::string& text, const std::string& pattern)
+{
+    int count = 0;
+    for (size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+    {
+        count++;
+    }
+    return count;
+}
+
+TEST(Trace, ScopesRecordPerThread)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    const bool enabledBackup = Trace::Enabled();
+    Trace::Clear();
+
+    // Nothing is recorded while disabled.
+    Trace::SetEnabled(false);
+    {
+        CHESSCOACH_TRACE_SCOPE("TraceTestDisabled");
+    }
+
+    // Record nested scopes on two fresh threads.
+    Trace::SetEnabled(true);
+    const auto record = []()
+    {
+        CHESSCOACH_TRACE_SCOPE("TraceTestOuter");
+        for (int i = 0; i < 3; i++)
+        {
+            CHESSCOACH_TRACE_SCOPE("TraceTestInner");
+        }
+    };
+    std::thread first(record);
+    first.join();
+    std::thread second(record);
+    second.join();
+    Trace::SetEnabled(enabledBackup);
+
+    std::stringstream dump;
+    Trace::Dump(dump);
+    const std::string json = dump.str();
+
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+    EXPECT_EQ(CountOccurrences(json, "TraceTestDisabled"), 0);
+#ifdef CHESSCOACH_NO_TRACE
+    EXPECT_EQ(CountOccurrences(json, "TraceTestOuter"), 0);
+#else
+    // The second thread may reuse the first thread's buffer after it exits, but events are kept.
+    EXPECT_EQ(CountOccurrences(json, "\"name\":\"TraceTestOuter\""), 2);
+    EXPECT_EQ(CountOccurrences(json, "\"name\":\"TraceTestInner\""), 6);
+#endif
+
+    // Clearing discards recorded events.
+    Trace::Clear();
+    std::stringstream cleared;
+    Trace::Dump(cleared);
+    EXPECT_EQ(CountOccurrences(cleared.str(), "TraceTestOuter"), 0);
+}
+
+TEST(Trace, DumpSkipsEventsBeingOverwritten)
+{
+    ChessCoach chessCoach;
+    chessCoach.Initialize();
+
+    Trace::Clear();
+
+    // Record events whose start always equals their duration, wrapping the ring buffer many times
+    // while dumping, so that any torn event shows up as a mismatch.
+    std::atomic_bool stop(false);
+    std::thread writer([&]()
+    {
+        for (int64_t i = 1; !stop.load(std::memory_order_relaxed); i++)
+        {
+            Trace::Record("TraceTestWrap", (i * 1000), (i * 2000));
+        }
+    });
+
+    for (int dump = 0; dump < 10; dump++)
+    {
+        std::stringstream stream;
+        Trace::Dump(stream);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            if (line.find("\"name\":\"TraceTestWrap\"") == std::string::npos)
+            {
+                continue;
+            }
+            const size_t ts = line.find("\"ts\":");
+            const size_t dur = line.find(",\"dur\":");
+            ASSERT_NE(ts, std::string::npos);
+            ASSERT_NE(dur, std::string::npos);
+            ASSERT_EQ(line.substr(ts + 5, dur - ts - 5), line.substr(dur + 7, line.find('}', dur) - dur - 7));
+        }
+    }
+
+    stop = true;
+    writer.join();
+
+    // Clearing hides the writer's events without resetting its position.
+    Trace::Clear();
+    std::stringstream cleared;
+    Trace::Dump(cleared);
+    EXPECT_EQ(CountOccurrences(cleared.str(), "TraceTestWrap"), 0);
+}
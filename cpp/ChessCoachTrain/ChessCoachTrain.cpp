@@ -20,10 +20,14 @@
 #include <functional>
 #include <numeric>
 
+#include <ChessCoach/AllocationTracker.h>
 #include <ChessCoach/ChessCoach.h>
 #include <ChessCoach/Threading.h>
 #include <ChessCoach/WorkerGroup.h>
 #include <ChessCoach/Syzygy.h>
+#include <ChessCoach/Metrics.h>
+#include <ChessCoach/PredictionCacheTrace.h>
+#include <ChessCoach/Trace.h>
 
 struct TrainingState
 {
@@ -93,6 +97,12 @@ void ChessCoachTrain::TrainChessCoach()
     // Initialize storage for training and take care of any game/chunk housekeeping from previous runs.
     storage.InitializeLocalGamesChunks(network.get());
 
+    // Initialize tablebases for self-play adjudication.
+    if (Config::Network.SelfPlay.AdjudicateTablebases)
+    {
+        Syzygy::Reload();
+    }
+
     // Start self-play worker threads.
     WorkerGroup workerGroup;
     workerGroup.Initialize(network.get(), &storage, Config::Network.SelfPlay.PredictionNetworkType, Config::Network.SelfPlay.NumWorkers,
@@ -195,17 +205,43 @@ void ChessCoachTrain::StagePlay(const TrainingState& state)
     std::cout << "Stage: [" << StageTypeNames[state.Stage().Stage] << "][" << state.Checkpoint() << "]["
         << trainingWindow.TrainingGameMin << " - " << trainingWindow.TrainingGameMax << "]" << std::endl;
 
+    // Track throughput for this stage. With playout cap randomization, value targets (every stored position) per hour
+    // and policy targets (positions from full searches) per hour are more meaningful than simulations per second.
+    const std::chrono::time_point<std::chrono::high_resolution_clock> playStart = std::chrono::high_resolution_clock::now();
+    const int gameCountStart = state.storage->SessionGameCount();
+    const PythonMetricsSnapshot pythonStart = PythonMetrics::Instance.Take();
+    const AllocationSnapshot allocationStart = AllocationTracker::Take();
+    const SharedPoolSnapshot stateStart = Game::StateAllocator.Take();
+    const int64_t positionCountStart = state.storage->SessionPositionCount();
+    const int64_t policyRecordedCountStart = state.storage->SessionPolicyRecordedCount();
+
+    // Capture prediction cache probes during self-play if configured.
+    std::filesystem::path probeTracePath;
+    if (Config::Misc.PredictionCache_TraceProbes)
+    {
+        probeTracePath = PredictionCacheTrace::StartInLogs();
+    }
+
+    // Periodically write structured self-play metrics for this machine while playing.
+    std::vector<const SelfPlayMetrics*> workerMetrics;
+    for (const auto& worker : state.workerGroup->selfPlayWorkers)
+    {
+        workerMetrics.push_back(&worker->Metrics());
+    }
+    SelfPlayMetricsWriter metricsWriter(std::move(workerMetrics));
+
     // Need to play enough games to reach the training window maximum (skip if already enough).
     // Loop and check in case of distributed scenarios where other machines are generating games/chunks,
     // or to avoid generating too few games/chunks after unexpected failures or outside intervention.
+    int trainingChunkCount = 0;
     while (true)
     {
         // Check every "wait_milliseconds" to see whether other machines have generated enough games/chunks.
         const bool workersReady = state.workerGroup->workCoordinator->WaitForWorkers(Config::Network.Training.WaitMilliseconds);
 
         // We need to reach into Python for network info in case it's coming from cloud storage.
-        int trainingChunkCount;
         state.network->GetNetworkInfo(NetworkType_Teacher, nullptr, nullptr, &trainingChunkCount, nullptr);
+        metricsWriter.WriteIfDue(state.network, state.Step(), state.storage->TotalGameCount(trainingChunkCount));
         const int gamesToPlay = state.storage->TrainingGamesToPlay(trainingChunkCount, trainingWindow.TrainingGameMax, false /* ignoreLocalGames */);
 
         if (gamesToPlay <= 0)
@@ -233,8 +269,56 @@ void ChessCoachTrain::StagePlay(const TrainingState& state)
         }
     }
 
-    // Print prediction cache stats after finishing self-play.
+    // Print throughput stats after finishing self-play. These are for this machine, across all self-play workers.
+    const float playHours = (std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - playStart).count() / 3600.f);
+    const int gameCount = (state.storage->SessionGameCount() - gameCountStart);
+    const int64_t positionCount = (state.storage->SessionPositionCount() - positionCountStart);
+    const int64_t policyRecordedCount = (state.storage->SessionPolicyRecordedCount() - policyRecordedCountStart);
+    if ((gameCount > 0) && (playHours > 0.f))
+    {
+        std::cout << "Played " << gameCount << " games with " << positionCount << " value targets (" << policyRecordedCount
+            << " policy targets) in " << playHours << " hours on this machine: " << (gameCount / playHours) << " games/hour, "
+            << (positionCount / playHours) << " value targets/hour, " << (policyRecordedCount / playHours) << " policy targets/hour" << std::endl;
+    }
+
+    // Write the final metrics interval, then print prediction cache and slot occupancy stats after finishing self-play.
+    metricsWriter.Write(state.network, state.Step(), state.storage->TotalGameCount(trainingChunkCount));
     PredictionCache::Instance.PrintDebugInfo();
+    SelfPlayWorker::PrintSlotStatistics();
+
+    // Print GIL wait, Python execution and marshalling time per call type during self-play.
+    const PythonMetricsSnapshot python = PythonMetrics::Since(PythonMetrics::Instance.Take(), pythonStart);
+    for (const std::string& line : PythonMetrics::Describe(python))
+    {
+        std::cout << line << std::endl;
+    }
+
+    // Print allocation rates per subsystem and thread during self-play if tracking.
+    if (AllocationTracker::Enabled())
+    {
+        for (const std::string& line : AllocationTracker::Describe(AllocationTracker::Take(), allocationStart))
+        {
+            std::cout << line << std::endl;
+        }
+    }
+
+    // Print StateInfo pool memory and throughput per thread during self-play.
+    for (const std::string& line : Game::StateAllocator.Describe(Game::StateAllocator.Take(), stateStart))
+    {
+        std::cout << line << std::endl;
+    }
+
+    // Dump the most recent trace events from self-play if tracing.
+    if (Trace::Enabled())
+    {
+        std::cout << "Trace written to " << Trace::DumpToLogs().string() << std::endl;
+    }
+
+    if (!probeTracePath.empty())
+    {
+        const int64_t probeCount = PredictionCacheTrace::Stop();
+        std::cout << "Prediction cache probes (" << probeCount << ") written to " << probeTracePath.string() << std::endl;
+    }
 }
 
 void ChessCoachTrain::StageTrain(const TrainingState& state)
@@ -29,10 +29,16 @@
 #include <Stockfish/uci.h>
 #include <Stockfish/syzygy/tbprobe.h>
 
+#include <ChessCoach/AllocationTracker.h>
 #include <ChessCoach/ChessCoach.h>
+#include <ChessCoach/HardwareCounters.h>
 #include <ChessCoach/WorkerGroup.h>
+#include <ChessCoach/Metrics.h>
 #include <ChessCoach/Pgn.h>
+#include <ChessCoach/PredictionCacheTrace.h>
 #include <ChessCoach/Syzygy.h>
+#include <ChessCoach/Trace.h>
+#include <ChessCoach/TreeStatistics.h>
 
 using CommandHandler = std::function<void(std::stringstream&)>;
 using CommandHandlerEntry = std::pair<std::string, CommandHandler>;
@@ -69,6 +75,10 @@ private:
     // Custom commands
     void HandleComment(std::stringstream& commands);
     void HandleGui(std::stringstream& commands);
+    void HandleTrace(std::stringstream& commands);
+    void HandlePythonStats(std::stringstream& commands);
+    void HandleAllocStats(std::stringstream& commands);
+    void HandleCacheTrace(std::stringstream& commands);
 
     // Console
     void HandleConsole(std::stringstream& commands);
@@ -89,6 +99,9 @@ private:
     std::vector<Move> _positionMoves = {};
     std::ofstream _commandLog;
     std::vector<CommandHandlerEntry> _commandHandlers;
+    PythonMetricsSnapshot _pythonMetricsBaseline = {};
+    AllocationSnapshot _allocationBaseline = AllocationTracker::Take();
+    SharedPoolSnapshot _stateBaseline = Game::StateAllocator.Take();
 
     std::unique_ptr<INetwork> _network;
     WorkerGroup _workerGroup;
@@ -139,6 +152,10 @@ void ChessCoachUci::Initialize()
     // Custom commands
     _commandHandlers.emplace_back("comment", std::bind(&ChessCoachUci::HandleComment, this, std::placeholders::_1));
     _commandHandlers.emplace_back("gui", std::bind(&ChessCoachUci::HandleGui, this, std::placeholders::_1));
+    _commandHandlers.emplace_back("trace", std::bind(&ChessCoachUci::HandleTrace, this, std::placeholders::_1));
+    _commandHandlers.emplace_back("pythonstats", std::bind(&ChessCoachUci::HandlePythonStats, this, std::placeholders::_1));
+    _commandHandlers.emplace_back("allocstats", std::bind(&ChessCoachUci::HandleAllocStats, this, std::placeholders::_1));
+    _commandHandlers.emplace_back("cachetrace", std::bind(&ChessCoachUci::HandleCacheTrace, this, std::placeholders::_1));
 
     // Console (for unsafely-threaded debug info)
     _commandHandlers.emplace_back("`", std::bind(&ChessCoachUci::HandleConsole, this, std::placeholders::_1));
@@ -404,7 +421,7 @@ void ChessCoachUci::HandleSetOption(std::stringstream& commands)
         InitializeNetwork();
         _network->UpdateNetworkWeights(Config::Network.SelfPlay.NetworkWeights);
     }
-    else if (name == "syzygy")
+    else if ((name == "syzygy") || (name == "syzygy_wdl_cache_mebibytes"))
     {
         Syzygy::Reload();
         _syzygyLoaded = true;
@@ -413,6 +430,18 @@ void ChessCoachUci::HandleSetOption(std::stringstream& commands)
     {
         InitializePredictionCache();
     }
+    else if (name == "trace")
+    {
+        Trace::SetEnabled(Config::Misc.Trace_Enabled);
+    }
+    else if (name == "allocation_tracking")
+    {
+        AllocationTracker::SetEnabled(Config::Misc.Trace_AllocationTracking);
+    }
+    else if (name == "hardware_counters")
+    {
+        HardwareCounters::SetEnabled(Config::Misc.Trace_HardwareCounters);
+    }
 }
 
 void ChessCoachUci::HandleRegister(std::stringstream& /*commands*/)
@@ -618,6 +647,88 @@ void ChessCoachUci::HandleGui(std::stringstream& /*commands*/)
     _workerGroup.searchState.gui = true;
 }
 
+// Dump recorded trace events (see the "trace" option) while leaving any search running. Use "trace clear" to start afresh.
+void ChessCoachUci::HandleTrace(std::stringstream& commands)
+{
+    std::string token;
+    if ((commands >> token) && (token == "clear"))
+    {
+        Trace::Clear();
+        return;
+    }
+
+    const std::filesystem::path path = Trace::DumpToLogs();
+    std::cout << "info string trace written to " << path.string() << std::endl;
+}
+
+// Print GIL wait, Python execution and marshalling time per Python call type since startup,
+// or since the last "pythonstats clear".
+void ChessCoachUci::HandlePythonStats(std::stringstream& commands)
+{
+    const PythonMetricsSnapshot current = PythonMetrics::Instance.Take();
+
+    std::string token;
+    if ((commands >> token) && (token == "clear"))
+    {
+        _pythonMetricsBaseline = current;
+        return;
+    }
+
+    const PythonMetricsSnapshot python = PythonMetrics::Since(current, _pythonMetricsBaseline);
+    for (const std::string& line : PythonMetrics::Describe(python))
+    {
+        std::cout << "info string " << line << std::endl;
+    }
+}
+
+// Print allocation rates per subsystem and thread (see the "allocation_tracking" option), plus StateInfo pool
+// usage and throughput, since startup, or since the last "allocstats clear", which also resets peaks.
+void ChessCoachUci::HandleAllocStats(std::stringstream& commands)
+{
+    const AllocationSnapshot current = AllocationTracker::Take();
+    const SharedPoolSnapshot stateCurrent = Game::StateAllocator.Take();
+
+    std::string token;
+    if ((commands >> token) && (token == "clear"))
+    {
+        _allocationBaseline = current;
+        _stateBaseline = stateCurrent;
+        AllocationTracker::ResetPeaks();
+        return;
+    }
+
+    for (const std::string& line : AllocationTracker::Describe(current, _allocationBaseline))
+    {
+        std::cout << "info string " << line << std::endl;
+    }
+    for (const std::string& line : Game::StateAllocator.Describe(stateCurrent, _stateBaseline))
+    {
+        std::cout << "info string " << line << std::endl;
+    }
+}
+
+// Start capturing prediction cache probes to the logs directory with "cachetrace start",
+// and finish the file with "cachetrace stop", for replay via ChessCoachCacheSimulator.
+void ChessCoachUci::HandleCacheTrace(std::stringstream& commands)
+{
+    std::string token;
+    if (!(commands >> token))
+    {
+        return;
+    }
+
+    if (token == "start")
+    {
+        const std::filesystem::path path = PredictionCacheTrace::StartInLogs();
+        std::cout << "info string Capturing prediction cache probes to " << path.string() << std::endl;
+    }
+    else if (token == "stop")
+    {
+        const int64_t probeCount = PredictionCacheTrace::Stop();
+        std::cout << "info string Captured " << probeCount << " prediction cache probes" << std::endl;
+    }
+}
+
 void ChessCoachUci::HandleConsole(std::stringstream& commands)
 {
     std::string token;
@@ -688,6 +799,20 @@ void ChessCoachUci::HandleConsole(std::stringstream& commands)
             }
         }
     }
+    else if (token == "treestats")
+    {
+        // Summarize the current tree's shape, or print per-depth CSV with "treestats csv".
+        const TreeStatistics treeStatistics = _workerGroup.controllerWorker->CollectTreeStatistics();
+        if ((commands >> token) && (token == "csv"))
+        {
+            TreeStatistics::WriteCsvHeader(std::cout);
+            treeStatistics.WriteCsv(std::cout, 0 /* searchId */);
+        }
+        else
+        {
+            treeStatistics.Print(std::cout, "");
+        }
+    }
     else if (token == "fen")
     {
         // Convert the last "position" specified to a standalone FEN.
@@ -51,6 +51,8 @@ class DatasetBuilder:
     "policy_row_lengths": tf.io.FixedLenSequenceFeature([], tf.int64, allow_missing=True),
     "policy_indices": tf.io.FixedLenSequenceFeature([], tf.int64, allow_missing=True),
     "policy_values": tf.io.FixedLenSequenceFeature([], tf.float32, allow_missing=True),
+    # Older games have no "policy_recorded" feature, so pad with 1 (recorded).
+    "policy_recorded": tf.io.FixedLenSequenceFeature([], tf.int64, allow_missing=True, default_value=1),
   }
 
   commentary_feature_map = {
@@ -78,17 +80,27 @@ class DatasetBuilder:
   def decompress_values(self, result, indices):
     return tf.where(indices % 2 == 0, result, self.flip_value(result))
 
+  # Swap the current and opposing players' piece planes and flip the board vertically (reverse each bitboard's bytes/ranks).
+  def flip_pieces_and_repetitions(self, pieces_and_repetitions):
+    half = ModelBuilder.input_piece_planes_per_position // 2
+    pieces = pieces_and_repetitions[:, :ModelBuilder.input_piece_planes_per_position]
+    repetitions = pieces_and_repetitions[:, ModelBuilder.input_piece_planes_per_position:]
+    pieces = tf.concat([pieces[:, half:], pieces[:, :half]], axis=1)
+    pieces = tf.bitcast(tf.reverse(tf.bitcast(pieces, tf.uint8), axis=[-1]), tf.int64)
+    return tf.concat([pieces, repetitions], axis=1)
+
   def decompress_images(self, image_pieces_auxiliary, indices):
     # Slice out piece/repetition and auxiliary planes.
     image_pieces_and_repetitions = image_pieces_auxiliary[:, :ModelBuilder.input_piece_and_repetition_planes_per_position]
     image_auxiliary = image_pieces_auxiliary[:, ModelBuilder.input_piece_and_repetition_planes_per_position:]
 
-    # Saturate the first position back for the 7 non-existent history positions.
-    # Since we know that it's the starting position for training data, no need to flip perspective per position (no-op).
-    paddings = [1, 2, 4]
-    assert sum(paddings) == ModelBuilder.input_previous_position_count
-    for pad in paddings:
-      image_pieces_and_repetitions = tf.pad(image_pieces_and_repetitions, [[pad, 0], [0, 0]], mode="SYMMETRIC")
+    # Saturate the first position back for the 7 non-existent history positions, flipping perspective per position
+    # to match HistoryWalker in C++. This is a no-op for the starting position but not for games forked from
+    # positions in earlier games (see "start_fen" in Storage.cpp).
+    first = image_pieces_and_repetitions[:1]
+    first_flipped = self.flip_pieces_and_repetitions(first)
+    history = [first_flipped if (distance % 2) else first for distance in range(ModelBuilder.input_previous_position_count, 0, -1)]
+    image_pieces_and_repetitions = tf.concat(history + [image_pieces_and_repetitions], axis=0)
 
     # Take a slice of the last N positions' piece planes and concatenate this position's auxiliary planes.
     gathered_pieces_and_repetitions = tf.map_fn(lambda x: image_pieces_and_repetitions[x:x + ModelBuilder.input_previous_position_plus_current_count], indices)
@@ -133,7 +145,7 @@ class DatasetBuilder:
 
     return (images, values, policies)
 
-  def parse_game(self, position_count, selected, result, mcts_values, image_pieces_auxiliary, policy_row_lengths, policy_indices, policy_values, options):
+  def parse_game(self, position_count, selected, result, mcts_values, image_pieces_auxiliary, policy_row_lengths, policy_indices, policy_values, policy_recorded, options):
     # Unpad down from the dense shape across all games in the chunk to this particular game's position count.
     mcts_values = mcts_values[:position_count]
     image_pieces_auxiliary = image_pieces_auxiliary[:position_count]
@@ -147,8 +159,12 @@ class DatasetBuilder:
     images, values, policies = self.decompress(result, image_pieces_auxiliary, policy_row_lengths, policy_indices, policy_values, indices)
     mcts_values = tf.gather(mcts_values, indices)
 
-    # Return the dataset mapping images to labels.
-    dataset = tf.data.Dataset.from_tensor_slices((images, (values, mcts_values, policies)))
+    # Weight value and MCTS value losses for every position, but policy loss only for full searches.
+    value_weights = tf.ones_like(values)
+    policy_weights = tf.cast(tf.gather(policy_recorded[:position_count], indices) != 0, tf.float32)
+
+    # Return the dataset mapping images to labels, with sample weights per output.
+    dataset = tf.data.Dataset.from_tensor_slices((images, (values, mcts_values, policies), (value_weights, value_weights, policy_weights)))
     return dataset
 
   def parse_games(self, batch, options):
@@ -160,15 +176,21 @@ class DatasetBuilder:
     policy_row_lengths = example["policy_row_lengths"]
     policy_indices = example["policy_indices"]
     policy_values = example["policy_values"]
+    policy_recorded = example["policy_recorded"]
 
     # Throw away a proportion of *positions* to avoid overly correlated/periodic data. This is a time/space trade-off.
     # Throwing away more saves memory but costs CPU. Increasing shuffle buffer size saves CPU but costs memory.
     position_count = tf.math.count_nonzero(policy_row_lengths, axis=1, dtype=tf.int32)
     selected = tf.random.uniform(tf.shape(policy_row_lengths)) < options.keep_position_proportion
 
+    # With playout cap randomization, only positions with full searches have policy targets recorded for training.
+    # Fast-searched positions still train value, but their policy loss is weighted to zero (see "parse_game").
+    # If no games in the batch have the feature, it parses empty, so pad out as recorded.
+    policy_recorded = tf.pad(policy_recorded, [[0, 0], [0, tf.shape(policy_row_lengths)[1] - tf.shape(policy_recorded)[1]]], constant_values=1)
+
     # Each game needs to be decompressed separately to avoid history leaking across games
     # and to reconstruct the ragged (across positions) and sparse (within a position) policy tensors.
-    dataset = tf.data.Dataset.from_tensor_slices((position_count, selected, result, mcts_values, image_pieces_auxiliary, policy_row_lengths, policy_indices, policy_values))
+    dataset = tf.data.Dataset.from_tensor_slices((position_count, selected, result, mcts_values, image_pieces_auxiliary, policy_row_lengths, policy_indices, policy_values, policy_recorded))
     dataset = dataset.filter(lambda position_count, selected, *_: tf.math.reduce_any(selected[:position_count]))
     dataset = dataset.flat_map(lambda *x: self.parse_game(*x, options))
     return dataset